@@ -15,6 +15,15 @@ namespace astraea {
 // IWYU pragma: private, include "scope.hpp"
 struct Scope;
 
+// IWYU pragma: private, include "layout.hpp"
+struct StructLayout;
+
+// IWYU pragma: private, include "decode_plan.hpp"
+struct DecodePlan;
+
+// IWYU pragma: private, include "type_registry.hpp"
+struct BuiltinType;
+
 struct AstNode {
     AstNodeType node_type;
 };
@@ -58,11 +67,34 @@ struct AstFunction {
     Scope *scope;
 };
 
+/*
+ * `<< ._name = value` annotation of a field or a struct.
+ */
+struct AstAttribute {
+    std::string name;   // without the leading dot, e.g. "_lenght".
+    std::string value;  // literal, ".field" for references to other fields.
+};
+
 struct AstVariable {
     AstNodeType node_type;
     std::string name;
     std::string type;
     std::string value;
+    std::string count;  // array element count: empty for scalars, "..", a literal or a field name.
+    AstAttribute **attributes;
+    uint32_t attribute_count;
+};
+
+/*
+ * `name :: literal;` or `name :: { literal, ... };`, like the entries of a
+ * `_metadata` struct. Literals are AstString nodes kept as written: strings
+ * quoted, hex numbers with their 0x prefix.
+ */
+struct AstConstant {
+    AstNodeType node_type;
+    std::string name;
+    AstNode **values;
+    uint32_t value_count;
 };
 
 struct AstType {
@@ -86,6 +118,7 @@ struct AstTypeEnum {
     AstNode **elements;
     uint32_t element_count;
     Scope *scope;
+    const BuiltinType *builtin;  // storage type, null for the default.
 };
 
 struct AstTypeString {
@@ -94,7 +127,7 @@ struct AstTypeString {
     std::string name;
     std::string value;
     std::string encoding;
-    uint32_t count;
+    uint64_t count;
 };
 
 struct AstTypeStruct {
@@ -103,15 +136,31 @@ struct AstTypeStruct {
     std::string name;
     AstNode *block;
     Scope *scope;
+    StructLayout *layout;
+    DecodePlan *decode_plan;
+    AstAttribute **attributes;
+    uint32_t attribute_count;
 };
 
 AstTypeInfo parse_type_info(std::string_view base_type);
 std::string ast_node_type_as_string(AstNodeType node_type);
 
+/*
+ * Number of child nodes the walker descends into.
+ */
+uint32_t ast_child_count(AstNode *node);
+
+/*
+ * Child at _index_ of _node_, may be null for empty statements.
+ */
+AstNode *ast_child(AstNode *node, uint32_t index);
+
 AstNode *ast_noop_init();
 AstCompound *ast_compound_init();
 AstCompound *ast_compound_add_statement(AstCompound *ast_compound, AstNode *statement);
 
+AstConstant *ast_constant_init(std::string_view constant_name);
+AstConstant *ast_constant_add_value(AstConstant *ast_constant, AstNode *value);
 AstFunction *ast_function_init(std::string_view func_name);
 AstString *ast_string_init(std::string_view string_value);
 
@@ -121,5 +170,22 @@ AstTypeEnum *ast_typedef_enum_add_element(AstTypeEnum *ast_type_enum, AstNode *e
 AstTypeString *ast_typedef_string_init(std::string_view string_name);
 AstTypeStruct *ast_typedef_struct_init(std::string_view struct_name);
 AstVariable *ast_vardef_init(std::string_view variable_name);
+AstAttribute *ast_attribute_init(std::string_view name, std::string_view value);
+
+/*
+ * Appends _attribute_ to an attribute list, used by fields and structs.
+ */
+void ast_attribute_add(AstAttribute ***attributes, uint32_t *attribute_count, AstAttribute *attribute);
+
+/*
+ * Attribute _name_ of a field, null if it was not given.
+ */
+const AstAttribute *ast_vardef_find_attribute(const AstVariable *var_def, std::string_view name);
+
+/*
+ * Element count of a field: its brackets, or the `._lenght` attribute for
+ * [..] fields and strings.
+ */
+std::string_view ast_vardef_count(const AstVariable *var_def);
 
 }  // namespace astraea
@@ -16,17 +16,19 @@ enum class AstNodeType : uint32_t {
     FUNCTION_DEFINITION,  // Defines a callable function.
     TYPE_DEFINITION,      // Defines a data type.
     VARIABLE_DEFINITION,  // Defines a variable.
+    CONSTANT_DEFINITION,  // Names a literal or a list of literals.
     NO_OPERATION          // ... kinda like a return command, stops the visitor.
 };
 
 enum class AstTypeInfo : uint32_t {
     UNSIGNED, U8, U16, U32, U64,
     SIGNED, S8, S16, S32, S64,
-    FLOAT, F32, F64,
+    FLOAT, F16, F32, F64,
     STRING,
     STRUCT,
     ENUM,
     BOOL,
+    CHAR,
     // POINTER,
     // PROCEDURE,
     // VOID,
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/decode_plan.hpp"
+#include "include/utils/mappedreader.hpp"
+#include "include/utils/threadpool.hpp"
+
+namespace astraea {
+
+/*
+ * Smallest number of records handed to a worker at once, smaller batches
+ * cost more in queueing than they gain in balance.
+ */
+#define DECODE_PARALLEL_MIN_BATCH 64
+
+/*
+ * Decodes the _count_ _plan_ records found at the absolute _offsets_ of
+ * _source_, batches of them are decoded concurrently on _pool_ (on the
+ * calling thread when null).
+ *
+ * Each worker reads through its own cursor over the shared mapping and its
+ * own context, set up with the endian and lazy threshold of _context_.
+ * _out_list_ becomes a LIST where element i is the record at _offsets_[i],
+ * whatever order the workers finish in. On failure the status of the first
+ * failing record in list order is returned, the records are kept.
+ */
+DecodeStatus decode_parallel(
+    const DecodePlan *plan,
+    const binaryreader::MappedFile &source,
+    const uint64_t *offsets,
+    uint64_t count,
+    const DecodeContext *context,
+    platform::ThreadPool *pool,
+    Value *out_list);
+
+/*
+ * Follows the `._points_to` field in _slot_ of every record of _records_
+ * (a LIST decoded with _plan_) and decodes the records it points to with
+ * decode_parallel, in the same order. Returns UNSUPPORTED_TYPE if the field
+ * is not a pointer.
+ */
+DecodeStatus decode_follow_pointers(
+    const DecodePlan *plan,
+    uint32_t slot,
+    const Value *records,
+    const binaryreader::MappedFile &source,
+    const DecodeContext *context,
+    platform::ThreadPool *pool,
+    Value *out_list);
+
+}  // namespace astraea
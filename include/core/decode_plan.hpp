@@ -0,0 +1,347 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/ast.hpp"
+#include "include/core/runtime.hpp"
+#include "include/core/type_registry.hpp"
+#include "include/utils/binaryreader.hpp"
+#include "include/utils/bitreader.hpp"
+#include "include/utils/transcode.hpp"
+#include "include/utils/types.hpp"
+
+namespace astraea {
+
+/*
+ * Adjacent fixed fields are fetched with single reads of up to this size, a
+ * run is split before the field that would make it bigger, unless that field
+ * starts mid-byte. Bigger fixed fields are read on their own.
+ */
+#define DECODE_MAX_RUN 4096
+
+/*
+ * Lengths read from the source up to this many bytes are allocated as they
+ * are, bigger ones must fit in what is left of the source. Asking some
+ * readers for their size costs seeks.
+ */
+#define DECODE_TRUSTED_SIZE (64 * 1024)
+
+constexpr uint32_t DECODE_NO_SLOT = 0xFFFFFFFF;
+
+enum class DecodeOpType : uint32_t {
+    READ_RUN,        // One bulk read of a run of adjacent fixed fields into the scratch buffer.
+    EXTRACT,         // Scalar at a byte offset of the run.
+    EXTRACT_BITS,    // Sub-byte scalar at a bit offset of the run.
+    EXTRACT_BIT_RUN, // Adjacent sub-byte scalars split from a single load.
+    EXTRACT_ARRAY,   // Fixed count of scalars at a byte offset of the run.
+    EXTRACT_STRUCT,  // Fixed struct(s) at a byte offset of the run, no extra read.
+    READ_ARRAY,      // Scalars whose size is only known while decoding.
+    READ_STRUCT,     // Variable sized struct(s), decoded with their own plan.
+    UNSUPPORTED      // Field type the decoder does not know how to read.
+};
+
+struct DecodePlan;
+
+/*
+ * Fields of an EXTRACT_BIT_RUN op, they fill consecutive slots.
+ */
+struct DecodeBitRun {
+    binaryreader::BitFieldRun fields;
+    const BuiltinType *builtins[BIT_RUN_MAX_FIELDS];
+};
+
+struct DecodeOp {
+    DecodeOpType type;
+    AstTypeInfo base_type;  // builtin of the scalars read by the op.
+    uint32_t slot;          // field (value) written by the op.
+    uint32_t offset;        // byte offset inside the run, run size for READ_RUN.
+    uint32_t bit_offset;    // bit offset inside the run, EXTRACT_BITS* only.
+    uint32_t bit_size;      // size of one element.
+    uint64_t count;         // number of elements when known at compile time.
+    uint32_t count_slot;    // READ_* only, field holding the element count.
+    bool is_array;          // the field was declared with brackets.
+    bool is_unbounded;      // [..] without a known lenght.
+    bool is_lazy;           // READ_ARRAY only, left LAZY when the reader can skip it.
+    DecodePlan *sub_plan;   // *_STRUCT only.
+    BuiltinDecoder decode;  // EXTRACT and EXTRACT_BITS only, selected at compile time.
+    DecodeBitRun *bit_run;  // EXTRACT_BIT_RUN only, _count_ fields from _slot_ on.
+    DecodePlan *target_plan;  // `._points_to = Struct` fields, plan of the record at the offset they hold.
+    platform::TextEncoding encoding;  // *_ARRAY only, code units of a string, turned into UTF-8 once read.
+};
+
+/*
+ * Decode program of a struct.
+ *
+ * Fixed fields are grouped in runs, each run costs one read of the source
+ * and one bounds check, its fields are then extracted from the scratch buffer
+ * and byte swapped in registers.
+ */
+struct DecodePlan {
+    AstTypeStruct *struct_def;
+    DecodeOp *ops;
+    uint32_t op_count;
+    uint32_t slot_count;    // one slot per field of the struct.
+    uint32_t scratch_size;  // bytes of the biggest run.
+    uint32_t run_count;     // reads issued for the fixed parts of the struct.
+    uint64_t min_byte_size; // bytes every record reads, its fixed prefix.
+};
+
+enum class DecodeStatus : uint32_t {
+    OK,
+    END_OF_INPUT,      // The source ended in the middle of a read.
+    UNBOUNDED_ARRAY,   // [..] field without a lenght.
+    LENGTH_OVERFLOW,   // Template supplied lenght does not fit in memory.
+    UNSUPPORTED_TYPE,
+    WRITE_FAILED       // Encoding only, the destination could not be written.
+};
+
+/*
+ * Per decoder state, give each thread its own context.
+ */
+struct DecodeContext {
+    Endian endian;
+    uint8_t *scratch;
+    uint32_t scratch_capacity;
+    uint64_t lazy_threshold;  // arrays of at least this many bytes are left LAZY, 0 reads them all.
+};
+
+/*
+ * Compiles (once) the decode plan of _struct_def_, its layout is computed if
+ * needed.
+ */
+DecodePlan *decode_plan_compile(AstTypeStruct *struct_def);
+
+void decode_context_init(DecodeContext *context, Endian endian);
+void decode_context_reserve(DecodeContext *context, uint32_t size);
+void decode_context_free(DecodeContext *context);
+
+/*
+ * Extracts the fields of a fixed struct laid out at _src_.
+ */
+void decode_extract_record(const DecodePlan *plan, const uint8_t *src, Endian endian, Value *out_record);
+
+/*
+ * Runs an EXTRACT* op over the run in _scratch_.
+ */
+void decode_extract(const DecodeOp *op, const uint8_t *scratch, Endian endian, Value *values);
+
+/*
+ * Resolves the element count of a READ_* op, returns false on error.
+ */
+bool decode_op_count(const DecodeOp *op, const Value *values, uint64_t *out_count, DecodeStatus *out_status);
+
+/*
+ * Byte swaps _count_ elements of _byte_size_ bytes, in place.
+ */
+void decode_swap_array(uint8_t *data, uint64_t count, uint32_t byte_size, Endian endian);
+
+/*
+ * Turns the code units read by a string field, in the byte order of
+ * _encoding_, into UTF-8 text (BYTES of CHAR). UTF-8 read as a VIEW is only
+ * validated. Text that is not valid in its encoding is left as the code units
+ * it was stored as, in native byte order.
+ */
+void decode_text(platform::TextEncoding encoding, Value *value);
+
+/*
+ * Checks that _size_ bytes are left in _reader_ before they are allocated,
+ * so a bogus lenght fails with END_OF_INPUT instead of exhausting memory.
+ * Readers that do not know their size yet pass.
+ */
+template <typename Reader>
+bool
+decode_fits_source(Reader &reader, uint64_t size)
+{
+    using binaryreader::file_size;
+    using binaryreader::tell;
+
+    if (size <= DECODE_TRUSTED_SIZE) {
+        return true;
+    }
+    auto end = file_size(reader);
+    auto pos = (uint64_t)tell(reader);
+    return pos <= end && size <= end - pos;
+}
+
+/*
+ * Decodes one _plan_ record from the current offset of _reader_.
+ *
+ * _Reader_ is any source with a read_bytes(reader, data, size) overload.
+ * Byte arrays are borrowed instead of copied from readers that also provide
+ * read_view(reader, size, view), like the mapped file. Big or `._lazy`
+ * arrays are skipped with read_lazy(reader, size, offset) and left LAZY,
+ * see decode_materialize.
+ */
+template <typename Reader>
+DecodeStatus
+decode_plan_execute(const DecodePlan *plan, Reader &reader, DecodeContext *context, Value *out_record)
+{
+    using binaryreader::read_bytes;  // overloads of other readers are found by ADL.
+    using binaryreader::read_lazy;
+    using binaryreader::read_view;
+
+    decode_context_reserve(context, plan->scratch_size);
+    value_init_children(out_record, ValueType::RECORD, plan->slot_count);
+    auto values = out_record->values;
+
+    for (uint32_t i = 0; i < plan->op_count; i += 1) {
+        auto op = &plan->ops[i];
+        switch (op->type) {
+        case DecodeOpType::READ_RUN:
+        {
+            if (!read_bytes(reader, context->scratch, op->offset)) {
+                return DecodeStatus::END_OF_INPUT;
+            }
+            break;
+        }
+        case DecodeOpType::EXTRACT:
+        case DecodeOpType::EXTRACT_BITS:
+        case DecodeOpType::EXTRACT_BIT_RUN:
+        case DecodeOpType::EXTRACT_ARRAY:
+        case DecodeOpType::EXTRACT_STRUCT:
+        {
+            decode_extract(op, context->scratch, context->endian, values);
+            break;
+        }
+        case DecodeOpType::READ_ARRAY:
+        {
+            auto status = DecodeStatus::OK;
+            uint64_t count = 0;
+            uint64_t byte_size = 0;
+            if (!decode_op_count(op, values, &count, &status)) {
+                return status;
+            }
+            if (!checked_mul<uint64_t>(count, op->bit_size / 8, &byte_size)) {
+                return DecodeStatus::LENGTH_OVERFLOW;
+            }
+
+            auto is_bytes = op->bit_size == 8;
+            auto &value = values[op->slot];
+            value.base_type = op->base_type;
+            auto view = binaryreader::ByteView{};
+            if (is_bytes && read_view(reader, byte_size, &view)) {
+                value_init_view(&value, view.data, view.size, view.buffer);
+                if (platform::TextEncoding::NONE != op->encoding) {
+                    decode_text(op->encoding, &value);
+                }
+                break;
+            }
+            auto is_lazy = op->is_lazy || (context->lazy_threshold && byte_size >= context->lazy_threshold);
+            uint64_t offset = 0;
+            if (is_lazy && read_lazy(reader, byte_size, &offset)) {
+                value_init_lazy(&value, offset, count);
+                break;
+            }
+            if (!decode_fits_source(reader, byte_size)) {
+                return DecodeStatus::END_OF_INPUT;
+            }
+            auto data = value_init_data(&value, is_bytes ? ValueType::BYTES : ValueType::ARRAY, count, byte_size);
+            if (!read_bytes(reader, data, byte_size)) {
+                return DecodeStatus::END_OF_INPUT;
+            }
+            if (platform::TextEncoding::NONE != op->encoding) {
+                decode_text(op->encoding, &value);
+            } else {
+                decode_swap_array(data, count, op->bit_size / 8, context->endian);
+            }
+            break;
+        }
+        case DecodeOpType::READ_STRUCT:
+        {
+            auto status = DecodeStatus::OK;
+            auto &value = values[op->slot];
+            if (!op->is_array) {
+                status = decode_plan_execute(op->sub_plan, reader, context, &value);
+                if (DecodeStatus::OK != status) {
+                    return status;
+                }
+                break;
+            }
+
+            uint64_t count = 0;
+            uint64_t list_size = 0;
+            uint64_t source_size = 0;
+            if (!decode_op_count(op, values, &count, &status)) {
+                return status;
+            }
+            // Records of only variable fields can take no bytes, they still
+            // count as one so the list can't outgrow the source.
+            auto record_size = op->sub_plan->min_byte_size > 0 ? op->sub_plan->min_byte_size : 1;
+            if (!checked_mul<uint64_t>(count, sizeof(Value), &list_size) ||
+                !checked_mul<uint64_t>(count, record_size, &source_size)) {
+                return DecodeStatus::LENGTH_OVERFLOW;
+            }
+            if (!decode_fits_source(reader, source_size)) {
+                return DecodeStatus::END_OF_INPUT;
+            }
+            auto records = value_init_children(&value, ValueType::LIST, count);
+            for (uint64_t n = 0; n < count; n += 1) {
+                status = decode_plan_execute(op->sub_plan, reader, context, &records[n]);
+                if (DecodeStatus::OK != status) {
+                    return status;
+                }
+            }
+            break;
+        }
+        case DecodeOpType::UNSUPPORTED:
+            return DecodeStatus::UNSUPPORTED_TYPE;
+        }
+    }
+
+    return DecodeStatus::OK;
+}
+
+/*
+ * Reads the elements of a LAZY _value_ from _reader_, the source it was
+ * decoded from, and turns it into BYTES or ARRAY. Strings are turned into
+ * UTF-8 like eager ones, _encoding_ is the one of the field (its layout),
+ * NONE for other arrays. The offset of _reader_ is left untouched. Values
+ * that are not LAZY are left as they are.
+ */
+template <typename Reader>
+DecodeStatus
+decode_materialize(Value *value, Reader &reader, Endian endian, platform::TextEncoding encoding)
+{
+    using binaryreader::file_size;
+    using binaryreader::read_bytes;  // overloads of other readers are found by ADL.
+    using binaryreader::seek;
+    using binaryreader::tell;
+
+    if (ValueType::LAZY != value->type) {
+        return DecodeStatus::OK;
+    }
+
+    auto builtin = type_registry_find(value->base_type);
+    uint32_t element_size = builtin ? builtin->bit_size / 8 : 1;
+    auto offset = value->u64;
+    auto count = value->count;
+    auto byte_size = count * element_size;  // checked when the value was decoded.
+    auto end = file_size(reader);
+    if (offset > end || byte_size > end - offset) {
+        return DecodeStatus::END_OF_INPUT;
+    }
+
+    auto old_pos = tell(reader);
+    seek(reader, offset);
+    auto data = value_init_data(value, element_size == 1 ? ValueType::BYTES : ValueType::ARRAY, count, byte_size);
+    auto is_read = read_bytes(reader, data, byte_size);
+    seek(reader, old_pos);
+    if (!is_read) {
+        value_free(value);  // keeps _base_type_.
+        value_init_lazy(value, offset, count);
+        return DecodeStatus::END_OF_INPUT;
+    }
+    if (platform::TextEncoding::NONE != encoding) {
+        decode_text(encoding, value);
+    } else {
+        decode_swap_array(data, count, element_size, endian);
+    }
+
+    return DecodeStatus::OK;
+}
+
+}  // namespace astraea
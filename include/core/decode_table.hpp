@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/decode_plan.hpp"
+#include "include/utils/types.hpp"
+#include <algorithm>
+
+namespace astraea {
+
+// Deepest nesting of fixed structs a column can come from.
+#define DECODE_TABLE_MAX_DEPTH 8
+
+// Bytes of records read and split per iteration.
+#define DECODE_TABLE_CHUNK (256 * 1024)
+
+/*
+ * One leaf field of a table decoded column-wise.
+ */
+struct TableColumn {
+    uint32_t path[DECODE_TABLE_MAX_DEPTH];  // field slot at each nesting level.
+    uint32_t depth;
+    AstTypeInfo base_type;
+    uint32_t bit_offset;  // offset of the field from the beginning of the record.
+    uint32_t bit_size;    // stored size of one element.
+    uint32_t width;       // bytes of one element inside of the column.
+    uint64_t per_record;  // elements per record, more than one for fixed arrays.
+    uint8_t *data;        // count * per_record elements, native byte order.
+};
+
+/*
+ * A [N] FixedStruct array decoded as a structure of arrays.
+ */
+struct DecodedTable {
+    const DecodePlan *plan;
+    uint64_t count;   // number of records.
+    uint32_t stride;  // bytes of one record in the source.
+    TableColumn *columns;
+    uint32_t column_count;
+};
+
+/*
+ * Prepares the columns for _count_ records of _plan_. Returns false if the
+ * struct is not fixed, those are decoded record by record.
+ */
+bool decode_table_init(DecodedTable *table, const DecodePlan *plan, uint64_t count);
+
+/*
+ * Splits _count_ contiguous records into the columns, starting at record
+ * _first_ of the table. Fields are gathered with SIMD and byte swapped with
+ * shuffles when the CPU allows it, the results always match
+ * maybe_endian_swap.
+ */
+void decode_table_split(DecodedTable *table, const uint8_t *records, uint64_t first, uint64_t count, Endian endian);
+
+void decode_table_free(DecodedTable *table);
+
+/*
+ * Decodes _count_ records of the fixed struct of _plan_ from _reader_ in
+ * big sequential reads.
+ */
+template <typename Reader>
+DecodeStatus
+decode_table_execute(const DecodePlan *plan, Reader &reader, uint64_t count, DecodeContext *context, DecodedTable *out_table)
+{
+    using binaryreader::prefetch_ahead;
+    using binaryreader::read_bytes;  // overloads of other readers are found by ADL.
+
+    if (!decode_table_init(out_table, plan, count)) {
+        return DecodeStatus::UNSUPPORTED_TYPE;
+    }
+
+    auto stride = out_table->stride;
+    uint64_t chunk_records = stride ? std::max<uint64_t>(1, DECODE_TABLE_CHUNK / stride) : count;
+    decode_context_reserve(context, (uint32_t)std::min<uint64_t>(chunk_records * stride, 0xFFFFFFF0));
+
+    for (uint64_t first = 0; first < count; first += chunk_records) {
+        auto records = std::min(chunk_records, count - first);
+        auto next_records = std::min(chunk_records, count - first - records);
+        prefetch_ahead(reader, (records + next_records) * stride);  // overlaps the next read with this split.
+        if (!read_bytes(reader, context->scratch, records * stride)) {
+            return DecodeStatus::END_OF_INPUT;
+        }
+        decode_table_split(out_table, context->scratch, first, records, context->endian);
+    }
+
+    return DecodeStatus::OK;
+}
+
+}  // namespace astraea
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/ast.hpp"
+#include "include/utils/binaryreader.hpp"
+#include "include/utils/types.hpp"
+#include <algorithm>
+
+namespace astraea {
+
+// Bytes at the start of a file searched for signatures.
+#define DETECT_HEAD_SIZE (4 * 1024)
+
+// Score of a signature found at offset zero, anywhere else in the head and of a file mask.
+#define DETECT_SCORE_MAGIC 1000
+#define DETECT_SCORE_EMBEDDED 10
+#define DETECT_SCORE_MASK 100
+
+/*
+ * Format detection index. The signatures of every format are compiled into
+ * a single Aho-Corasick automaton, so the head of a file is scanned once
+ * whatever the number of formats. File masks of the form `*.ext` are indexed
+ * by extension, the other masks are matched as globs.
+ */
+struct FormatDetector;
+
+struct DetectCandidate {
+    uint32_t format;  // index returned by detector_add_format.
+    uint32_t score;   // higher is more likely, see DETECT_SCORE_*.
+};
+
+FormatDetector *detector_create();
+void detector_destroy(FormatDetector *detector);
+
+/*
+ * Registers a format without signatures or masks, returns its index.
+ */
+uint32_t detector_add_format(FormatDetector *detector, std::string_view name);
+
+/*
+ * Registers the template parsed in _root_ as _name_, with the `signatures`
+ * and `file_masks` of its `_metadata` struct. Hex signatures are bytes in
+ * the order written (0x504B is "PK").
+ */
+uint32_t detector_add_module(FormatDetector *detector, std::string_view name, AstNode *root);
+
+void detector_add_signature(FormatDetector *detector, uint32_t format, const void *bytes, uint32_t size);
+void detector_add_mask(FormatDetector *detector, uint32_t format, std::string_view mask);
+
+/*
+ * Builds the automaton, call it after adding formats and before matching.
+ */
+void detector_compile(FormatDetector *detector);
+
+std::string_view detector_format_name(const FormatDetector *detector, uint32_t format);
+
+/*
+ * Ranks the formats matching _file_name_ and the first bytes of the file in
+ * _head_ (up to DETECT_HEAD_SIZE are looked at). Writes up to
+ * _max_candidates_ best candidates, best first, returns how many were written.
+ */
+uint32_t detector_match(
+    const FormatDetector *detector,
+    std::string_view file_name,
+    const uint8_t *head,
+    uint64_t head_size,
+    DetectCandidate *out_candidates,
+    uint32_t max_candidates);
+
+/*
+ * Reads the head of _reader_ (from offset zero, the offset is restored) and
+ * ranks the candidate formats, see detector_match.
+ */
+template <typename Reader>
+uint32_t
+detect_reader(
+    const FormatDetector *detector,
+    std::string_view file_name,
+    Reader &reader,
+    DetectCandidate *out_candidates,
+    uint32_t max_candidates)
+{
+    using binaryreader::file_size;  // overloads of other readers are found by ADL.
+    using binaryreader::read_bytes;
+    using binaryreader::seek;
+    using binaryreader::tell;
+
+    uint8_t head[DETECT_HEAD_SIZE];
+    auto size = std::min<uint64_t>(file_size(reader), DETECT_HEAD_SIZE);
+    auto old_pos = tell(reader);
+    seek(reader, 0);
+    if (!read_bytes(reader, head, size)) {
+        size = 0;
+    }
+    seek(reader, old_pos);
+
+    return detector_match(detector, file_name, head, size, out_candidates, max_candidates);
+}
+
+}  // namespace astraea
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/decode_plan.hpp"
+#include "include/utils/binarywriter.hpp"
+
+namespace astraea {
+
+/*
+ * Writes _record_, decoded with _plan_, back at the current offset of
+ * _writer_ in the layout of the template. Values are written as they are:
+ * count fields are not recomputed from the arrays they describe. LAZY
+ * values must be materialized first, they fail with UNSUPPORTED_TYPE.
+ */
+DecodeStatus encode_plan_execute(
+    const DecodePlan *plan,
+    const Value *record,
+    binarywriter::WriterFile &writer,
+    Endian endian);
+
+/*
+ * Journals a change of field _slot_ of the _plan_ record stored at
+ * _record_offset_ to _value_. Only byte aligned scalars whose offset does not
+ * depend on variable sized fields before them can be patched, returns false
+ * for the others.
+ */
+bool encode_patch_field(
+    const DecodePlan *plan,
+    uint64_t record_offset,
+    uint32_t slot,
+    const Value *value,
+    Endian endian,
+    binarywriter::PatchJournal *journal);
+
+/*
+ * Stores the scalar _value_ as _bit_size_ bits of _base_type_, at
+ * _bit_offset_ bits into _dst_. Bit fields are stored least significant bit
+ * first, like decode_extract reads them.
+ */
+void encode_scalar(
+    const Value *value,
+    AstTypeInfo base_type,
+    uint8_t *dst,
+    uint32_t bit_offset,
+    uint32_t bit_size,
+    Endian endian);
+
+}  // namespace astraea
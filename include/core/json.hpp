@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/decode_plan.hpp"
+#include "include/utils/types.hpp"
+
+namespace astraea {
+
+// Bytes of the JsonWriter buffer, handed to its flush function when full.
+#define JSON_WRITER_BUFFER_SIZE (256 * 1024)
+
+// Bytes of a string escaped per check of the space left in the buffer.
+#define JSON_ESCAPE_CHUNK 4096
+
+enum class JsonMode : uint32_t {
+    DOCUMENT,  // One JSON array holding every record.
+    LINES      // NDJSON, one record per line.
+};
+
+/*
+ * Takes the _size_ bytes of JSON at _data_, returns false if they could not
+ * be written.
+ */
+using JsonFlush = bool (*)(void *user, const uint8_t *data, uint64_t size);
+
+/*
+ * Streams decoded records as JSON.
+ *
+ * Records are formatted straight into the buffer: numbers with to_chars,
+ * strings with a scan that copies 16 plain bytes at a time and only stops at
+ * the bytes to escape. Records are objects named after the fields of their
+ * template. Text (strings and char arrays) becomes JSON strings, bytes that
+ * are not UTF-8 are escaped as Latin-1. Other arrays become arrays of
+ * numbers, lists of structs arrays of objects.
+ */
+struct JsonWriter {
+    uint8_t *buffer;       // JSON_WRITER_BUFFER_SIZE bytes.
+    uint64_t count;        // bytes waiting in the buffer.
+    uint64_t flushed;      // bytes handed to _flush_ so far.
+    JsonFlush flush;
+    void *user;            // passed to _flush_.
+    JsonMode mode;
+    uint64_t record_count;
+    bool has_failed;       // a flush failed or a record was cut short, later output is dropped.
+};
+
+void json_writer_init(JsonWriter *writer, JsonMode mode, JsonFlush flush, void *user);
+
+/*
+ * Closes the document, flushes and frees the buffer. Returns false if any
+ * flush failed.
+ */
+bool json_writer_finish(JsonWriter *writer);
+
+/*
+ * Hands the buffered JSON to the flush function.
+ */
+bool json_writer_flush(JsonWriter *writer);
+
+/*
+ * Writes _record_, decoded with _plan_. LAZY values must be materialized
+ * first, they fail with UNSUPPORTED_TYPE. A record that fails is taken back
+ * out of the buffer, or fails the writer if part of it was already flushed.
+ * Returns WRITE_FAILED once a flush failed.
+ */
+DecodeStatus json_write_record(JsonWriter *writer, const DecodePlan *plan, const Value *record);
+
+/*
+ * Flush functions writing to a binarywriter::WriterFile and to a
+ * platform::ConsoleSink, passed as _user_.
+ */
+bool json_flush_file(void *user, const uint8_t *data, uint64_t size);
+bool json_flush_console(void *user, const uint8_t *data, uint64_t size);
+
+}  // namespace astraea
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/ast.hpp"
+#include "include/core/visitor.hpp"
+#include "include/utils/transcode.hpp"
+#include "include/utils/types.hpp"
+
+namespace astraea {
+
+enum class LayoutState : uint32_t {
+    PENDING,      // Not computed yet.
+    IN_PROGRESS,  // Being computed, seeing it again means a recursive type.
+    DONE
+};
+
+/*
+ * Static placement of a struct field.
+ *
+ * Offsets are in bits from the beginning of the struct, fields are packed
+ * without padding exactly as they are stored in the file. _bit_offset_ is
+ * only meaningful for the fields of the fixed prefix of the struct.
+ */
+struct FieldLayout {
+    AstVariable *field;
+    AstType *type;               // user defined type of the field, null for builtins.
+    AstTypeInfo base_type;       // builtin the field (or its enum) is stored as.
+    const BuiltinType *builtin;  // registry entry of the storage type, the code unit for strings, null for structs.
+    uint64_t bit_offset;         // offset of the first element.
+    uint64_t element_bits;       // size of a single element.
+    uint64_t count;              // number of elements, 1 for scalars.
+    bool is_fixed;               // size known without reading the file.
+    platform::TextEncoding encoding;  // strings only, elements are code units of it.
+};
+
+struct StructLayout {
+    FieldLayout *fields;
+    uint32_t field_count;
+    uint32_t fixed_prefix;  // number of leading fields with static offsets.
+    uint64_t bit_size;      // size of the fixed prefix, the whole struct when fixed.
+    uint64_t byte_size;     // stride of the struct inside of an array.
+    uint32_t alignment;     // natural alignment in bytes of the widest field.
+    bool is_fixed;          // every field is fixed, the struct has constant size.
+    LayoutState state;
+};
+
+/*
+ * Computes (once) the layout of _struct_def_, referenced structs are laid
+ * out on demand. Requires the scope building pass to have run.
+ */
+StructLayout *layout_struct(AstTypeStruct *struct_def);
+
+/*
+ * Finds the layout of the field named _field_name_, null if there is none.
+ */
+FieldLayout *layout_find_field(StructLayout *layout, std::string_view field_name);
+
+/*
+ * Byte offset of element _index_ of an array of fixed structs, relative to
+ * the beginning of the array. Returns false if the struct is not fixed or
+ * the offset does not fit in 64 bits.
+ */
+bool layout_element_offset(const StructLayout *layout, uint64_t index, uint64_t *out_offset);
+
+/*
+ * Lays out every struct of the tree, nested structs first.
+ */
+struct LayoutPass : AstWalker<LayoutPass> {
+    void leave_type_definition(AstType *type_def);
+};
+
+void layout_compute_all(AstNode *root);
+
+}  // namespace astraea
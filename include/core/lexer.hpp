@@ -7,6 +7,7 @@
  */
 #pragma once
 #include "include/core/token.hpp"
+#include "include/utils/sharedbuffer.hpp"
 #include "include/utils/types.hpp"
 
 struct Lexer {
@@ -14,8 +15,9 @@ public:
     std::string path;
     uint32_t col;
     uint32_t row;
-    uint32_t pos;
-    std::string contents;
+    uint64_t pos;
+    Slice source;                // the script, shared with everything built from it.
+    std::string_view contents;  // text of _source_.
     enum class Status {
         OK,
         ERROR,
@@ -14,6 +14,7 @@ namespace astraea {
 
 // IWYU pragma: private, include "ast.hpp"
 struct AstNode;
+struct AstAttribute;
 
 struct Parser {
 public:
@@ -51,6 +52,13 @@ public:
     AstNode *parse_type_struct(std::string_view struct_name);
     AstNode *parse_function_definition(std::string_view func_name);
     AstNode *parse_const_definition();
+    AstNode *parse_constant(std::string_view constant_name);
+    AstNode *parse_literal();
     AstNode *parse_variable_definition();
+
+    /*
+     * `<< ._name = value, ._other = value` after a field type or a struct.
+     */
+    void parse_attributes(AstAttribute ***attributes, uint32_t *attribute_count);
 };
 }  // namespace astraea
\ No newline at end of file
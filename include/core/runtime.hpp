@@ -6,7 +6,77 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #pragma once
+#include "include/core/ast_types.hpp"
+#include "include/utils/sharedbuffer.hpp"
+#include "include/utils/types.hpp"
 
 namespace astraea {
 
-}
\ No newline at end of file
+enum class ValueType : uint32_t {
+    NONE,      // Not decoded (yet).
+    UNSIGNED,  // Scalars, stored in _u64_, _s64_ or _f64_.
+    SIGNED,
+    FLOAT,
+    BOOL,
+    BYTES,     // Raw bytes of a [..] u8 / char field, stored in _data_, held by _buffer_.
+    VIEW,      // Raw bytes of the source, in _view_, held by _buffer_ when the source is shared.
+    ARRAY,     // Scalars of _base_type_ in native byte order, stored in _data_.
+    RECORD,    // Decoded struct, one value per field in _values_.
+    LIST,      // Array of structs, one RECORD per element in _values_.
+    LAZY       // _count_ elements of _base_type_ not read yet, at source offset _u64_.
+};
+
+/*
+ * A decoded value.
+ */
+struct Value {
+    ValueType type;
+    AstTypeInfo base_type;  // builtin type the value was decoded from.
+    uint64_t count;         // elements of BYTES, ARRAY, LIST and LAZY, fields of RECORD.
+    union {
+        uint64_t u64;
+        int64_t s64;
+        double f64;
+        uint8_t *data;
+        const uint8_t *view;
+        Value *values;
+    };
+    SharedBuffer *buffer;   // reference keeping the bytes of BYTES and VIEW alive.
+};
+
+/*
+ * Allocates the storage of a RECORD or LIST with _count_ values.
+ */
+Value *value_init_children(Value *value, ValueType type, uint64_t count);
+
+/*
+ * Allocates the storage of BYTES or ARRAY with _byte_size_ bytes, BYTES are
+ * put in a SharedBuffer so slices of them can outlive the value.
+ */
+uint8_t *value_init_data(Value *value, ValueType type, uint64_t count, uint64_t byte_size);
+
+/*
+ * Points _value_ at _size_ bytes owned by the source, nothing is copied. The
+ * value takes a reference to _buffer_ when the source is shared.
+ */
+void value_init_view(Value *value, const uint8_t *data, uint64_t size, SharedBuffer *buffer = nullptr);
+
+/*
+ * Bytes of a BYTES or VIEW value, holding a reference to their buffer, so
+ * templates nested in a field can be decoded without copying it. An empty
+ * slice for the other types.
+ */
+Slice value_slice(const Value *value);
+
+/*
+ * Records where the _count_ elements of _value_ are in the source, they are
+ * read by decode_materialize when needed. _base_type_ must be already set.
+ */
+void value_init_lazy(Value *value, uint64_t offset, uint64_t count);
+
+/*
+ * Releases everything _value_ owns, _value_ itself is left as NONE.
+ */
+void value_free(Value *value);
+
+}  // namespace astraea
@@ -12,6 +12,8 @@
 namespace astraea {
 
 struct Scope {
+    Scope *parent;  // enclosing scope, null for the module scope.
+
     AstFunction **function_definitions;
     uint32_t num_function_definitions;
 
@@ -22,7 +24,7 @@ struct Scope {
     uint32_t num_variable_definitions;
 };
 
-Scope *scope_init();
+Scope *scope_init(Scope *parent = nullptr);
 
 AstFunction *scope_add_function_definition(Scope *scope, AstFunction *fdef);
 
@@ -32,6 +34,11 @@ AstType *scope_add_typedef(Scope *scope, AstType *type_def);
 
 AstType *scope_get_typedef(Scope *scope, std::string_view type_name);
 
+/*
+ * Looks _type_name_ up in _scope_ and then in every enclosing scope.
+ */
+AstType *scope_lookup_typedef(Scope *scope, std::string_view type_name);
+
 AstVariable *scope_add_variable_definition(Scope *scope, AstVariable *vdef);
 
 AstVariable *scope_get_variable_definition(Scope *scope, const char *name);
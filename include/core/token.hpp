@@ -48,6 +48,7 @@ enum class TokenType : uint32_t {
     EQUAL_EQUAL,
     COLON_EQUAL,
     COLON_COLON,
+    LESSER_LESSER,  // Attribute list.
     LEFT_PAREN,  // Brackets
     RIGHT_PAREN,
     LEFT_BRACE,
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "include/core/ast_types.hpp"
+#include "include/core/runtime.hpp"
+#include "include/utils/endian.hpp"
+#include "include/utils/types.hpp"
+#include <array>
+#include <string_view>
+
+namespace astraea {
+
+/*
+ * Decodes a builtin of _bit_size_ bits stored _bit_offset_ bits into _src_.
+ * Byte sized types expect a byte aligned offset, bit types are read least
+ * significant bit first. _src_ must be readable 8 bytes past the value.
+ */
+using BuiltinDecoder = void (*)(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+
+/*
+ * Interned symbol of an identifier (64-bit FNV-1a of its bytes).
+ */
+constexpr uint64_t
+symbol_of(std::string_view name)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (auto ch : name) {
+        hash ^= (uint8_t)ch;
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+void decode_builtin_unsigned(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_signed(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_u8(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_u16(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_u32(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_u64(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_s8(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_s16(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_s32(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_s64(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_f16(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_f32(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_f64(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_char(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+void decode_builtin_bool(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian endian, Value *out);
+
+struct BuiltinType {
+    char name[8];
+    uint64_t symbol;
+    AstTypeInfo base_type;
+    uint32_t bit_size;  // zero for the width-less aliases (uint, int, float).
+    bool is_signed;
+    uint8_t name_size;  // bytes of _name_ used, it is not null terminated when full.
+    BuiltinDecoder decode;
+
+    constexpr std::string_view
+    type_name() const
+    {
+        return std::string_view{name, name_size};
+    }
+};
+
+namespace detail {
+
+constexpr BuiltinType
+make_builtin(std::string_view name, AstTypeInfo base_type, uint32_t bit_size, bool is_signed, BuiltinDecoder decode)
+{
+    auto builtin = BuiltinType{};
+    for (size_t i = 0; i < name.size(); i += 1) {
+        builtin.name[i] = name[i];
+    }
+    builtin.name_size = (uint8_t)name.size();
+    builtin.symbol = symbol_of(name);
+    builtin.base_type = base_type;
+    builtin.bit_size = bit_size;
+    builtin.is_signed = is_signed;
+    builtin.decode = decode;
+    return builtin;
+}
+
+constexpr BuiltinType
+make_integer(char prefix, uint32_t bits)
+{
+    char name[4] = {prefix, 0, 0, 0};
+    size_t size = 1;
+    if (bits >= 10) {
+        name[size++] = (char)('0' + bits / 10);
+    }
+    name[size++] = (char)('0' + bits % 10);
+
+    auto is_signed = prefix == 's';
+    auto base_type = is_signed ? AstTypeInfo::SIGNED : AstTypeInfo::UNSIGNED;
+    auto decode = is_signed ? &decode_builtin_signed : &decode_builtin_unsigned;
+    switch (bits) {
+    case 8:
+        base_type = is_signed ? AstTypeInfo::S8 : AstTypeInfo::U8;
+        decode = is_signed ? &decode_builtin_s8 : &decode_builtin_u8;
+        break;
+    case 16:
+        base_type = is_signed ? AstTypeInfo::S16 : AstTypeInfo::U16;
+        decode = is_signed ? &decode_builtin_s16 : &decode_builtin_u16;
+        break;
+    case 32:
+        base_type = is_signed ? AstTypeInfo::S32 : AstTypeInfo::U32;
+        decode = is_signed ? &decode_builtin_s32 : &decode_builtin_u32;
+        break;
+    case 64:
+        base_type = is_signed ? AstTypeInfo::S64 : AstTypeInfo::U64;
+        decode = is_signed ? &decode_builtin_s64 : &decode_builtin_u64;
+        break;
+    }
+
+    return make_builtin(std::string_view{name, size}, base_type, bits, is_signed, decode);
+}
+
+constexpr size_t builtin_count = 64 + 64 + 3 + 2 + 3;
+
+constexpr std::array<BuiltinType, builtin_count>
+make_builtin_table()
+{
+    auto table = std::array<BuiltinType, builtin_count>{};
+    size_t n = 0;
+    for (uint32_t bits = 1; bits <= 64; bits += 1) {
+        table[n++] = make_integer('u', bits);
+        table[n++] = make_integer('s', bits);
+    }
+    table[n++] = make_builtin("f16", AstTypeInfo::F16, 16, true, &decode_builtin_f16);
+    table[n++] = make_builtin("f32", AstTypeInfo::F32, 32, true, &decode_builtin_f32);
+    table[n++] = make_builtin("f64", AstTypeInfo::F64, 64, true, &decode_builtin_f64);
+    table[n++] = make_builtin("char", AstTypeInfo::CHAR, 8, false, &decode_builtin_char);
+    table[n++] = make_builtin("bool", AstTypeInfo::BOOL, 8, false, &decode_builtin_bool);
+    table[n++] = make_builtin("uint", AstTypeInfo::UNSIGNED, 0, false, nullptr);
+    table[n++] = make_builtin("int", AstTypeInfo::SIGNED, 0, true, nullptr);
+    table[n++] = make_builtin("float", AstTypeInfo::FLOAT, 0, true, nullptr);
+    return table;
+}
+
+// Open addressing index over the symbols, slot value is table index + 1.
+constexpr size_t builtin_slot_count = 512;
+
+constexpr std::array<uint16_t, builtin_slot_count>
+make_builtin_index(const std::array<BuiltinType, builtin_count> &table)
+{
+    auto slots = std::array<uint16_t, builtin_slot_count>{};
+    for (size_t i = 0; i < builtin_count; i += 1) {
+        auto slot = table[i].symbol & (builtin_slot_count - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (builtin_slot_count - 1);
+        }
+        slots[slot] = (uint16_t)(i + 1);
+    }
+    return slots;
+}
+
+}  // namespace detail
+
+inline constexpr auto builtin_types = detail::make_builtin_table();
+inline constexpr auto builtin_index = detail::make_builtin_index(builtin_types);
+
+/*
+ * Looks up the builtin type named _name_, null if it is not a builtin.
+ */
+constexpr const BuiltinType *
+type_registry_find(std::string_view name)
+{
+    auto symbol = symbol_of(name);
+    auto slot = symbol & (detail::builtin_slot_count - 1);
+    while (builtin_index[slot] != 0) {
+        auto builtin = &builtin_types[builtin_index[slot] - 1];
+        if (builtin->symbol == symbol && builtin->type_name() == name) {
+            return builtin;
+        }
+        slot = (slot + 1) & (detail::builtin_slot_count - 1);
+    }
+
+    return nullptr;
+}
+
+/*
+ * Looks up the canonical builtin of _base_type_ (u16 for U16, uint for
+ * UNSIGNED, ...).
+ */
+const BuiltinType *type_registry_find(AstTypeInfo base_type);
+
+/*
+ * Kind of value a builtin decodes to.
+ */
+ValueType value_type_of(AstTypeInfo base_type);
+
+static_assert(type_registry_find("u5")->bit_size == 5, "bit types must be registered");
+static_assert(type_registry_find("s64")->base_type == AstTypeInfo::S64, "byte types keep their base type");
+static_assert(type_registry_find("u65") == nullptr, "widths are limited to 64 bits");
+
+}  // namespace astraea
@@ -7,24 +7,189 @@
  */
 #pragma once
 #include "include/core/ast.hpp"
+#include "include/utils/types.hpp"
+#include <cstdlib>
 
 namespace astraea {
 
 // IWYU pragma: private, include "scope.hpp"
 struct Scope;
 
-struct Visitor {
-    Scope *current_scope = nullptr;
+/*
+ * Tells the walker how to proceed after a node was entered.
+ */
+enum class WalkAction : uint32_t {
+    CONTINUE,       // Descend into the children of the node.
+    SKIP_CHILDREN,  // Do not descend, carry on with the next sibling.
+    STOP            // Abort the whole traversal.
 };
 
-AstNode *visitor_visit(Visitor *visitor, AstNode *node);
+struct WalkFrame {
+    AstNode *node;        // node whose children are being visited.
+    uint32_t next_child;  // index of the next child to be visited.
+};
+
+/*
+ * Non-recursive AST traversal shared by every compiler pass.
+ *
+ * A pass derives from AstWalker<Pass> and shadows the hooks it cares about,
+ * hooks are resolved at compile time. Pending nodes live in an explicit work
+ * stack that is kept between walks, so visiting a node never allocates and
+ * deeply nested structs do not grow the native stack.
+ */
+template <typename Pass>
+struct AstWalker {
+    WalkFrame *frames = nullptr;
+    uint32_t frame_count = 0;
+    uint32_t frame_capacity = 0;
+
+    AstWalker() = default;
+    AstWalker(const AstWalker &) = delete;
+    AstWalker &operator=(const AstWalker &) = delete;
+
+    ~AstWalker()
+    {
+        std::free(frames);
+    }
+
+    /*
+     * Visits _root_ and all of its descendants in depth-first order.
+     * Returns false if a hook stopped the traversal.
+     */
+    bool
+    walk(AstNode *root)
+    {
+        frame_count = 0;
+        if (!root) return true;
+
+        auto action = enter(root);
+        if (WalkAction::STOP == action) return false;
+        if (WalkAction::CONTINUE == action) push_frame(root);
+
+        while (frame_count > 0) {
+            auto &frame = frames[frame_count - 1];
+            if (frame.next_child >= ast_child_count(frame.node)) {
+                leave(frame.node);
+                frame_count -= 1;
+                continue;
+            }
+
+            auto child = ast_child(frame.node, frame.next_child);
+            frame.next_child += 1;
+            if (!child) continue;
+
+            action = enter(child);
+            if (WalkAction::STOP == action) return false;
+            if (WalkAction::CONTINUE == action) push_frame(child);
+        }
 
-AstNode *visitor_visit_compound(Visitor *visitor, AstNode *node);
+        return true;
+    }
 
-AstNode *visitor_visit_function_definition(Visitor *visitor, AstNode *node);
+    /*
+     * Number of nodes currently open above the visited node.
+     */
+    uint32_t
+    depth() const
+    {
+        return frame_count;
+    }
 
-AstNode *visitor_visit_type_definition(Visitor *visitor, AstNode *node);
+    // Default hooks, shadow them in the pass.
+    WalkAction enter_compound(AstCompound *) { return WalkAction::CONTINUE; }
+    void leave_compound(AstCompound *) {}
+    WalkAction visit_function_definition(AstFunction *) { return WalkAction::CONTINUE; }
+    void leave_function_definition(AstFunction *) {}
+    WalkAction visit_type_definition(AstType *) { return WalkAction::CONTINUE; }
+    void leave_type_definition(AstType *) {}
+    WalkAction visit_variable_definition(AstVariable *) { return WalkAction::CONTINUE; }
+    WalkAction visit_expression(AstNode *) { return WalkAction::CONTINUE; }
 
-AstNode *visitor_visit_variable_definition(Visitor *visitor, AstNode *node);
+private:
+    Pass *
+    pass()
+    {
+        return static_cast<Pass *>(this);
+    }
+
+    WalkAction
+    enter(AstNode *node)
+    {
+        switch (node->node_type) {
+        case AstNodeType::COMPOUND:
+            return pass()->enter_compound((AstCompound *)node);
+        case AstNodeType::FUNCTION_DEFINITION:
+            return pass()->visit_function_definition((AstFunction *)node);
+        case AstNodeType::TYPE_DEFINITION:
+            return pass()->visit_type_definition((AstType *)node);
+        case AstNodeType::VARIABLE_DEFINITION:
+            return pass()->visit_variable_definition((AstVariable *)node);
+        case AstNodeType::EXPRESSION:
+        case AstNodeType::EXPRESSION_STRING:
+        case AstNodeType::OPERATION:
+            return pass()->visit_expression(node);
+        case AstNodeType::CONSTANT_DEFINITION:
+        case AstNodeType::NO_OPERATION:
+            return WalkAction::SKIP_CHILDREN;
+        }
+
+        return WalkAction::SKIP_CHILDREN;
+    }
+
+    void
+    leave(AstNode *node)
+    {
+        switch (node->node_type) {
+        case AstNodeType::COMPOUND:
+            pass()->leave_compound((AstCompound *)node);
+            break;
+        case AstNodeType::FUNCTION_DEFINITION:
+            pass()->leave_function_definition((AstFunction *)node);
+            break;
+        case AstNodeType::TYPE_DEFINITION:
+            pass()->leave_type_definition((AstType *)node);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void
+    push_frame(AstNode *node)
+    {
+        if (frame_count == frame_capacity) {
+            auto new_capacity = frame_capacity ? frame_capacity * 2 : 32;
+            auto reallocated_buffer = (WalkFrame *)std::realloc(frames, new_capacity * sizeof(WalkFrame));
+            if (!reallocated_buffer) {
+                std::exit(1);
+            }
+            frames = reallocated_buffer;
+            frame_capacity = new_capacity;
+        }
+
+        frames[frame_count] = WalkFrame{node, 0};
+        frame_count += 1;
+    }
+};
+
+/*
+ * Scope building pass, registers every definition in the scope of the
+ * compound block that declares it.
+ */
+struct Visitor : AstWalker<Visitor> {
+    Scope *current_scope = nullptr;
+
+    WalkAction enter_compound(AstCompound *compound);
+    void leave_compound(AstCompound *compound);
+    WalkAction visit_function_definition(AstFunction *func_def);
+    WalkAction visit_type_definition(AstType *type_def);
+    void leave_type_definition(AstType *type_def);
+    WalkAction visit_variable_definition(AstVariable *var_def);
+};
+
+/*
+ * Runs the scope building pass over _node_, returns _node_.
+ */
+AstNode *visitor_visit(Visitor *visitor, AstNode *node);
 
-}  // namespace astraea
\ No newline at end of file
+}  // namespace astraea
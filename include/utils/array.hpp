@@ -6,109 +6,470 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #pragma once
+#include "platform.hpp"
+#include "sharedbuffer.hpp"
 #include "types.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef OS_WINDOWS
+#include <malloc.h>
+#endif
 
 #define MIN_ARRAY_LEN 8
 
+// Alignment of the heap storage of arrays, a full AVX2 register.
+#define ARRAY_ALIGNMENT 32
+
+/*
+ * Allocates _byte_size_ bytes aligned to _alignment_ (a power of two, at
+ * least ARRAY_ALIGNMENT), exits if there is not enough memory.
+ */
+inline void *
+array_allocate(uint64_t byte_size, size_t alignment)
+{
+    auto rounded = (byte_size + alignment - 1) & ~(uint64_t)(alignment - 1);
+    if (rounded < byte_size || rounded > SIZE_MAX) {
+        std::exit(1);
+    }
+#ifdef OS_WINDOWS
+    auto data = _aligned_malloc((size_t)rounded, alignment);
+#else
+    auto data = std::aligned_alloc(alignment, (size_t)rounded);
+#endif
+    if (!data) {
+        std::exit(1);
+    }
+
+    return data;
+}
+
+inline void
+array_deallocate(void *data)
+{
+#ifdef OS_WINDOWS
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+
+/*
+ * Bytes of the elements kept inside of the array itself, none by default.
+ */
+template <typename Type, uint32_t inline_count>
+struct ArrayInlineStorage {
+    alignas(Type) unsigned char bytes[inline_count * sizeof(Type)];
+};
+
 template <typename Type>
+struct ArrayInlineStorage<Type, 0> {
+};
+
+/*
+ * Growable array of _Type_.
+ *
+ * The heap storage is aligned to ARRAY_ALIGNMENT so SIMD kernels can use
+ * aligned loads from the first element. Up to _inline_count_ elements are
+ * stored inside of the array without touching the heap. Capacity doubles
+ * when full, so pushing is amortized constant time.
+ *
+ * Trivially copyable elements are moved with memcpy, other types are copied,
+ * moved and destroyed properly.
+ *
+ * An array can also share elements held by a SharedBuffer (see
+ * Array::shared_from), copying it then only takes a reference. Shared elements
+ * are copied to storage of the array before they are modified.
+ */
+template <typename Type, uint32_t inline_count = 0>
 struct Array {
     Type *data;          // pointer to the elements in the array.
-    uint32_t count;      // number of elements stored in the array.
-    uint32_t capacity;   // number of allocated slots in the array.
-    bool is_unique : 1;  // whether the array owns its memory or not.
+    uint64_t count;      // number of elements stored in the array.
+    uint64_t capacity;   // number of allocated slots in the array.
+    SharedBuffer *shared;  // holds the elements when they are shared, null when the array owns them.
+    [[no_unique_address]] ArrayInlineStorage<Type, inline_count> storage;
+
+    static constexpr bool is_trivial = std::is_trivially_copyable_v<Type>;
 
-    Array(uint32_t reserve_count = 0)
+    Array(uint64_t reserve_count = 0)
     {
-        this->count = 0;
-        if (!reserve_count) {
-            this->capacity = 0;
-            this->data = nullptr;
-            this->is_unique = true;
-            return;
+        init_empty();
+        if (reserve_count) {
+            reserve(reserve_count);
+        }
+    }
+
+    Array(const Array &other)
+    {
+        init_empty();
+        if (other.shared) {
+            share(other.shared, other.data, other.count);
+        } else {
+            append(other.data, other.count);
         }
-        this->capacity = reserve_count > MIN_ARRAY_LEN ? reserve_count : MIN_ARRAY_LEN;
-        this->data = (Type *)std::calloc((size_t)this->capacity, sizeof(Type));
-        this->is_unique = true;
+    }
+
+    Array(Array &&other) noexcept
+    {
+        init_empty();
+        take(other);
     }
 
     ~Array()
     {
-        if (data != nullptr && is_unique) {
-            std::free(data);
+        release();
+    }
+
+    Array &
+    operator=(const Array &other)
+    {
+        if (this != &other) {
+            clear();
+            if (other.shared) {
+                free_storage();
+                init_empty();
+                share(other.shared, other.data, other.count);
+            } else {
+                append(other.data, other.count);
+            }
         }
+        return *this;
     }
 
-    auto
+    /*
+     * Array of the _count_ elements at _elements_, held by _buffer_. Takes a
+     * reference, the elements are not copied.
+     */
+    static Array
+    shared_from(SharedBuffer *buffer, const Type *elements, uint64_t count)
+    {
+        static_assert(is_trivial, "only trivially copyable elements can be shared");
+        auto array = Array{};
+        array.share(buffer, elements, count);
+        return array;
+    }
+
+    Array &
+    operator=(Array &&other) noexcept
+    {
+        if (this != &other) {
+            release();
+            init_empty();
+            take(other);
+        }
+        return *this;
+    }
+
+    Type &
+    operator[](uint64_t index)
+    {
+        assert(index < this->count);
+        return this->data[index];
+    }
+
+    const Type &
+    operator[](uint64_t index) const
+    {
+        assert(index < this->count);
+        return this->data[index];
+    }
+
+    Type *
     begin()
     {
         return this->data;
     }
 
-    auto
+    Type *
     end()
     {
         return this->data ? this->data + this->count : nullptr;
     }
 
+    const Type *
+    begin() const
+    {
+        return this->data;
+    }
+
+    const Type *
+    end() const
+    {
+        return this->data ? this->data + this->count : nullptr;
+    }
+
+    bool
+    is_inline() const
+    {
+        if constexpr (inline_count > 0) {
+            return (const void *)this->data == (const void *)this->storage.bytes;
+        }
+        return false;
+    }
+
+    /*
+     * Makes room for _new_capacity_ elements, at least doubling the current
+     * capacity.
+     */
     void
-    push(Type element)
+    reserve(uint64_t new_capacity)
     {
-        maybe_grow(array);
-        this->data[this->count] = element;
+        if (new_capacity <= this->capacity && !this->shared) {
+            return;
+        }
+
+        new_capacity = std::max({new_capacity, this->capacity * 2, (uint64_t)MIN_ARRAY_LEN});
+        uint64_t byte_size = 0;
+        if (!checked_mul<uint64_t>(new_capacity, sizeof(Type), &byte_size)) {
+            std::exit(1);
+        }
+
+        auto new_data = (Type *)array_allocate(byte_size, std::max<size_t>(ARRAY_ALIGNMENT, alignof(Type)));
+        relocate(new_data, this->data, this->count);
+        free_storage();
+        this->data = new_data;
+        this->capacity = new_capacity;
+        this->shared = nullptr;
+    }
+
+    void
+    push(const Type &element)
+    {
+        if (this->count == this->capacity || this->shared) {
+            auto copy = Type(element);  // _element_ may live in the storage being replaced.
+            reserve(this->count + 1);
+            new (this->data + this->count) Type(std::move(copy));
+        } else {
+            new (this->data + this->count) Type(element);
+        }
         this->count += 1;
     }
 
     void
-    pop(Type element)
-    {
-        for (uint32_t i = 0; i < this->count; i += 1) {
-            if (std::memcmp(&this->data[i], &element, sizeof(Type)) == 0) {
-                uint32_t next_at = i + 1;
-                if (next_at < this->count) {
-                    int32_t n_after = this->count - next_at;
-                    std::memmove(
-                        &this->data[i],
-                        &this->data[next_at],
-                        n_after * sizeof(Type));
-                    uint32_t reset_at = i + n_after;
-                    assert(reset_at < this->count);
-                    std::memset(&this->data[reset_at], 0, sizeof(Type));
-                } else {
-                    std::memset(&this->data[i], 0, sizeof(Type));
-                }
-                this->count -= 1;
-                break;
+    push(Type &&element)
+    {
+        if (this->count == this->capacity || this->shared) {
+            auto moved = Type(std::move(element));
+            reserve(this->count + 1);
+            new (this->data + this->count) Type(std::move(moved));
+        } else {
+            new (this->data + this->count) Type(std::move(element));
+        }
+        this->count += 1;
+    }
+
+    /*
+     * Appends copies of the _append_count_ elements at _elements_.
+     */
+    void
+    append(const Type *elements, uint64_t append_count)
+    {
+        if (!append_count) {
+            return;
+        }
+        reserve(this->count + append_count);
+        if constexpr (is_trivial) {
+            std::memcpy((void *)(this->data + this->count), elements, (size_t)(append_count * sizeof(Type)));
+        } else {
+            std::uninitialized_copy(elements, elements + append_count, this->data + this->count);
+        }
+        this->count += append_count;
+    }
+
+    /*
+     * Removes and returns the last element.
+     */
+    Type
+    pop()
+    {
+        assert(this->count > 0);
+        make_unique();
+        this->count -= 1;
+        auto element = Type(std::move(this->data[this->count]));
+        this->data[this->count].~Type();
+        return element;
+    }
+
+    /*
+     * Removes the element at _index_, the elements after it move down.
+     */
+    void
+    remove_at(uint64_t index)
+    {
+        assert(index < this->count);
+        make_unique();
+        std::move(this->data + index + 1, this->data + this->count, this->data + index);
+        this->count -= 1;
+        this->data[this->count].~Type();
+    }
+
+    /*
+     * Removes the element at _index_ in constant time, the last element
+     * takes its place.
+     */
+    void
+    swap_remove(uint64_t index)
+    {
+        assert(index < this->count);
+        make_unique();
+        this->count -= 1;
+        if (index != this->count) {
+            this->data[index] = std::move(this->data[this->count]);
+        }
+        this->data[this->count].~Type();
+    }
+
+    /*
+     * Changes the number of elements, new elements are value initialized
+     * (zero for basic types).
+     */
+    void
+    resize(uint64_t new_count)
+    {
+        if (new_count < this->count) {
+            make_unique();
+            destroy(this->data + new_count, this->count - new_count);
+        } else if (new_count > this->count) {
+            reserve(new_count);
+            std::uninitialized_value_construct(this->data + this->count, this->data + new_count);
+        }
+        this->count = new_count;
+    }
+
+    /*
+     * Changes the number of elements, new elements of trivial types are left
+     * uninitialized for the caller to fill, like bulk reads do.
+     */
+    void
+    resize_for_overwrite(uint64_t new_count)
+    {
+        if constexpr (is_trivial) {
+            if (new_count > this->count) {
+                reserve(new_count);
             }
+            this->count = new_count;
+        } else {
+            resize(new_count);
+        }
+    }
+
+    void
+    clear()
+    {
+        if (!this->shared) {
+            destroy(this->data, this->count);
+        }
+        this->count = 0;
+    }
+
+private:
+    void
+    init_empty()
+    {
+        this->count = 0;
+        this->shared = nullptr;
+        if constexpr (inline_count > 0) {
+            this->data = (Type *)this->storage.bytes;
+            this->capacity = inline_count;
+        } else {
+            this->data = nullptr;
+            this->capacity = 0;
+        }
+    }
+
+    /*
+     * Points the (empty) array at elements held by _buffer_.
+     */
+    void
+    share(SharedBuffer *buffer, const Type *elements, uint64_t share_count)
+    {
+        assert(buffer);
+        this->data = (Type *)elements;
+        this->count = share_count;
+        this->capacity = share_count;
+        this->shared = shared_buffer_retain(buffer);
+    }
+
+    /*
+     * Copies shared elements, so they can be modified.
+     */
+    void
+    make_unique()
+    {
+        if (this->shared) {
+            reserve(this->count);
         }
     }
 
     static void
-    resize(Array<Type> &array, uint32_t new_capacity)
+    destroy(Type *elements, uint64_t destroy_count)
     {
-        array.capacity = is_pow2(new_capacity) ? new_capacity : new_capacity + 1;
-        assert(array.capacity >= new_capacity);
-        array.count = std::min(array.count, array.capacity);
+        if constexpr (!std::is_trivially_destructible_v<Type>) {
+            std::destroy(elements, elements + destroy_count);
+        }
+    }
 
-        Type *new_data = (Type *)std::calloc((size_t)array.capacity, sizeof(Type));
-        if (new_data && array.count > 0) {
-            std::memcpy(new_data, array.data, sizeof(Type) * array.count);
+    /*
+     * Moves the elements of the current storage to _new_data_. Shared
+     * elements are copied, they still belong to the buffer.
+     */
+    void
+    relocate(Type *new_data, Type *old_data, uint64_t move_count)
+    {
+        if (!move_count) {
+            return;
         }
-        if (array.data && array.is_unique) {
-            std::free(array.data);
+        if constexpr (is_trivial) {
+            std::memcpy((void *)new_data, old_data, (size_t)(move_count * sizeof(Type)));
+        } else if (!this->shared) {
+            std::uninitialized_move(old_data, old_data + move_count, new_data);
+            destroy(old_data, move_count);
+        } else {
+            std::uninitialized_copy(old_data, old_data + move_count, new_data);
         }
+    }
 
-        array.data = new_data;
-        array.is_unique = true;
+    void
+    free_storage()
+    {
+        if (this->shared) {
+            shared_buffer_release(this->shared);
+        } else if (this->data && !is_inline()) {
+            array_deallocate(this->data);
+        }
     }
 
-    static void
-    maybe_grow(Array<Type> &array)
+    void
+    release()
+    {
+        clear();
+        free_storage();
+    }
+
+    /*
+     * Takes the elements of _other_ (freshly initialized _this_), leaving it
+     * empty. Heap storage is stolen, inline elements are moved one by one.
+     */
+    void
+    take(Array &other)
     {
-        if (array.count + 1 < array.capacity) {
+        if (other.is_inline()) {
+            relocate(this->data, other.data, other.count);
+            this->count = other.count;
+            other.count = 0;
             return;
         }
-        array_resize<Type>(array, array.count + MIN_ARRAY_LEN);
+
+        this->data = other.data;
+        this->count = other.count;
+        this->capacity = other.capacity;
+        this->shared = other.shared;
+        other.init_empty();
     }
 };
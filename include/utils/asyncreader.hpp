@@ -0,0 +1,124 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"  // IWYU pragma: export
+#include <cstring>
+
+namespace binaryreader {
+
+// Bytes fetched by one asynchronous read.
+#define ASYNC_READER_BLOCK_SIZE (256 * 1024)
+
+// Blocks cached (and in flight) per file.
+#define ASYNC_READER_SLOTS 32
+
+// Workers of the pread fallback, I/O bound so not tied to the core count.
+#define ASYNC_READER_THREADS 4
+
+enum class AsyncBackend : uint32_t {
+    IO_URING,    // Linux io_uring, submitted and reaped by the reading thread.
+    THREAD_POOL  // Positional reads on worker threads.
+};
+
+// IWYU pragma: private, block cache and backend state.
+struct AsyncState;
+
+/*
+ * Read-only file whose reads are served from a cache of blocks fetched
+ * ahead of time. Sequential reads keep _readahead_ blocks in flight past
+ * the current one, prefetch() queues any other region (the target of an
+ * offset field, the next records of a table) so its I/O overlaps decoding.
+ */
+struct AsyncFile {
+    AsyncState *state;
+    AsyncBackend backend;
+    uint64_t size;
+    uint64_t pos;
+    const uint8_t *window;  // contents of the ready block holding _pos_, if any.
+    uint64_t window_offset;
+    uint32_t window_size;
+};
+
+/*
+ * Opens _file_path_, io_uring is used when the kernel allows it.
+ */
+bool open_async(AsyncFile *file, Path file_path, uint32_t readahead = 4);
+
+/*
+ * Waits for the reads in flight and closes the file.
+ */
+void close_async(AsyncFile *file);
+
+/*
+ * Starts reading the blocks covering _size_ bytes at _offset_, returns
+ * without waiting. Blocks beyond the cache capacity are not queued.
+ */
+void prefetch(AsyncFile &file, uint64_t offset, uint64_t size);
+
+/*
+ * Waits for the blocks under the current offset, or reads the cache misses.
+ */
+bool async_read_slow(AsyncFile &file, void *r_data, uint64_t size);
+
+inline void
+prefetch_ahead(AsyncFile &file, uint64_t size)
+{
+    prefetch(file, file.pos, size);
+}
+
+inline uint64_t
+tell(AsyncFile &file)
+{
+    return file.pos;
+}
+
+inline void
+seek(AsyncFile &file, uint64_t pos)
+{
+    file.pos = pos;
+}
+
+inline uint64_t
+file_size(AsyncFile &file)
+{
+    return file.size;
+}
+
+inline bool
+read_bytes(AsyncFile &file, void *r_data, uint64_t size)
+{
+    auto window_pos = file.pos - file.window_offset;
+    if (file.window && file.pos >= file.window_offset && window_pos <= file.window_size &&
+        size <= file.window_size - window_pos) {
+        std::memcpy(r_data, file.window + window_pos, (size_t)size);
+        file.pos += size;
+        return true;
+    }
+
+    return async_read_slow(file, r_data, size);
+}
+
+inline void
+skip(AsyncFile &file, uint64_t size)
+{
+    file.pos = saturating_add(file.pos, size);
+}
+
+inline bool
+read_lazy(AsyncFile &file, uint64_t size, uint64_t *out_offset)
+{
+    if (file.pos > file.size || size > file.size - file.pos) {
+        return false;
+    }
+
+    *out_offset = file.pos;
+    file.pos += size;
+    return true;
+}
+
+}  // namespace binaryreader
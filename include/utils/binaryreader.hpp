@@ -11,7 +11,6 @@
 #include "platform_string.hpp"
 #include <filesystem>
 #include <fstream>
-#include <limits>
 
 namespace binaryreader {
 
@@ -21,15 +20,25 @@ using Path = std::filesystem::path;
 using Stream = std::iostream;
 
 /*
- * Opens a file handle.
+ * Bytes of the source handed out without copying them. _buffer_ holds them
+ * when the source is shared, the view itself does not own a reference.
+ */
+struct ByteView {
+    const uint8_t *data;
+    uint64_t size;
+    SharedBuffer *buffer;
+};
+
+/*
+ * Opens a file handle for reading.
  */
 inline File
 open_file(Path file_path)
 {
 #ifdef OS_WINDOWS
-    return File(platform::utf8_to_winapi(file_path.string()), File::in | File::out | File::binary);
+    return File(platform::utf8_to_winapi(file_path.string()), File::in | File::binary);
 #elif defined OS_POSIX
-    return File(file_path.string(), File::in | File::out | File::binary);
+    return File(file_path.string(), File::in | File::binary);
 #endif
 }
 
@@ -48,7 +57,7 @@ close_file(File &file)
 inline Offset
 tell(Stream &file)
 {
-    return file.tellp();
+    return file.tellg();
 }
 
 /**
@@ -57,37 +66,137 @@ tell(Stream &file)
 inline void
 seek(Stream &file, Offset pos)
 {
-    file.seekp(pos);
+    file.clear();  // a failed read would make the seek fail too.
+    file.seekg(pos);
     if (file.bad()) {
         // std::cerr << "Error while seeking pos in file." << std::endl;
     }
 }
 
+/*
+ * Size of the stream, found by seeking to its end instead of reading it.
+ */
 inline uint64_t
 file_size(Stream &file)
 {
     auto old_pos = tell(file);
-    seek(file, 0x0);
-    file.ignore(std::numeric_limits<std::streamsize>::max());
-    auto lenght = file.gcount();
+    file.seekg(0, std::ios::end);
+    auto lenght = tell(file);
     file.clear();
     seek(file, old_pos);
 
-    return (uint64_t)lenght;
+    return lenght < 0 ? 0 : (uint64_t)lenght;
+}
+
+/*
+ * Reads _size_ raw bytes into _r_data_, returns false if the stream ended
+ * before all of them could be read.
+ */
+inline bool
+read_bytes(Stream &file, void *r_data, uint64_t size)
+{
+    file.read(reinterpret_cast<char *>(r_data), (std::streamsize)size);
+    return !file.fail();
+}
+
+/*
+ * Advances the stream _size_ bytes without reading them.
+ */
+inline void
+skip(Stream &file, uint64_t size)
+{
+    if (size > (uint64_t)INT64_MAX) {
+        file.seekg(0, std::ios::end);  // past the end of any stream, the next read fails.
+        return;
+    }
+    file.seekg((std::streamoff)size, std::ios::cur);
+}
+
+/*
+ * Hands out the next _size_ bytes without copying them. Readers that cannot
+ * do it return false and the caller falls back to read_bytes.
+ */
+template <typename Reader>
+inline bool
+read_view(Reader &, uint64_t, ByteView *)
+{
+    return false;
 }
 
 /*
- * Reads basic type from stream.
+ * Skips the next _size_ bytes and returns their offset, so they can be read
+ * later. Readers that cannot seek back return false and the caller reads
+ * the bytes right away.
  */
-template <typename Type>
+template <typename Reader>
+inline bool
+read_lazy(Reader &, uint64_t, uint64_t *)
+{
+    return false;
+}
+
+inline bool
+read_lazy(Stream &file, uint64_t size, uint64_t *out_offset)
+{
+    auto offset = tell(file);
+    if (offset < 0 || size > (uint64_t)INT64_MAX) {
+        return false;
+    }
+
+    // Reads the last byte instead of asking the size of the stream, that costs two more seeks per field.
+    if (size > 0) {
+        file.seekg((std::streamoff)(size - 1), std::ios::cur);
+        if (Stream::traits_type::eof() == file.get()) {
+            file.clear();
+            seek(file, offset);
+            return false;
+        }
+    }
+
+    *out_offset = (uint64_t)offset;
+    return true;
+}
+
+/*
+ * Hints that the next _size_ bytes will be read soon. Readers without
+ * asynchronous I/O ignore it.
+ */
+template <typename Reader>
+inline void
+prefetch_ahead(Reader &, uint64_t)
+{
+}
+
+/*
+ * Reads _size_ bytes at _offset_ without moving the offset of _file_,
+ * returns false if it ended before. The default seeks there and back,
+ * readers that can read anywhere without seeking provide their own.
+ */
+template <typename Reader>
+inline bool
+read_at(Reader &file, uint64_t offset, void *r_data, uint64_t size)
+{
+    // Only move when the read is not already at _offset_, seeks drop the stream buffer.
+    auto old_pos = tell(file);
+    if ((uint64_t)old_pos != offset) {
+        seek(file, offset);
+    }
+    auto is_read = read_bytes(file, r_data, size);
+    seek(file, old_pos);
+
+    return is_read;
+}
+
+/*
+ * Reads basic type from any reader, zero if it ended.
+ */
+template <typename Type, typename Reader>
 constexpr auto
-read(Stream &file, Endian endian = Endian::native)
+read(Reader &file, Endian endian = Endian::native)
 {
     auto data = Type{};
-    file.read(reinterpret_cast<char *>(&data), sizeof(Type));
-    if (file.fail()) {
-        // std::cerr << "Error while reading file." << std::endl;
-        // std::cerr << "Only " << fs.gcount() << " bytes could be read." << std::endl;
+    if (!read_bytes(file, &data, sizeof(Type))) {
+        return Type{};
     }
     maybe_endian_swap(&data, 1, endian);
 
@@ -97,16 +206,14 @@ read(Stream &file, Endian endian = Endian::native)
 /*
  * Read an array of _lenght_ Types
  */
-template <typename Type, uint32_t lenght>
+template <typename Type, uint32_t lenght, typename Reader>
 constexpr auto
-read(Stream &file, Endian endian = Endian::native)
-{
-    auto array = Array<Type>(lenght);
-    array.count = lenght;
-    file.read(reinterpret_cast<char *>(array.data), sizeof(Type) * lenght);
-    if (file.fail()) {
-        // std::cerr << "Error while reading file." << std::endl;
-        // std::cerr << "Only " << fs.gcount() << " bytes could be read." << std::endl;
+read(Reader &file, Endian endian = Endian::native)
+{
+    auto array = Array<Type>{};
+    array.resize_for_overwrite(lenght);
+    if (!read_bytes(file, array.data, sizeof(Type) * lenght)) {
+        std::memset((void *)array.data, 0, (size_t)(sizeof(Type) * lenght));
     }
     maybe_endian_swap(array.data, lenght, endian);
 
@@ -114,26 +221,24 @@ read(Stream &file, Endian endian = Endian::native)
 }
 
 /*
- * Read an array of Types from _beg_ till _end_..
+ * Read an array of Types from _beg_ till _end_, the offset is left untouched.
+ * The array is empty when the range goes past the end of the file.
  */
-template <typename Type>
+template <typename Type, typename Reader>
 Array<Type>
-read(Stream &file, Offset begin, Offset end, Endian endian = Endian::native)
+read(Reader &file, uint64_t begin, uint64_t end, Endian endian = Endian::native)
 {
-    assert((end - begin) % sizeof(Type) == 0);
-    // "It's not possible to fit the requested array lenght in the offsets."
-    uint32_t lenght = (uint32_t)(end - begin) / sizeof(Type);
-    auto array = Array<Type>(lenght);
-    array.count = lenght;
-
-    auto old_pos = tell(file);
-    seek(file, begin);
-    file.read(reinterpret_cast<char *>(array.data), sizeof(Type) * lenght);
-    if (file.fail()) {
-        // std::cerr << "Error while reading file." << std::endl;
-        // std::cerr << "Only " << fs.gcount() << " bytes could be read." << std::endl;
+    assert(begin <= end && (end - begin) % sizeof(Type) == 0);
+    uint64_t lenght = (end - begin) / sizeof(Type);
+    auto array = Array<Type>{};
+    auto size = file_size(file);
+    if (begin > size || end - begin > size - begin) {
+        return array;
+    }
+    array.resize_for_overwrite(lenght);
+    if (!read_at(file, begin, array.data, end - begin)) {
+        std::memset((void *)array.data, 0, (size_t)(sizeof(Type) * lenght));
     }
-    seek(file, old_pos);
     maybe_endian_swap(array.data, lenght, endian);
 
     return array;
@@ -142,15 +247,11 @@ read(Stream &file, Offset begin, Offset end, Endian endian = Endian::native)
 /*
  * Read an array of _lenght_ Types to &data.
  */
-template <typename Type, uint32_t lenght>
+template <typename Type, uint32_t lenght, typename Reader>
 void
-read(Stream &file, Type (&r_data)[lenght], Endian endian = Endian::native)
+read(Reader &file, Type (&r_data)[lenght], Endian endian = Endian::native)
 {
-    file.read(reinterpret_cast<char *>(r_data), sizeof(Type) * lenght);
-    if (file.fail()) {
-        // std::cerr << "Error while reading file." << std::endl;
-        // std::cerr << "Only " << fs.gcount() << " bytes could be read." << std::endl;
-    }
+    read_bytes(file, r_data, sizeof(Type) * lenght);
     maybe_endian_swap(r_data, lenght, endian);
 }
 
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"
+#include <cstring>
+
+namespace binarywriter {
+
+using binaryreader::Path;
+
+// Bytes of the user space buffer of sequential writes.
+#define BINARY_WRITER_BUFFER_SIZE (1024 * 1024)
+
+// Patches closer than this are written together, the bytes between them are read back from the file.
+#define PATCH_MERGE_GAP (16 * 1024)
+
+// Largest merged write of a patch commit, overlapping patches are still written together.
+#define PATCH_MAX_EXTENT (8 * 1024 * 1024)
+
+enum class WriterMode : uint32_t {
+    CREATE,  // New or truncated file.
+    PATCH    // Existing file, modified in place.
+};
+
+/*
+ * File written through a buffer with positional writes. Sequential writes
+ * are batched, the first write after a seek flushes the buffer.
+ */
+struct WriterFile {
+    intptr_t handle;         // file descriptor, HANDLE on Windows.
+    uint64_t pos;            // current offset.
+    uint8_t *buffer;         // BINARY_WRITER_BUFFER_SIZE bytes.
+    uint64_t buffer_offset;  // file offset of buffer[0].
+    uint32_t buffer_count;   // bytes waiting in the buffer.
+    bool has_failed;         // a write failed, every later call fails.
+};
+
+/*
+ * Opens _file_path_ for reading and writing, returns false if it could not
+ * be opened (or, in PATCH mode, does not exist).
+ */
+bool open_writer(WriterFile *file, Path file_path, WriterMode mode = WriterMode::CREATE);
+
+/*
+ * Flushes and closes the file, returns false if any write failed.
+ */
+bool close_writer(WriterFile *file);
+
+/*
+ * Writes _size_ bytes at _offset_ straight to the file, the buffer and the
+ * offset are left untouched.
+ */
+bool write_at(WriterFile &file, uint64_t offset, const void *data, uint64_t size);
+
+/*
+ * Reads up to _size_ bytes of the file at _offset_, stopping early at the end
+ * of the file. Returns false on an I/O error, _out_read_count_ gets the bytes
+ * read.
+ */
+bool read_at(WriterFile &file, uint64_t offset, void *r_data, uint64_t size, uint64_t *out_read_count);
+
+bool writer_flush(WriterFile &file);
+
+/*
+ * Flushes the buffer and appends _data_, or writes it directly if it is big.
+ */
+bool writer_write_slow(WriterFile &file, const void *data, uint64_t size);
+
+inline uint64_t
+tell(WriterFile &file)
+{
+    return file.pos;
+}
+
+inline void
+seek(WriterFile &file, uint64_t pos)
+{
+    file.pos = pos;
+}
+
+inline bool
+write_bytes(WriterFile &file, const void *data, uint64_t size)
+{
+    auto is_append = file.pos == file.buffer_offset + file.buffer_count;
+    if (is_append && file.buffer_count + size <= BINARY_WRITER_BUFFER_SIZE && !file.has_failed) {
+        std::memcpy(file.buffer + file.buffer_count, data, (size_t)size);
+        file.buffer_count += (uint32_t)size;
+        file.pos += size;
+        return true;
+    }
+
+    return writer_write_slow(file, data, size);
+}
+
+/*
+ * Writes basic type to the file.
+ */
+template <typename Type>
+bool
+write(WriterFile &file, Type data, Endian endian = Endian::native)
+{
+    maybe_endian_swap(&data, 1, endian);
+    return write_bytes(file, &data, sizeof(Type));
+}
+
+/*
+ * Changes to an existing file, kept in memory until committed. Patches may
+ * overlap, the last one added wins.
+ */
+struct PatchEntry {
+    uint64_t offset;       // in the file.
+    uint64_t size;
+    uint64_t data_offset;  // in the journal data.
+    uint64_t sequence;     // order the patch was added in.
+};
+
+struct PatchJournal {
+    PatchEntry *entries;
+    uint64_t entry_count;
+    uint64_t entry_capacity;
+    uint8_t *data;
+    uint64_t data_size;
+    uint64_t data_capacity;
+};
+
+void patch_journal_init(PatchJournal *journal);
+void patch_journal_free(PatchJournal *journal);
+
+/*
+ * Records that _size_ bytes at _offset_ become _data_.
+ */
+void patch_add(PatchJournal *journal, uint64_t offset, const void *data, uint64_t size);
+
+/*
+ * Writes the journal to _file_ and empties it. Patches are sorted by offset
+ * and merged into extents: neighbours less than PATCH_MERGE_GAP bytes apart
+ * share one read of the gap and one write. _out_write_count_ receives the
+ * number of writes issued.
+ */
+bool patch_commit(PatchJournal *journal, WriterFile &file, uint64_t *out_write_count = nullptr);
+
+}  // namespace binarywriter
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "endian.hpp"
+#include "types.hpp"
+#include <cstring>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace binaryreader {
+
+enum class BitOrder : uint32_t {
+    LSB_FIRST,  // first field in the low bits of each byte (DEFLATE, zip DOS dates).
+    MSB_FIRST   // first field in the high bits of each byte (JPEG, MPEG headers).
+};
+
+// Bits guaranteed in the buffer after a refill, unless the input ended.
+#define BIT_READER_REFILL_BITS 56
+
+// Most fields decoded from a single load by read_bit_run.
+#define BIT_RUN_MAX_FIELDS 16
+
+/*
+ * Reads bit fields from a byte buffer through a 64-bit bit buffer, refilled
+ * with one unaligned 8 byte load while enough input is left.
+ */
+struct BitReader {
+    const uint8_t *data;
+    const uint8_t *end;
+    const uint8_t *next;  // next byte to move into the buffer.
+    uint64_t buffer;      // LSB_FIRST: next bit at bit 0, MSB_FIRST: at bit 63.
+    uint32_t bit_count;   // valid bits in the buffer.
+    BitOrder order;
+    bool overrun;  // a read went past the end, the missing bits read as zero.
+};
+
+/*
+ * Adjacent bit fields extracted from one load, see bit_run_init.
+ */
+struct BitFieldRun {
+    uint64_t masks[BIT_RUN_MAX_FIELDS];  // bits of each field inside of the loaded word.
+    uint8_t shifts[BIT_RUN_MAX_FIELDS];  // position of the lowest bit of each field.
+    uint8_t widths[BIT_RUN_MAX_FIELDS];
+    uint32_t count;
+    uint32_t total_bits;
+    BitOrder order;
+};
+
+inline void
+bit_reader_init(BitReader *reader, const uint8_t *data, uint64_t size, BitOrder order)
+{
+    reader->data = data;
+    reader->end = data + size;
+    reader->next = data;
+    reader->buffer = 0;
+    reader->bit_count = 0;
+    reader->order = order;
+    reader->overrun = false;
+}
+
+/*
+ * Tops the buffer up to at least BIT_READER_REFILL_BITS bits.
+ */
+inline void
+bit_reader_refill(BitReader *reader)
+{
+    auto lsb_first = BitOrder::LSB_FIRST == reader->order;
+    if (reader->end - reader->next >= 8) {
+        uint64_t word;
+        std::memcpy(&word, reader->next, sizeof(word));
+        auto word_endian = lsb_first ? Endian::little : Endian::big;
+        if (Endian::native != word_endian) {
+            word = byte_swap(word);
+        }
+
+        // Bits of the partially inserted byte are inserted again next time.
+        reader->buffer |= lsb_first ? word << reader->bit_count : word >> reader->bit_count;
+        reader->next += (63 - reader->bit_count) >> 3;
+        reader->bit_count |= BIT_READER_REFILL_BITS;
+        return;
+    }
+
+    while (reader->bit_count <= BIT_READER_REFILL_BITS && reader->next < reader->end) {
+        auto byte = (uint64_t)*reader->next;
+        reader->buffer |= lsb_first ? byte << reader->bit_count : byte << (56 - reader->bit_count);
+        reader->next += 1;
+        reader->bit_count += 8;
+    }
+}
+
+/*
+ * Next _bits_ (1 to BIT_READER_REFILL_BITS) bits, without consuming them.
+ */
+inline uint64_t
+bit_reader_peek(BitReader *reader, uint32_t bits)
+{
+    if (BitOrder::MSB_FIRST == reader->order) {
+        return reader->buffer >> (64 - bits);
+    }
+#ifdef __BMI2__
+    return _bzhi_u64(reader->buffer, bits);
+#else
+    return reader->buffer & ((uint64_t{1} << bits) - 1);
+#endif
+}
+
+inline void
+bit_reader_consume(BitReader *reader, uint32_t bits)
+{
+    if (bits > reader->bit_count) {
+        reader->overrun = true;
+        reader->buffer = 0;
+        reader->bit_count = 0;
+        return;
+    }
+
+    if (BitOrder::MSB_FIRST == reader->order) {
+        reader->buffer = bits < 64 ? reader->buffer << bits : 0;
+    } else {
+        reader->buffer = bits < 64 ? reader->buffer >> bits : 0;
+    }
+    reader->bit_count -= bits;
+}
+
+/*
+ * Reads a field of _bits_ (0 to 64) bits.
+ */
+inline uint64_t
+read_bits(BitReader *reader, uint32_t bits)
+{
+    if (bits == 0) {
+        return 0;
+    }
+    if (bits > BIT_READER_REFILL_BITS) {
+        auto first = read_bits(reader, 32);
+        auto second = read_bits(reader, bits - 32);
+        return BitOrder::MSB_FIRST == reader->order ? first << (bits - 32) | second : first | second << 32;
+    }
+
+    if (reader->bit_count < bits) {
+        bit_reader_refill(reader);
+    }
+    auto value = bit_reader_peek(reader, bits);
+    bit_reader_consume(reader, bits);
+
+    return value;
+}
+
+/*
+ * Skips to the beginning of the next byte.
+ */
+inline void
+bit_reader_align(BitReader *reader)
+{
+    bit_reader_consume(reader, reader->bit_count % 8);
+}
+
+/*
+ * Bits consumed since the beginning of the buffer.
+ */
+inline uint64_t
+bit_reader_tell(BitReader *reader)
+{
+    return (uint64_t)(reader->next - reader->data) * 8 - reader->bit_count;
+}
+
+/*
+ * Prepares the extraction of _count_ adjacent fields of _widths_ bits.
+ * Returns false if they do not fit in a single load (more than
+ * BIT_READER_REFILL_BITS bits or BIT_RUN_MAX_FIELDS fields).
+ */
+bool bit_run_init(BitFieldRun *run, const uint8_t *widths, uint32_t count, BitOrder order);
+
+/*
+ * Splits the _run_->total_bits bits of _word_ (first field read first) into
+ * the fields of _run_. Uses pext when the CPU has BMI2.
+ */
+void extract_bit_run(uint64_t word, const BitFieldRun *run, uint64_t *out);
+
+/*
+ * Reads all the fields of _run_ with a single refill and peek.
+ */
+inline bool
+read_bit_run(BitReader *reader, const BitFieldRun *run, uint64_t *out)
+{
+    if (reader->bit_count < run->total_bits) {
+        bit_reader_refill(reader);
+    }
+    if (reader->bit_count < run->total_bits) {
+        reader->overrun = true;
+        return false;
+    }
+
+    auto word = bit_reader_peek(reader, run->total_bits);
+    bit_reader_consume(reader, run->total_bits);
+    extract_bit_run(word, run, out);
+    return true;
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"  // IWYU pragma: export
+#include <cstring>
+
+namespace binaryreader {
+
+// Bytes of the user space buffer, bigger reads go straight to the caller.
+#define BUFFERED_READER_SIZE (1024 * 1024)
+
+/*
+ * Read-only file read through a big buffer with positional reads, so seeking
+ * is free and the OS is asked to read ahead of the buffer. The size comes
+ * from the file system, opening does not touch the contents.
+ */
+struct BufferedFile {
+    intptr_t handle;         // file descriptor, HANDLE on Windows.
+    uint64_t size;           // bytes in the file.
+    uint64_t pos;            // current offset.
+    uint8_t *buffer;         // BUFFERED_READER_SIZE bytes.
+    uint64_t buffer_offset;  // file offset of buffer[0].
+    uint32_t buffer_count;   // valid bytes in the buffer.
+};
+
+/*
+ * Opens _file_path_ for reading, returns false if it could not be opened.
+ */
+bool open_buffered(BufferedFile *file, Path file_path);
+
+void close_buffered(BufferedFile *file);
+
+/*
+ * Reads _size_ bytes at _offset_ without moving the offset or the buffer,
+ * returns false if the file ended before.
+ */
+bool read_at(BufferedFile &file, uint64_t offset, void *r_data, uint64_t size);
+
+/*
+ * Asks the OS to start reading _size_ bytes at _offset_ in the background.
+ */
+void read_ahead(BufferedFile &file, uint64_t offset, uint64_t size);
+
+/*
+ * Refills the buffer from the current offset, or reads directly into
+ * _r_data_ for big reads.
+ */
+bool buffered_read_slow(BufferedFile &file, void *r_data, uint64_t size);
+
+inline uint64_t
+tell(BufferedFile &file)
+{
+    return file.pos;
+}
+
+/*
+ * Seeks to _pos_, no system call is made.
+ */
+inline void
+seek(BufferedFile &file, uint64_t pos)
+{
+    file.pos = pos;
+}
+
+inline uint64_t
+file_size(BufferedFile &file)
+{
+    return file.size;
+}
+
+inline bool
+read_bytes(BufferedFile &file, void *r_data, uint64_t size)
+{
+    auto buffer_pos = file.pos - file.buffer_offset;
+    if (file.pos >= file.buffer_offset && buffer_pos <= file.buffer_count && size <= file.buffer_count - buffer_pos) {
+        std::memcpy(r_data, file.buffer + buffer_pos, (size_t)size);
+        file.pos += size;
+        return true;
+    }
+
+    return buffered_read_slow(file, r_data, size);
+}
+
+inline void
+skip(BufferedFile &file, uint64_t size)
+{
+    file.pos = saturating_add(file.pos, size);
+}
+
+inline bool
+read_lazy(BufferedFile &file, uint64_t size, uint64_t *out_offset)
+{
+    if (file.pos > file.size || size > file.size - file.pos) {
+        return false;
+    }
+
+    *out_offset = file.pos;
+    file.pos += size;
+    return true;
+}
+
+}  // namespace binaryreader
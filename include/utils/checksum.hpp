@@ -0,0 +1,233 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "streamreader.hpp"  // IWYU pragma: export
+#include <algorithm>
+
+namespace binaryreader {
+
+// Bytes read at a time when hashing a region that was skipped.
+#define CHECKSUM_CATCH_UP_CHUNK (16 * 1024)
+
+enum class ChecksumKind : uint32_t {
+    CRC32,   // ZIP, PNG, gzip (reflected 0x04C11DB7).
+    CRC32C,  // Castagnoli, iSCSI, ext4, Btrfs.
+    ADLER32  // zlib streams.
+};
+
+/*
+ * The update functions take and return the final checksum, like zlib: start
+ * CRCs at 0 and Adler-32 at 1, and feed the data in any number of pieces.
+ *
+ * CRC-32 folds with carry-less multiplication (PCLMULQDQ) and CRC-32C uses
+ * the SSE4.2 crc32 instruction, both fall back to slice-by-16 tables.
+ * Adler-32 sums 32 bytes per iteration with SSSE3.
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, uint64_t size);
+uint32_t crc32c_update(uint32_t crc, const void *data, uint64_t size);
+uint32_t adler32_update(uint32_t adler, const void *data, uint64_t size);
+
+struct Checksum {
+    ChecksumKind kind;
+    uint32_t value;
+    uint64_t size;  // bytes hashed.
+};
+
+void checksum_init(Checksum *checksum, ChecksumKind kind);
+void checksum_update(Checksum *checksum, const void *data, uint64_t size);
+
+/*
+ * Reader hashing a region of the reader it wraps while it is decoded.
+ *
+ * Bytes are hashed as they go through read_bytes or read_view. Bytes that
+ * are skipped (seek, skip, read_lazy) are hashed at that moment, from a view
+ * of mapped files or with a read, the decode itself never goes back to them.
+ * Going back and reading bytes again does not hash them twice.
+ */
+template <typename Reader>
+struct ChecksumReader {
+    Reader *reader;
+    Checksum checksum;
+    uint64_t begin;  // region covered by the checksum.
+    uint64_t end;
+    uint64_t next;   // the bytes of the region before this offset were hashed.
+    bool has_failed; // a skipped range could not be read.
+};
+
+template <typename Reader>
+void
+checksum_reader_init(ChecksumReader<Reader> *tee, Reader &reader, ChecksumKind kind, uint64_t begin, uint64_t end)
+{
+    *tee = ChecksumReader<Reader>{};
+    tee->reader = &reader;
+    checksum_init(&tee->checksum, kind);
+    tee->begin = begin;
+    tee->end = end;
+    tee->next = begin;
+}
+
+/*
+ * Hashes the part of the _size_ bytes read at _offset_ that continues the
+ * bytes hashed so far.
+ */
+template <typename Reader>
+void
+checksum_reader_hash(ChecksumReader<Reader> &tee, uint64_t offset, const uint8_t *data, uint64_t size)
+{
+    auto read_end = std::min(offset + size, tee.end);
+    if (offset > tee.next || read_end <= tee.next) {
+        return;
+    }
+
+    checksum_update(&tee.checksum, data + (tee.next - offset), read_end - tee.next);
+    tee.next = read_end;
+}
+
+/*
+ * Hashes the bytes of the region before _offset_ that were not read, the
+ * offset of the reader is left untouched.
+ */
+template <typename Reader>
+bool
+checksum_reader_catch_up(ChecksumReader<Reader> &tee, uint64_t offset)
+{
+    using binaryreader::read_bytes;
+    using binaryreader::read_view;
+
+    offset = std::min(offset, tee.end);
+    if (tee.next >= offset || tee.has_failed) {
+        return !tee.has_failed;
+    }
+
+    auto &reader = *tee.reader;
+    auto old_pos = tell(reader);
+    seek(reader, tee.next);
+    auto view = ByteView{};
+    if (read_view(reader, offset - tee.next, &view)) {
+        checksum_update(&tee.checksum, view.data, view.size);
+        tee.next = offset;
+    }
+
+    uint8_t chunk[CHECKSUM_CATCH_UP_CHUNK];
+    while (tee.next < offset) {
+        auto size = std::min<uint64_t>(offset - tee.next, sizeof(chunk));
+        if (!read_bytes(reader, chunk, size)) {
+            tee.has_failed = true;
+            break;
+        }
+        checksum_update(&tee.checksum, chunk, size);
+        tee.next += size;
+    }
+    seek(reader, old_pos);
+
+    return !tee.has_failed;
+}
+
+/*
+ * Hashes what is left of the region and returns the checksum, false if part
+ * of the region could not be read.
+ */
+template <typename Reader>
+bool
+checksum_reader_finish(ChecksumReader<Reader> &tee, uint32_t *out_value)
+{
+    auto is_complete = checksum_reader_catch_up(tee, tee.end);
+    *out_value = tee.checksum.value;
+    return is_complete;
+}
+
+template <typename Reader>
+uint64_t
+tell(ChecksumReader<Reader> &tee)
+{
+    return tell(*tee.reader);
+}
+
+template <typename Reader>
+uint64_t
+file_size(ChecksumReader<Reader> &tee)
+{
+    return file_size(*tee.reader);
+}
+
+template <typename Reader>
+void
+seek(ChecksumReader<Reader> &tee, uint64_t pos)
+{
+    checksum_reader_catch_up(tee, pos);
+    seek(*tee.reader, pos);
+}
+
+template <typename Reader>
+void
+skip(ChecksumReader<Reader> &tee, uint64_t size)
+{
+    seek(tee, saturating_add<uint64_t>(tell(*tee.reader), size));
+}
+
+template <typename Reader>
+bool
+read_bytes(ChecksumReader<Reader> &tee, void *r_data, uint64_t size)
+{
+    using binaryreader::read_bytes;
+
+    auto offset = tell(*tee.reader);
+    checksum_reader_catch_up(tee, offset);
+    if (!read_bytes(*tee.reader, r_data, size)) {
+        return false;
+    }
+
+    checksum_reader_hash(tee, offset, (const uint8_t *)r_data, size);
+    return true;
+}
+
+template <typename Reader>
+bool
+read_view(ChecksumReader<Reader> &tee, uint64_t size, ByteView *out_view)
+{
+    using binaryreader::read_view;
+
+    auto offset = tell(*tee.reader);
+    checksum_reader_catch_up(tee, offset);
+    if (!read_view(*tee.reader, size, out_view)) {
+        return false;
+    }
+
+    checksum_reader_hash(tee, offset, out_view->data, out_view->size);
+    return true;
+}
+
+template <typename Reader>
+bool
+read_lazy(ChecksumReader<Reader> &tee, uint64_t size, uint64_t *out_offset)
+{
+    using binaryreader::read_lazy;
+
+    auto offset = tell(*tee.reader);
+    if (!read_lazy(*tee.reader, size, out_offset)) {
+        return false;
+    }
+
+    checksum_reader_catch_up(tee, offset + size);
+    return true;
+}
+
+/*
+ * StreamPull hashing every byte pulled through it, put it between a stream
+ * and an InflateSource to check the CRC of a ZIP member as it is inflated.
+ */
+struct ChecksumPull {
+    StreamPull pull;
+    void *user;
+    Checksum checksum;
+};
+
+void checksum_pull_init(ChecksumPull *tee, StreamPull pull, void *user, ChecksumKind kind);
+int64_t checksum_pull(void *tee, void *buffer, uint64_t size);
+
+}  // namespace binaryreader
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "platform.hpp"
+#include "types.hpp"
+
+/*
+ * Compiles a function for an instruction set the build does not target by
+ * default, callers must check platform::cpu_has() first. MSVC emits any
+ * intrinsic without flags.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define ASTRAEA_TARGET(features) __attribute__((target(features)))
+#else
+#define ASTRAEA_TARGET(features)
+#endif
+
+namespace platform {
+
+enum CpuFeature : uint32_t {
+    CPU_SSE2 = 1 << 0,
+    CPU_SSSE3 = 1 << 1,
+    CPU_SSE41 = 1 << 2,
+    CPU_SSE42 = 1 << 3,
+    CPU_PCLMUL = 1 << 4,
+    CPU_AVX2 = 1 << 5,
+    CPU_BMI2 = 1 << 6,
+};
+
+/*
+ * Instruction set extensions supported by the running CPU (and enabled by
+ * the OS), detected once.
+ */
+uint32_t cpu_features();
+
+/*
+ * Hides the features missing from _mask_ from cpu_features(), so every
+ * dispatched path can be checked on one machine. Not to be changed while
+ * other threads run.
+ */
+void cpu_limit_features(uint32_t mask);
+
+inline bool
+cpu_has(uint32_t features)
+{
+    return (cpu_features() & features) == features;
+}
+
+}  // namespace platform
@@ -10,6 +10,10 @@
 #include "types.hpp"
 #include <algorithm>
 
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
 #if _MSVC_LANG > 201703L
 #include <bit>
 using Endian = std::endian;
@@ -29,6 +33,105 @@ enum class Endian {
 };
 #endif
 
+inline uint16_t
+byte_swap(uint16_t value)
+{
+#ifdef _MSC_VER
+    return _byteswap_ushort(value);
+#else
+    return __builtin_bswap16(value);
+#endif
+}
+
+inline uint32_t
+byte_swap(uint32_t value)
+{
+#ifdef _MSC_VER
+    return _byteswap_ulong(value);
+#else
+    return __builtin_bswap32(value);
+#endif
+}
+
+inline uint64_t
+byte_swap(uint64_t value)
+{
+#ifdef _MSC_VER
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+}
+
+/*
+ * Loads an unsigned integer of _byte_size_ (1, 2, 4 or 8) bytes stored with
+ * _endian_ byte order, the swap happens in a register.
+ */
+inline uint64_t
+load_unsigned(const uint8_t *src, uint32_t byte_size, Endian endian)
+{
+    auto swap = Endian::native != endian;
+    switch (byte_size) {
+    case 1:
+        return src[0];
+    case 2:
+    {
+        uint16_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return swap ? byte_swap(value) : value;
+    }
+    case 4:
+    {
+        uint32_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return swap ? byte_swap(value) : value;
+    }
+    case 8:
+    {
+        uint64_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return swap ? byte_swap(value) : value;
+    }
+    }
+
+    return 0;
+}
+
+/*
+ * Stores the low _byte_size_ (1, 2, 4 or 8) bytes of _value_ with _endian_
+ * byte order, the inverse of load_unsigned.
+ */
+inline void
+store_unsigned(uint8_t *dst, uint64_t value, uint32_t byte_size, Endian endian)
+{
+    auto swap = Endian::native != endian;
+    switch (byte_size) {
+    case 1:
+        dst[0] = (uint8_t)value;
+        break;
+    case 2:
+    {
+        auto narrow = (uint16_t)value;
+        narrow = swap ? byte_swap(narrow) : narrow;
+        std::memcpy(dst, &narrow, sizeof(narrow));
+        break;
+    }
+    case 4:
+    {
+        auto narrow = (uint32_t)value;
+        narrow = swap ? byte_swap(narrow) : narrow;
+        std::memcpy(dst, &narrow, sizeof(narrow));
+        break;
+    }
+    case 8:
+    {
+        value = swap ? byte_swap(value) : value;
+        std::memcpy(dst, &value, sizeof(value));
+        break;
+    }
+    }
+}
+
 template <typename Type>
 void
 endian_swap(Type &data)
@@ -37,12 +140,25 @@ endian_swap(Type &data)
     std::reverse(mem, mem + sizeof(Type));
 }
 
+/*
+ * Reverses the bytes of _count_ elements of _byte_size_ (2, 4 or 8) bytes in
+ * place. Uses AVX2 or SSSE3 shuffles when the CPU has them, _data_ needs no
+ * particular alignment.
+ */
+void byte_swap_array(void *data, uint64_t count, uint32_t byte_size);
+
 template <typename Type>
 inline constexpr void
-maybe_endian_swap(Type *data, uint32_t lenght, Endian endian)
+maybe_endian_swap(Type *data, uint64_t lenght, Endian endian)
 {
-    if (Endian::native != endian && sizeof(Type) > sizeof(uint8_t)) {
-        for (uint32_t i = 0; i < lenght; i += 1) {
+    if (Endian::native == endian || sizeof(Type) == sizeof(uint8_t)) {
+        return;
+    }
+
+    if constexpr (sizeof(Type) == 2 || sizeof(Type) == 4 || sizeof(Type) == 8) {
+        byte_swap_array(data, lenght, sizeof(Type));
+    } else {
+        for (uint64_t i = 0; i < lenght; i += 1) {
             endian_swap<Type>(data[i]);
         }
     }
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "streamreader.hpp"  // IWYU pragma: export
+#include <algorithm>
+
+namespace binaryreader {
+
+// Compressed bytes pulled from the input at a time.
+#define INFLATE_INPUT_CHUNK (16 * 1024)
+
+// Most bytes inflated per pull, so a read only inflates a little past what it asked for.
+#define INFLATE_OUTPUT_CHUNK (16 * 1024)
+
+// Default window of the stream over the inflated bytes.
+#define INFLATE_STREAM_WINDOW (64 * 1024)
+
+enum class InflateMethod : uint32_t {
+    STORED,      // Not compressed, the bytes are copied.
+    DEFLATE,     // Deflate with the zlib header and checksum (RFC 1950).
+    RAW_DEFLATE  // Deflate without a header, like ZIP members (RFC 1951).
+};
+
+enum class InflateError : uint32_t {
+    NONE,
+    CORRUPT,     // The compressed data is not valid.
+    TRUNCATED,   // The compressed region ended before the end of the stream.
+    READ_FAILED, // The input could not be read.
+    UNSUPPORTED  // Built without zlib, only STORED is available.
+};
+
+/*
+ * Decompressor over a region of the input, inflated on demand.
+ *
+ * The compressed bytes come from a memory region (a VIEW of a mapped file)
+ * or from a pull function, a chunk at a time. Nothing is inflated before it
+ * is pulled: read it through a StreamFile (open_inflate_stream) and a nested
+ * template decoding a header at the start of a big member only inflates the
+ * first chunk of it.
+ */
+struct InflateSource {
+    InflateMethod method;
+    StreamPull input;          // null when reading _input_data_.
+    void *input_user;
+    const uint8_t *input_data; // rest of the memory region, not owned.
+    uint64_t input_remaining;  // compressed bytes not handed to the inflater yet.
+    uint8_t *input_buffer;     // INFLATE_INPUT_CHUNK bytes, pulled input only.
+    void *inflater;            // z_stream, null for STORED.
+    uint64_t total_in;         // compressed bytes consumed.
+    uint64_t total_out;        // bytes inflated.
+    bool is_done;              // the end of the compressed stream was reached.
+    InflateError error;
+};
+
+/*
+ * Inflates _compressed_size_ bytes read through _input_. Returns false if
+ * _method_ is not available.
+ */
+bool inflate_open(InflateSource *source, InflateMethod method, StreamPull input, void *user, uint64_t compressed_size);
+
+/*
+ * Inflates the _size_ bytes at _data_, they must outlive the source.
+ */
+bool inflate_open_memory(InflateSource *source, InflateMethod method, const uint8_t *data, uint64_t size);
+
+void inflate_close(InflateSource *source);
+
+/*
+ * StreamPull over an InflateSource: inflates up to _size_ bytes (at most
+ * INFLATE_OUTPUT_CHUNK) into _buffer_. Returns zero at the end of the
+ * compressed stream and -1 on errors, see InflateSource::error.
+ */
+int64_t inflate_pull(void *source, void *buffer, uint64_t size);
+
+/*
+ * Reads the inflated bytes of _source_ as a forward-only stream.
+ */
+void open_inflate_stream(StreamFile *file, InflateSource *source, uint64_t window = INFLATE_STREAM_WINDOW);
+
+/*
+ * Inflate method of a ZIP compression_method, false for the methods that
+ * are not supported.
+ */
+bool inflate_method_of_zip(uint64_t compression_method, InflateMethod *out_method);
+
+/*
+ * Region of a reader pulled by reader_region_pull.
+ */
+template <typename Reader>
+struct ReaderRegion {
+    Reader *reader;
+    uint64_t pos;  // next byte to pull.
+    uint64_t end;
+};
+
+/*
+ * StreamPull over _region_, the offset of the reader is restored after each
+ * pull so the outer decode is not disturbed.
+ */
+template <typename Reader>
+int64_t
+reader_region_pull(void *region, void *buffer, uint64_t size)
+{
+    auto self = (ReaderRegion<Reader> *)region;
+    auto count = std::min(size, self->end - self->pos);
+    if (count == 0) {
+        return 0;
+    }
+
+    auto &reader = *self->reader;
+    auto old_pos = tell(reader);
+    seek(reader, self->pos);
+    auto is_read = read_bytes(reader, buffer, count);
+    seek(reader, old_pos);
+    if (!is_read) {
+        return -1;
+    }
+
+    self->pos += count;
+    return (int64_t)count;
+}
+
+/*
+ * Inflates the _size_ bytes at _offset_ of _reader_, like a LAZY field, with
+ * _region_ as the state of the pull. Readers providing read_view are read in
+ * place.
+ */
+template <typename Reader>
+bool
+inflate_open_region(
+    InflateSource *source,
+    InflateMethod method,
+    Reader &reader,
+    uint64_t offset,
+    uint64_t size,
+    ReaderRegion<Reader> *region)
+{
+    using binaryreader::read_view;
+
+    auto old_pos = tell(reader);
+    auto view = ByteView{};
+    seek(reader, offset);
+    auto is_viewed = read_view(reader, size, &view);
+    seek(reader, old_pos);
+    if (is_viewed) {
+        return inflate_open_memory(source, method, view.data, view.size);
+    }
+
+    *region = ReaderRegion<Reader>{&reader, offset, offset + size};
+    return inflate_open(source, method, reader_region_pull<Reader>, region, size);
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"  // IWYU pragma: export
+#include <cstring>
+
+namespace binaryreader {
+
+/*
+ * Read-only file mapped in memory, with the same read/seek/tell surface as
+ * the stream reader. Reads past the end fail instead of touching unmapped
+ * memory.
+ *
+ * The mapping is a SharedBuffer, views handed out by the file hold a
+ * reference to it and stay valid after the file is unmapped.
+ */
+struct MappedFile {
+    const uint8_t *data;   // first byte of the mapping, null for empty files.
+    uint64_t size;         // bytes in the file.
+    uint64_t pos;          // current offset.
+    SharedBuffer *buffer;  // the mapping, null for empty files.
+};
+
+/*
+ * Maps the whole file at _file_path_, returns false if it could not be
+ * opened or mapped.
+ */
+bool map_file(MappedFile *file, Path file_path);
+
+/*
+ * Drops the reference of the file to the mapping, it is unmapped once the
+ * views taken from it are released too.
+ */
+void unmap_file(MappedFile *file);
+
+inline uint64_t
+tell(MappedFile &file)
+{
+    return file.pos;
+}
+
+/*
+ * Seeks to _pos_, offsets past the end are kept and make the next read fail.
+ */
+inline void
+seek(MappedFile &file, uint64_t pos)
+{
+    file.pos = pos;
+}
+
+inline uint64_t
+file_size(MappedFile &file)
+{
+    return file.size;
+}
+
+/*
+ * Bytes left between the current offset and the end of the file.
+ */
+inline uint64_t
+remaining(MappedFile &file)
+{
+    return file.pos < file.size ? file.size - file.pos : 0;
+}
+
+inline bool
+read_bytes(MappedFile &file, void *r_data, uint64_t size)
+{
+    if (size > remaining(file)) {
+        return false;
+    }
+    std::memcpy(r_data, file.data + file.pos, (size_t)size);
+    file.pos += size;
+    return true;
+}
+
+inline void
+skip(MappedFile &file, uint64_t size)
+{
+    file.pos = saturating_add(file.pos, size);
+}
+
+inline bool
+read_lazy(MappedFile &file, uint64_t size, uint64_t *out_offset)
+{
+    if (size > remaining(file)) {
+        return false;
+    }
+
+    *out_offset = file.pos;
+    file.pos += size;
+    return true;
+}
+
+/*
+ * Hands out the next _size_ bytes without copying them, retain
+ * _out_view->buffer_ to keep them past the mapping.
+ */
+inline bool
+read_view(MappedFile &file, uint64_t size, ByteView *out_view)
+{
+    if (size > remaining(file)) {
+        return false;
+    }
+    out_view->data = file.data + file.pos;
+    out_view->size = size;
+    out_view->buffer = file.buffer;
+    file.pos += size;
+    return true;
+}
+
+/*
+ * View of the bytes from _begin_ till _end_, the offset is left untouched.
+ */
+inline bool
+read_view(MappedFile &file, uint64_t begin, uint64_t end, ByteView *out_view)
+{
+    if (begin > end || end > file.size) {
+        return false;
+    }
+    out_view->data = file.data + begin;
+    out_view->size = end - begin;
+    out_view->buffer = file.buffer;
+    return true;
+}
+
+}  // namespace binaryreader
@@ -18,3 +18,7 @@
 #else
 #error "Unsuported platform."
 #endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ARCH_X86
+#endif
@@ -11,8 +11,81 @@
 
 namespace platform {
 
+// Bytes a console sink batches before its writer thread takes them.
+#define CONSOLE_BUFFER_SIZE (256 * 1024)
+
+// Longest time, in milliseconds, batched text waits before it is written.
+#define CONSOLE_FLUSH_INTERVAL_MS 20
+
+// Color of text written without escape sequences.
+#define CONSOLE_NO_COLOR 0xFFFFFFFFu
+
+enum class ConsoleStream : uint32_t {
+    STANDARD_OUTPUT,
+    STANDARD_ERROR
+};
+
+/*
+ * Console output batched in memory.
+ *
+ * Writes are copied into one of two buffers while a background thread writes
+ * the other, so printing costs a memcpy and not a system call per line. The
+ * thread takes the buffer when it fills or every CONSOLE_FLUSH_INTERVAL_MS.
+ * Colors are the Windows console attributes (bit 0 blue, 1 green, 2 red,
+ * 3 bright) and are only emitted when the stream is a terminal.
+ */
+struct ConsoleSink;
+
+ConsoleSink *console_sink_open(ConsoleStream stream);
+
+/*
+ * Writes what is left and joins the writer thread.
+ */
+void console_sink_close(ConsoleSink *sink);
+
+/*
+ * Queues _str_, returns the bytes queued. Code points are never split
+ * between two writes of the thread.
+ */
+uint64_t console_sink_write(ConsoleSink *sink, std::string_view str, uint32_t color = CONSOLE_NO_COLOR);
+
+/*
+ * Blocks until everything queued so far has been written.
+ */
+void console_sink_flush(ConsoleSink *sink);
+
+bool console_sink_has_color(ConsoleSink *sink);
+
+/*
+ * Sink of the standard output used by print, opened on first use and
+ * closed at exit.
+ */
+ConsoleSink *console_output();
+
+/*
+ * Native handle of _stream_, a file descriptor or a HANDLE on Windows.
+ */
+intptr_t console_handle(ConsoleStream stream);
+
+/*
+ * True when _handle_ is a terminal that understands ANSI color sequences,
+ * NO_COLOR in the environment turns colors off.
+ */
+bool console_enable_color(intptr_t handle);
+
 /*
- * Prints an UTF-8 string to the platform native console.
+ * Writes all _size_ bytes of UTF-8 text, retrying short writes.
+ */
+bool console_write_all(intptr_t handle, const uint8_t *data, uint64_t size);
+
+/*
+ * Prints an UTF-8 string to the platform native console. Output still
+ * buffered by stdio is flushed first, so it keeps its order.
+ *
+ * The text is queued on the console_output sink and written later: stdio
+ * output that follows may overtake it unless console_sink_flush is called
+ * in between, and it is lost if the process aborts before the sink writes
+ * it. Errors go through print_error.
  */
 uint64_t print(std::string_view str);
 
@@ -21,4 +94,12 @@ uint64_t print(std::string_view str);
  */
 uint64_t print(std::string_view str, uint32_t color);
 
+/*
+ * Writes an UTF-8 string to the standard error right away, after what print
+ * and stdio queued before it. Bright red unless _color_ is given.
+ */
+uint64_t print_error(std::string_view str);
+
+uint64_t print_error(std::string_view str, uint32_t color);
+
 }  // namespace platform
@@ -6,21 +6,52 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #pragma once
+#include "array.hpp"
 #include "types.hpp"
 #include <string>       // IWYU pragma: export
 #include <string_view>  // IWYU pragma: export
 
 namespace platform {
 
+// Code points between the entries of a Utf8Index.
+#define UTF8_INDEX_STRIDE 256
+
+/*
+ * The size of the UTF-8 code point starting _str_, 0 if _str_ is empty or
+ * does not start with a lead byte.
+ */
+uint32_t utf8_cp_size(std::string_view str);
+
+/*
+ * The lenght in code points of an UTF-8 encoded string, NULs included.
+ * Every byte that is not a continuation byte starts a code point, malformed
+ * text is counted, not rejected. Counts 32 bytes per instruction with AVX2.
+ */
+uint64_t utf8_string_lenght(std::string_view str);
+
+/*
+ * Sparse map from code points to byte offsets of an UTF-8 string, one entry
+ * every UTF8_INDEX_STRIDE code points. Built in one pass, after it finding a
+ * code point walks at most a stride of the text.
+ */
+struct Utf8Index {
+    std::string_view text;  // borrowed, must outlive the index.
+    uint64_t lenght;        // code points in _text_.
+    Array<uint64_t> offsets;
+};
+
+void utf8_index_build(Utf8Index *index, std::string_view text);
+
 /*
- * The size of an UTF-8 code point.
+ * Byte offset of the code point _code_point_, the size of the text past the
+ * last one.
  */
-uint32_t utf8_cp_size(std::string_view);
+uint64_t utf8_index_offset(const Utf8Index &index, uint64_t code_point);
 
 /*
- * The lenght of an UTF-8 encoded string.
+ * The _count_ code points from _first_ on, clamped to the text.
  */
-int32_t utf8_string_lenght(const char *);
+std::string_view utf8_index_substr(const Utf8Index &index, uint64_t first, uint64_t count);
 
 /*
  * Convert from Windows API string to UTF-8 string.
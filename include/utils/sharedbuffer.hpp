@@ -0,0 +1,150 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "types.hpp"
+#include <atomic>
+#include <cassert>
+#include <string_view>
+
+struct SharedBuffer;
+
+/*
+ * Frees the bytes of a buffer adopted with shared_buffer_adopt.
+ */
+using SharedBufferDestroy = void (*)(SharedBuffer *buffer);
+
+/*
+ * Reference counted bytes.
+ *
+ * Every holder (a Slice, a decoded VIEW value, a shared Array, the reader
+ * the bytes came from) owns one reference, the bytes are freed when the
+ * last one is released. References can be taken and released from any
+ * thread.
+ */
+struct SharedBuffer {
+    std::atomic<uint64_t> ref_count;
+    uint8_t *data;
+    uint64_t size;
+    SharedBufferDestroy destroy;  // null when the bytes were allocated with the buffer.
+    void *user;                   // for _destroy_, like the handle of a mapping.
+};
+
+/*
+ * Allocates a buffer of _size_ uninitialized bytes, aligned like Array
+ * storage, with one reference.
+ */
+SharedBuffer *shared_buffer_create(uint64_t size);
+
+/*
+ * Shares the _size_ bytes at _data_, _destroy_ is called when the last
+ * reference is released. Starts with one reference.
+ */
+SharedBuffer *shared_buffer_adopt(uint8_t *data, uint64_t size, SharedBufferDestroy destroy, void *user);
+
+/*
+ * Takes a reference, _buffer_ may be null.
+ */
+inline SharedBuffer *
+shared_buffer_retain(SharedBuffer *buffer)
+{
+    if (buffer) {
+        buffer->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return buffer;
+}
+
+/*
+ * Drops a reference, the last one frees the buffer. _buffer_ may be null.
+ */
+void shared_buffer_release(SharedBuffer *buffer);
+
+/*
+ * Range of bytes that keeps the buffer holding them alive.
+ *
+ * Copies and sub-slices only take a reference, the bytes are never copied.
+ * A slice without a buffer borrows bytes owned by someone else, like a
+ * string literal, and must not outlive them.
+ */
+struct Slice {
+    SharedBuffer *buffer;
+    const uint8_t *data;
+    uint64_t size;
+
+    Slice() : buffer(nullptr), data(nullptr), size(0)
+    {
+    }
+
+    /*
+     * Takes a new reference to _owner_ for the _size_ bytes at _data_.
+     */
+    Slice(SharedBuffer *owner, const uint8_t *data, uint64_t size) :
+        buffer(shared_buffer_retain(owner)), data(data), size(size)
+    {
+    }
+
+    Slice(const Slice &other) : Slice(other.buffer, other.data, other.size)
+    {
+    }
+
+    Slice(Slice &&other) noexcept : buffer(other.buffer), data(other.data), size(other.size)
+    {
+        other.buffer = nullptr;
+        other.data = nullptr;
+        other.size = 0;
+    }
+
+    ~Slice()
+    {
+        shared_buffer_release(buffer);
+    }
+
+    Slice &
+    operator=(const Slice &other)
+    {
+        if (this != &other) {
+            shared_buffer_retain(other.buffer);
+            shared_buffer_release(buffer);
+            buffer = other.buffer;
+            data = other.data;
+            size = other.size;
+        }
+        return *this;
+    }
+
+    Slice &
+    operator=(Slice &&other) noexcept
+    {
+        if (this != &other) {
+            shared_buffer_release(buffer);
+            buffer = other.buffer;
+            data = other.data;
+            size = other.size;
+            other.buffer = nullptr;
+            other.data = nullptr;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    /*
+     * The _count_ bytes at _offset_, clamped to the slice.
+     */
+    Slice
+    sub(uint64_t offset, uint64_t count = UINT64_MAX) const
+    {
+        offset = offset < size ? offset : size;
+        count = count < size - offset ? count : size - offset;
+        return Slice{buffer, data + offset, count};
+    }
+
+    std::string_view
+    as_string() const
+    {
+        return std::string_view{(const char *)data, (size_t)size};
+    }
+};
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"
+#include "types.hpp"
+
+namespace binaryreader {
+
+#define SIGNATURE_MIN_SIZE 2
+#define SIGNATURE_MAX_SIZE 8
+
+// Arms of a single scan, one per `match` arm of a tag-dispatch loop.
+#define SIGNATURE_SET_MAX 16
+
+// Bytes read at once by scan_reader when the reader has no views.
+#define SIGNATURE_SCAN_CHUNK (64 * 1024)
+
+/*
+ * Signatures searched for together. Candidates are found by comparing the
+ * first two bytes of every signature against 32 (AVX2) or 16 (SSE2) input
+ * bytes at once, then confirmed with one masked 8 byte compare per arm.
+ */
+struct SignatureSet {
+    uint64_t values[SIGNATURE_SET_MAX];     // signature bytes as loaded from memory, zero padded.
+    uint64_t masks[SIGNATURE_SET_MAX];      // covers the _sizes_ bytes of each signature.
+    uint8_t sizes[SIGNATURE_SET_MAX];
+    uint8_t prefixes[SIGNATURE_SET_MAX][2];  // distinct first two bytes, for the prefilter.
+    uint32_t count;
+    uint32_t prefix_count;
+    uint32_t max_size;
+};
+
+struct SignatureMatch {
+    uint64_t offset;  // first byte of the signature.
+    uint32_t arm;     // index of the signature in the set, in the order added.
+};
+
+inline void
+signature_set_init(SignatureSet *set)
+{
+    *set = SignatureSet{};
+}
+
+/*
+ * Adds the _size_ (2 to 8) bytes at _bytes_ as the next arm, returns false
+ * if the size is out of range or the set is full.
+ */
+bool signature_set_add(SignatureSet *set, const void *bytes, uint32_t size);
+
+/*
+ * Finds the first signature of _set_ in _data_ starting at _from_. When
+ * several arms match the same offset the first one added wins. Signatures
+ * running past _size_ do not match.
+ */
+bool scan_signatures(const SignatureSet *set, const uint8_t *data, uint64_t size, uint64_t from, SignatureMatch *out_match);
+
+/*
+ * Scans _reader_ from its current offset, on a match the reader is left at
+ * the signature and _out_match_->offset is its file offset, otherwise it is
+ * left at the end. Readers with views (mapped files) are scanned in place,
+ * the others in SIGNATURE_SCAN_CHUNK reads.
+ */
+template <typename Reader>
+bool
+scan_reader(Reader &reader, const SignatureSet *set, SignatureMatch *out_match)
+{
+    uint64_t start = (uint64_t)tell(reader);
+    uint64_t end = file_size(reader);
+    if (start >= end) {
+        return false;
+    }
+
+    auto view = ByteView{};
+    if (read_view(reader, end - start, &view)) {
+        auto is_found = scan_signatures(set, view.data, view.size, 0, out_match);
+        out_match->offset += start;
+        seek(reader, is_found ? out_match->offset : end);
+        return is_found;
+    }
+
+    // Chunks overlap by max_size - 1 bytes, so signatures across two reads are found.
+    uint8_t chunk[SIGNATURE_SCAN_CHUNK];
+    uint64_t overlap = set->max_size > 1 ? set->max_size - 1 : 0;
+    for (auto chunk_offset = start; chunk_offset < end;) {
+        auto chunk_size = end - chunk_offset < SIGNATURE_SCAN_CHUNK ? end - chunk_offset : SIGNATURE_SCAN_CHUNK;
+        seek(reader, chunk_offset);
+        if (!read_bytes(reader, chunk, chunk_size)) {
+            break;
+        }
+        if (scan_signatures(set, chunk, chunk_size, 0, out_match)) {
+            out_match->offset += chunk_offset;
+            seek(reader, out_match->offset);
+            return true;
+        }
+        if (chunk_offset + chunk_size >= end) {
+            break;
+        }
+        chunk_offset += chunk_size > overlap ? chunk_size - overlap : chunk_size;
+    }
+
+    seek(reader, end);
+    return false;
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"  // IWYU pragma: export
+#include <cstring>
+
+namespace binaryreader {
+
+/*
+ * Reader over a Slice, like the bytes of a decoded [..] u8 field holding a
+ * nested format. Views handed out point into the slice and share its buffer,
+ * so fields decoded from it never copy and keep the parent bytes alive.
+ */
+struct SliceFile {
+    Slice slice;
+    uint64_t pos;  // current offset in the slice.
+};
+
+inline void
+open_slice(SliceFile *file, Slice slice)
+{
+    file->slice = std::move(slice);
+    file->pos = 0;
+}
+
+inline uint64_t
+tell(SliceFile &file)
+{
+    return file.pos;
+}
+
+/*
+ * Seeks to _pos_, offsets past the end are kept and make the next read fail.
+ */
+inline void
+seek(SliceFile &file, uint64_t pos)
+{
+    file.pos = pos;
+}
+
+inline uint64_t
+file_size(SliceFile &file)
+{
+    return file.slice.size;
+}
+
+inline uint64_t
+remaining(SliceFile &file)
+{
+    return file.pos < file.slice.size ? file.slice.size - file.pos : 0;
+}
+
+inline bool
+read_bytes(SliceFile &file, void *r_data, uint64_t size)
+{
+    if (size > remaining(file)) {
+        return false;
+    }
+    std::memcpy(r_data, file.slice.data + file.pos, (size_t)size);
+    file.pos += size;
+    return true;
+}
+
+inline void
+skip(SliceFile &file, uint64_t size)
+{
+    file.pos = saturating_add(file.pos, size);
+}
+
+inline bool
+read_lazy(SliceFile &file, uint64_t size, uint64_t *out_offset)
+{
+    if (size > remaining(file)) {
+        return false;
+    }
+
+    *out_offset = file.pos;
+    file.pos += size;
+    return true;
+}
+
+inline bool
+read_view(SliceFile &file, uint64_t size, ByteView *out_view)
+{
+    if (size > remaining(file)) {
+        return false;
+    }
+    out_view->data = file.slice.data + file.pos;
+    out_view->size = size;
+    out_view->buffer = file.slice.buffer;
+    file.pos += size;
+    return true;
+}
+
+/*
+ * View of the bytes from _begin_ till _end_, the offset is left untouched.
+ */
+inline bool
+read_view(SliceFile &file, uint64_t begin, uint64_t end, ByteView *out_view)
+{
+    if (begin > end || end > file.slice.size) {
+        return false;
+    }
+    out_view->data = file.slice.data + begin;
+    out_view->size = end - begin;
+    out_view->buffer = file.slice.buffer;
+    return true;
+}
+
+/*
+ * Reads basic type from the slice, zero if it ended.
+ */
+template <typename Type>
+constexpr auto
+read(SliceFile &file, Endian endian = Endian::native)
+{
+    auto data = Type{};
+    if (!read_bytes(file, &data, sizeof(Type))) {
+        return Type{};
+    }
+    maybe_endian_swap(&data, 1, endian);
+
+    return data;
+}
+
+/*
+ * Read an array of _lenght_ Types
+ */
+template <typename Type, uint32_t lenght>
+constexpr auto
+read(SliceFile &file, Endian endian = Endian::native)
+{
+    auto array = Array<Type>{};
+    array.resize_for_overwrite(lenght);
+    if (!read_bytes(file, array.data, sizeof(Type) * lenght)) {
+        std::memset((void *)array.data, 0, (size_t)(sizeof(Type) * lenght));
+    }
+    maybe_endian_swap(array.data, lenght, endian);
+
+    return array;
+}
+
+/*
+ * Read an array of Types from _beg_ till _end_, the offset is left untouched.
+ * Bytes in native order are shared with the slice instead of copied.
+ */
+template <typename Type>
+Array<Type>
+read(SliceFile &file, uint64_t begin, uint64_t end, Endian endian = Endian::native)
+{
+    assert(begin <= end && (end - begin) % sizeof(Type) == 0);
+    uint64_t lenght = (end - begin) / sizeof(Type);
+
+    auto view = ByteView{};
+    auto is_read = read_view(file, begin, end, &view);
+    auto is_aligned = ((uintptr_t)view.data % alignof(Type)) == 0;
+    if (is_read && view.buffer && is_aligned && (Endian::native == endian || 1 == sizeof(Type))) {
+        return Array<Type>::shared_from(view.buffer, (const Type *)view.data, lenght);
+    }
+
+    auto array = Array<Type>{};
+    array.resize_for_overwrite(lenght);
+    if (is_read) {
+        std::memcpy(array.data, view.data, (size_t)view.size);
+    } else {
+        std::memset((void *)array.data, 0, (size_t)(sizeof(Type) * lenght));
+    }
+    maybe_endian_swap(array.data, lenght, endian);
+
+    return array;
+}
+
+/*
+ * Read an array of _lenght_ Types to &data.
+ */
+template <typename Type, uint32_t lenght>
+void
+read(SliceFile &file, Type (&r_data)[lenght], Endian endian = Endian::native)
+{
+    read_bytes(file, r_data, sizeof(Type) * lenght);
+    maybe_endian_swap(r_data, lenght, endian);
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "binaryreader.hpp"  // IWYU pragma: export
+#include <cstring>
+
+namespace binaryreader {
+
+// Default bytes kept behind the newest byte received, rounded to a power of two.
+#define STREAM_READER_WINDOW (1024 * 1024)
+
+/*
+ * Fills _buffer_ with up to _size_ bytes of the input, returns the number of
+ * bytes written, zero at the end of the input and a negative value on errors.
+ */
+using StreamPull = int64_t (*)(void *user, void *buffer, uint64_t size);
+
+enum class StreamError : uint32_t {
+    NONE,
+    SEEK_BEFORE_WINDOW,  // The bytes asked for were already dropped from the window.
+    READ_FAILED          // The pull function (or the pipe under it) failed.
+};
+
+/*
+ * Input that can only be read forward, like a pipe, a socket or the output
+ * of a decompressor. The last _capacity_ bytes received are kept in a ring
+ * buffer, so peeking and seeking back inside of that window work, forward
+ * seeks drop the bytes skipped. Memory stays constant whatever the size of
+ * the input.
+ *
+ * Seeking before the window is an error: it is kept in _error_ and every
+ * read fails from then on.
+ */
+struct StreamFile {
+    StreamPull pull;
+    void *user;
+    intptr_t handle;  // pipe read by open_stream_handle, not owned.
+    uint8_t *ring;
+    uint64_t capacity;  // power of two.
+    uint64_t begin;     // offset of the oldest byte in the window.
+    uint64_t end;       // offset after the newest byte received.
+    uint64_t pos;       // current offset.
+    bool is_eof;        // the pull function returned zero.
+    StreamError error;
+    uint64_t error_offset;  // offset that was asked for when the error happened.
+};
+
+/*
+ * Reads the input through _pull_, keeping a window of at least _window_ bytes.
+ */
+void open_stream(StreamFile *file, StreamPull pull, void *user, uint64_t window = STREAM_READER_WINDOW);
+
+/*
+ * Reads from a pipe or socket, a file descriptor or a HANDLE on Windows.
+ */
+void open_stream_handle(StreamFile *file, intptr_t handle, uint64_t window = STREAM_READER_WINDOW);
+
+/*
+ * Frees the window, the handle is left open.
+ */
+void close_stream(StreamFile *file);
+
+/*
+ * Describes the error of _file_, like "seek to 1024 is before the stream
+ * window (4096 to 1052672)".
+ */
+std::string stream_error_message(const StreamFile &file);
+
+/*
+ * Pulls from the input until the bytes under the current offset are in the
+ * window and copies them.
+ */
+bool stream_read_slow(StreamFile &file, void *r_data, uint64_t size);
+
+inline uint64_t
+tell(StreamFile &file)
+{
+    return file.pos;
+}
+
+/*
+ * Seeks inside of the window, or forward. Seeking before the window fails
+ * the stream.
+ */
+inline void
+seek(StreamFile &file, uint64_t pos)
+{
+    if (pos < file.begin && StreamError::NONE == file.error) {
+        file.error = StreamError::SEEK_BEFORE_WINDOW;
+        file.error_offset = pos;
+    }
+    file.pos = pos;
+}
+
+/*
+ * Size of the input once it ended, until then it is unknown and UINT64_MAX.
+ */
+inline uint64_t
+file_size(StreamFile &file)
+{
+    return file.is_eof ? file.end : UINT64_MAX;
+}
+
+inline bool
+read_bytes(StreamFile &file, void *r_data, uint64_t size)
+{
+    auto ring_pos = file.pos & (file.capacity - 1);
+    auto is_contiguous = ring_pos + size <= file.capacity;
+    auto is_in_window = file.pos >= file.begin && file.pos <= file.end && size <= file.end - file.pos;
+    if (StreamError::NONE == file.error && is_in_window && is_contiguous) {
+        std::memcpy(r_data, file.ring + ring_pos, (size_t)size);
+        file.pos += size;
+        return true;
+    }
+
+    return stream_read_slow(file, r_data, size);
+}
+
+/*
+ * Reads _size_ bytes without moving the offset, at most the window capacity.
+ */
+inline bool
+peek_bytes(StreamFile &file, void *r_data, uint64_t size)
+{
+    if (size > file.capacity) {
+        return false;
+    }
+
+    auto old_pos = file.pos;
+    auto is_read = read_bytes(file, r_data, size);
+    file.pos = old_pos;
+    return is_read;
+}
+
+inline void
+skip(StreamFile &file, uint64_t size)
+{
+    file.pos = saturating_add(file.pos, size);
+}
+
+/*
+ * Reads basic type without moving the offset, zero if the input ended.
+ */
+template <typename Type>
+constexpr auto
+peek(StreamFile &file, Endian endian = Endian::native)
+{
+    auto data = Type{};
+    if (!peek_bytes(file, &data, sizeof(Type))) {
+        return Type{};
+    }
+    maybe_endian_swap(&data, 1, endian);
+
+    return data;
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "types.hpp"
+
+namespace platform {
+
+using TaskFunction = void (*)(void *argument);
+
+struct ThreadPool;
+
+/*
+ * Starts _thread_count_ worker threads, one per hardware thread when zero.
+ */
+ThreadPool *thread_pool_create(uint32_t thread_count = 0);
+
+/*
+ * Waits for the queued tasks and joins the workers.
+ */
+void thread_pool_destroy(ThreadPool *pool);
+
+/*
+ * Queues _function_(_argument_), tasks start in submission order.
+ */
+void thread_pool_submit(ThreadPool *pool, TaskFunction function, void *argument);
+
+/*
+ * Blocks until every task submitted so far has finished.
+ */
+void thread_pool_wait(ThreadPool *pool);
+
+uint32_t thread_pool_size(ThreadPool *pool);
+
+}  // namespace platform
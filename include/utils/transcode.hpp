@@ -0,0 +1,75 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+#include "endian.hpp"
+#include "types.hpp"
+#include <string_view>
+
+namespace platform {
+
+enum class TextEncoding : uint32_t {
+    NONE,     // Bytes kept as they are stored, not checked.
+    ASCII,
+    LATIN1,   // ISO-8859-1, every byte is the code point of the same value.
+    UTF8,
+    UTF16LE,
+    UTF16BE,
+    UTF32LE,
+    UTF32BE
+};
+
+/*
+ * Encoding called _name_, like `string<"utf-16le">` or `._encoding = "latin1"`.
+ * Case is ignored, "utf-16" and "utf-32" are little endian. Returns false for
+ * unknown encodings.
+ */
+bool text_encoding_parse(std::string_view name, TextEncoding *out_encoding);
+
+/*
+ * Bytes in a code unit of _encoding_.
+ */
+uint32_t text_encoding_unit_size(TextEncoding encoding);
+
+/*
+ * Byte order of the code units of _encoding_, native for single bytes.
+ */
+Endian text_encoding_endian(TextEncoding encoding);
+
+/*
+ * Most UTF-8 bytes _size_ bytes of _encoding_ can turn into.
+ */
+uint64_t utf8_capacity(TextEncoding encoding, uint64_t size);
+
+/*
+ * Checks that the _size_ bytes at _data_ are well formed UTF-8: no overlong
+ * forms, surrogates, code points past U+10FFFF or cut sequences.
+ */
+bool utf8_validate(const uint8_t *data, uint64_t size);
+
+/*
+ * Converts _size_ bytes of _encoding_ text at _src_ to UTF-8 in _dst_, which
+ * must hold utf8_capacity(encoding, size) bytes. Returns false when the text
+ * is not valid in its encoding (lone surrogates, code points past U+10FFFF,
+ * bytes over 0x7F in ASCII, a cut code unit), _out_written_ is then the
+ * UTF-8 written before the error.
+ *
+ * ASCII runs are copied 16 bytes at a time, other text is widened to 32-bit
+ * lanes and packed with byte shuffles (SSSE3), surrogate pairs and invalid
+ * input take the scalar path.
+ */
+bool transcode_to_utf8(TextEncoding encoding, const uint8_t *src, uint64_t size, uint8_t *dst, uint64_t *out_written);
+
+/*
+ * Inverse of transcode_to_utf8, writes whole code points while they fit in
+ * the _capacity_ bytes at _dst_. Returns false if _src_ is not valid UTF-8,
+ * has code points _encoding_ cannot represent or does not fit.
+ */
+bool transcode_from_utf8(
+    TextEncoding encoding, const uint8_t *src, uint64_t size, uint8_t *dst, uint64_t capacity, uint64_t *out_written);
+
+}  // namespace platform
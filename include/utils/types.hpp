@@ -23,3 +23,43 @@ is_pow2(Type value)
 {
     return (value & (value - 1)) == 0;
 }
+
+/*
+ * Overflow checked unsigned arithmetic, returns false if the result wraps.
+ */
+template <typename Type>
+constexpr inline bool
+checked_add(Type lhs, Type rhs, Type *result)
+{
+    static_assert(Type(-1) > Type(0), "checked arithmetic expects unsigned types");
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_add_overflow(lhs, rhs, result);
+#else
+    *result = lhs + rhs;
+    return *result >= lhs;
+#endif
+}
+
+/*
+ * Unsigned addition that stops at the largest value instead of wrapping.
+ */
+template <typename Type>
+constexpr inline Type
+saturating_add(Type lhs, Type rhs)
+{
+    auto result = Type{};
+    return checked_add(lhs, rhs, &result) ? result : Type(-1);
+}
+
+template <typename Type>
+constexpr inline bool
+checked_mul(Type lhs, Type rhs, Type *result)
+{
+    static_assert(Type(-1) > Type(0), "checked arithmetic expects unsigned types");
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(lhs, rhs, result);
+#else
+    *result = lhs * rhs;
+    return lhs == 0 || *result / lhs == rhs;
+#endif
+}
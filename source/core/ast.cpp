@@ -6,7 +6,7 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #include "include/core/ast.hpp"
-#include "include/utils/platform_console.hpp"
+#include "include/core/type_registry.hpp"
 #include <algorithm>
 #include <string>
 #include <string_view>
@@ -59,6 +59,39 @@ ast_compound_add_statement(AstCompound *ast_compound, AstNode *statement)
     return ast_compound;
 }
 
+AstConstant *
+ast_constant_init(std::string_view constant_name)
+{
+    auto *ast_constant = (AstConstant *)calloc(1, sizeof(AstConstant));
+    if (!ast_constant) {
+        std::exit(1);
+    }
+
+    ast_constant->node_type = AstNodeType::CONSTANT_DEFINITION;
+    ast_constant->name = constant_name;
+    ast_constant->values = nullptr;
+    ast_constant->value_count = 0;
+
+    return ast_constant;
+}
+
+AstConstant *
+ast_constant_add_value(AstConstant *ast_constant, AstNode *value)
+{
+    auto reallocated_buffer = (AstNode **)std::realloc(
+        ast_constant->values,
+        (ast_constant->value_count + 1 /*new elem*/) * sizeof(AstNode *));
+    if (!reallocated_buffer) {
+        std::exit(1);
+    }
+
+    ast_constant->values = reallocated_buffer;
+    ast_constant->values[ast_constant->value_count] = value;
+    ast_constant->value_count += 1;
+
+    return ast_constant;
+}
+
 AstFunction *
 ast_function_init(std::string_view func_name)
 {
@@ -117,6 +150,7 @@ ast_typedef_enum_init(std::string_view enum_name)
     ast_type_enum->base_type = AstTypeInfo::UNKNOWN;
     ast_type_enum->name = enum_name;
     ast_type_enum->elements = nullptr;
+    ast_type_enum->builtin = nullptr;
 
     return ast_type_enum;
 }
@@ -151,8 +185,6 @@ ast_typedef_string_init(std::string_view string_name)
     ast_type_string->node_type = AstNodeType::TYPE_DEFINITION;
     ast_type_string->base_type = AstTypeInfo::STRING;
     ast_type_string->name = string_name;
-    ast_type_string->value = std::string{""};
-    ast_type_string->encoding = std::string{""};
     ast_type_string->count = 0;
 
     return ast_type_string;
@@ -170,6 +202,10 @@ ast_typedef_struct_init(std::string_view struct_name)
     ast_type_struct->base_type = AstTypeInfo::STRUCT;
     ast_type_struct->name = struct_name;
     ast_type_struct->block = nullptr;
+    ast_type_struct->layout = nullptr;
+    ast_type_struct->decode_plan = nullptr;
+    ast_type_struct->attributes = nullptr;
+    ast_type_struct->attribute_count = 0;
 
     return ast_type_struct;
 }
@@ -184,47 +220,110 @@ ast_vardef_init(std::string_view variable_name)
 
     ast_variable->node_type = AstNodeType::VARIABLE_DEFINITION;
     ast_variable->name = variable_name;
+    ast_variable->attributes = nullptr;
+    ast_variable->attribute_count = 0;
 
     return ast_variable;
 }
 
+AstAttribute *
+ast_attribute_init(std::string_view name, std::string_view value)
+{
+    auto *ast_attribute = (AstAttribute *)calloc(1, sizeof(AstAttribute));
+    if (!ast_attribute) {
+        std::exit(1);
+    }
+
+    ast_attribute->name = name;
+    ast_attribute->value = value;
+
+    return ast_attribute;
+}
+
+void
+ast_attribute_add(AstAttribute ***attributes, uint32_t *attribute_count, AstAttribute *attribute)
+{
+    auto reallocated_buffer = (AstAttribute **)std::realloc(
+        *attributes,
+        (*attribute_count + 1 /*new elem*/) * sizeof(AstAttribute *));
+    if (!reallocated_buffer) {
+        std::exit(1);
+    }
+
+    *attributes = reallocated_buffer;
+    (*attributes)[*attribute_count] = attribute;
+    *attribute_count += 1;
+}
+
+const AstAttribute *
+ast_vardef_find_attribute(const AstVariable *var_def, std::string_view name)
+{
+    for (uint32_t i = 0; i < var_def->attribute_count; i += 1) {
+        if (name == var_def->attributes[i]->name) {
+            return var_def->attributes[i];
+        }
+    }
+
+    return nullptr;
+}
+
+std::string_view
+ast_vardef_count(const AstVariable *var_def)
+{
+    auto is_open = var_def->count.empty() || ".." == var_def->count;
+    auto lenght = is_open ? ast_vardef_find_attribute(var_def, "_lenght") : nullptr;
+    if (lenght) {
+        auto value = std::string_view{lenght->value};
+        if (!value.empty() && value[0] == '.') {
+            value.remove_prefix(1);  // `._lenght = .field` and `._lenght = field` are the same.
+        }
+        return value;
+    }
+
+    return var_def->count;
+}
+
 AstTypeInfo
 parse_type_info(std::string_view base_type)
 {
-    auto out = std::string{"PARSER [Type Base Type]: "};
-    out += base_type;
-    out += "\n";
-    platform::print(out);
-
-    if ("uint" == base_type) {
-        return AstTypeInfo::UNSIGNED;
-    } else if ("u8" == base_type) {
-        return AstTypeInfo::U8;
-    } else if ("u16" == base_type) {
-        return AstTypeInfo::U16;
-    } else if ("u32" == base_type) {
-        return AstTypeInfo::U32;
-    } else if ("u64" == base_type) {
-        return AstTypeInfo::U64;
-    } else if ("int" == base_type) {
-        return AstTypeInfo::SIGNED;
-    } else if ("s8" == base_type) {
-        return AstTypeInfo::S8;
-    } else if ("s16" == base_type) {
-        return AstTypeInfo::S16;
-    } else if ("s32" == base_type) {
-        return AstTypeInfo::S32;
-    } else if ("s64" == base_type) {
-        return AstTypeInfo::S64;
-    } else if ("float" == base_type) {
-        return AstTypeInfo::FLOAT;
-    } else if ("f32" == base_type) {
-        return AstTypeInfo::F32;
-    } else if ("f64" == base_type) {
-        return AstTypeInfo::F64;
-    }
-
-    return AstTypeInfo::UNKNOWN;
+    auto builtin = type_registry_find(base_type);
+    return builtin ? builtin->base_type : AstTypeInfo::UNKNOWN;
+}
+
+uint32_t
+ast_child_count(AstNode *node)
+{
+    switch (node->node_type) {
+    case AstNodeType::COMPOUND:
+        return ((AstCompound *)node)->statement_count;
+    case AstNodeType::FUNCTION_DEFINITION:
+        return ((AstFunction *)node)->block ? 1 : 0;
+    case AstNodeType::TYPE_DEFINITION:
+    {
+        auto type_def = (AstType *)node;
+        if (AstTypeInfo::STRUCT == type_def->base_type) {
+            return ((AstTypeStruct *)node)->block ? 1 : 0;
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+AstNode *
+ast_child(AstNode *node, uint32_t index)
+{
+    switch (node->node_type) {
+    case AstNodeType::COMPOUND:
+        return ((AstCompound *)node)->statements[index];
+    case AstNodeType::FUNCTION_DEFINITION:
+        return ((AstFunction *)node)->block;
+    case AstNodeType::TYPE_DEFINITION:
+        return ((AstTypeStruct *)node)->block;
+    default:
+        return nullptr;
+    }
 }
 
 std::string
@@ -246,6 +345,11 @@ ast_node_type_as_string(AstNodeType node_type)
         return "Variable Definition";
         break;
     }
+    case AstNodeType::CONSTANT_DEFINITION:
+    {
+        return "Constant Definition";
+        break;
+    }
     }
 
     return "";
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/decode_parallel.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+
+namespace astraea {
+
+/*
+ * Batches of one decode_parallel call still running, the pool may be
+ * running tasks of others.
+ */
+struct DecodeBatchGroup {
+    std::mutex mutex;
+    std::condition_variable is_done;
+    uint64_t remaining;
+};
+
+/*
+ * Records [first, first + count) of a decode_parallel call.
+ */
+struct DecodeBatch {
+    const DecodePlan *plan;
+    binaryreader::MappedFile cursor;  // copy of the source, only _pos_ moves.
+    const uint64_t *offsets;
+    Endian endian;
+    uint64_t lazy_threshold;
+    uint64_t first;
+    uint64_t count;
+    Value *records;
+    DecodeBatchGroup *group;  // null when decoded by the caller.
+    DecodeStatus status;  // of the first record that failed.
+};
+
+static void
+decode_batch(void *argument)
+{
+    auto batch = (DecodeBatch *)argument;
+
+    DecodeContext context;
+    decode_context_init(&context, batch->endian);
+    context.lazy_threshold = batch->lazy_threshold;
+
+    batch->status = DecodeStatus::OK;
+    for (uint64_t i = 0; i < batch->count; i += 1) {
+        auto index = batch->first + i;
+        binaryreader::seek(batch->cursor, batch->offsets[index]);
+        auto status = decode_plan_execute(batch->plan, batch->cursor, &context, &batch->records[index]);
+        if (DecodeStatus::OK != status && DecodeStatus::OK == batch->status) {
+            batch->status = status;
+        }
+    }
+
+    decode_context_free(&context);
+
+    if (batch->group) {
+        // Notified with the lock held, the waiter frees the group as soon as it sees zero.
+        std::lock_guard<std::mutex> lock{batch->group->mutex};
+        batch->group->remaining -= 1;
+        if (batch->group->remaining == 0) {
+            batch->group->is_done.notify_all();
+        }
+    }
+}
+
+DecodeStatus
+decode_parallel(
+    const DecodePlan *plan,
+    const binaryreader::MappedFile &source,
+    const uint64_t *offsets,
+    uint64_t count,
+    const DecodeContext *context,
+    platform::ThreadPool *pool,
+    Value *out_list)
+{
+    auto records = value_init_children(out_list, ValueType::LIST, count);
+    if (count == 0) {
+        return DecodeStatus::OK;
+    }
+
+    // A few batches per worker, so one slow batch does not hold the others.
+    uint64_t worker_count = pool ? platform::thread_pool_size(pool) : 1;
+    auto batch_size = std::max<uint64_t>(DECODE_PARALLEL_MIN_BATCH, count / (worker_count * 4));
+    auto batch_count = (count + batch_size - 1) / batch_size;
+    auto batches = (DecodeBatch *)std::calloc((size_t)batch_count, sizeof(DecodeBatch));
+    if (!batches) {
+        std::exit(1);
+    }
+
+    DecodeBatchGroup group;
+    group.remaining = batch_count;
+    for (uint64_t n = 0; n < batch_count; n += 1) {
+        auto batch = &batches[n];
+        batch->plan = plan;
+        batch->cursor = source;
+        batch->offsets = offsets;
+        batch->endian = context->endian;
+        batch->lazy_threshold = context->lazy_threshold;
+        batch->first = n * batch_size;
+        batch->count = std::min(batch_size, count - batch->first);
+        batch->records = records;
+        if (pool) {
+            batch->group = &group;
+            platform::thread_pool_submit(pool, &decode_batch, batch);
+        } else {
+            decode_batch(batch);
+        }
+    }
+    if (pool) {
+        // Only waits for these batches, the pool may be shared with other work.
+        std::unique_lock<std::mutex> lock{group.mutex};
+        group.is_done.wait(lock, [&group] { return group.remaining == 0; });
+    }
+
+    // Batches are in list order, the first failing one holds the first failure.
+    auto status = DecodeStatus::OK;
+    for (uint64_t n = 0; n < batch_count; n += 1) {
+        if (DecodeStatus::OK != batches[n].status) {
+            status = batches[n].status;
+            break;
+        }
+    }
+    std::free(batches);
+
+    return status;
+}
+
+DecodeStatus
+decode_follow_pointers(
+    const DecodePlan *plan,
+    uint32_t slot,
+    const Value *records,
+    const binaryreader::MappedFile &source,
+    const DecodeContext *context,
+    platform::ThreadPool *pool,
+    Value *out_list)
+{
+    const DecodeOp *pointer_op = nullptr;
+    for (uint32_t i = 0; i < plan->op_count; i += 1) {
+        if (plan->ops[i].slot == slot && plan->ops[i].target_plan) {
+            pointer_op = &plan->ops[i];
+            break;
+        }
+    }
+    if (!pointer_op || ValueType::LIST != records->type) {
+        return DecodeStatus::UNSUPPORTED_TYPE;
+    }
+
+    auto count = records->count;
+    auto offsets = (uint64_t *)std::malloc((size_t)std::max<uint64_t>(count, 1) * sizeof(uint64_t));
+    if (!offsets) {
+        std::exit(1);
+    }
+    for (uint64_t i = 0; i < count; i += 1) {
+        auto &record = records->values[i];
+        if (ValueType::RECORD != record.type || slot >= record.count ||
+            ValueType::UNSIGNED != record.values[slot].type) {
+            std::free(offsets);
+            return DecodeStatus::UNSUPPORTED_TYPE;
+        }
+        offsets[i] = record.values[slot].u64;
+    }
+
+    auto status = decode_parallel(pointer_op->target_plan, source, offsets, count, context, pool, out_list);
+    std::free(offsets);
+
+    return status;
+}
+
+}  // namespace astraea
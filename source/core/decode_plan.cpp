@@ -0,0 +1,444 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/decode_plan.hpp"
+#include "include/core/layout.hpp"
+#include "include/core/scope.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace astraea {
+
+// Extra bytes after the scratch run, lets bit extraction load 8 bytes at once.
+#define DECODE_SCRATCH_PADDING 16
+
+static bool
+is_byte_sized(uint32_t bit_size)
+{
+    return bit_size == 8 || bit_size == 16 || bit_size == 32 || bit_size == 64;
+}
+
+/*
+ * `<< ._lazy = true` fields are only read when they are used.
+ */
+static bool
+is_lazy_field(const AstVariable *var_def)
+{
+    auto lazy = ast_vardef_find_attribute(var_def, "_lazy");
+    return lazy && "false" != lazy->value && "0" != lazy->value;
+}
+
+/*
+ * Plan of the struct named by the `._points_to` attribute of an offset field.
+ */
+static DecodePlan *
+pointer_target_plan(AstTypeStruct *struct_def, const AstVariable *var_def)
+{
+    auto points_to = ast_vardef_find_attribute(var_def, "_points_to");
+    if (!points_to) {
+        return nullptr;
+    }
+
+    auto type_def = scope_lookup_typedef(struct_def->scope, points_to->value);
+    if (!type_def || AstTypeInfo::STRUCT != type_def->base_type) {
+        return nullptr;
+    }
+
+    return decode_plan_compile((AstTypeStruct *)type_def);
+}
+
+void
+decode_context_init(DecodeContext *context, Endian endian)
+{
+    context->endian = endian;
+    context->scratch = nullptr;
+    context->scratch_capacity = 0;
+    context->lazy_threshold = 0;
+}
+
+void
+decode_context_reserve(DecodeContext *context, uint32_t size)
+{
+    if (size + DECODE_SCRATCH_PADDING <= context->scratch_capacity) {
+        return;
+    }
+
+    auto new_capacity = size + DECODE_SCRATCH_PADDING;
+    auto reallocated_buffer = (uint8_t *)std::realloc(context->scratch, new_capacity);
+    if (!reallocated_buffer) {
+        std::exit(1);
+    }
+    std::memset(reallocated_buffer, 0, new_capacity);
+    context->scratch = reallocated_buffer;
+    context->scratch_capacity = new_capacity;
+}
+
+void
+decode_context_free(DecodeContext *context)
+{
+    std::free(context->scratch);
+    context->scratch = nullptr;
+    context->scratch_capacity = 0;
+}
+
+void
+decode_swap_array(uint8_t *data, uint64_t count, uint32_t byte_size, Endian endian)
+{
+    if (Endian::native != endian && byte_size > 1) {
+        byte_swap_array(data, count, byte_size);
+    }
+}
+
+void
+decode_extract(const DecodeOp *op, const uint8_t *scratch, Endian endian, Value *values)
+{
+    auto value = &values[op->slot];
+    auto src = scratch + op->offset;
+
+    switch (op->type) {
+    case DecodeOpType::EXTRACT:
+        op->decode(scratch, op->bit_offset, op->bit_size, endian, value);
+        break;
+    case DecodeOpType::EXTRACT_BITS:
+        op->decode(scratch, op->bit_offset, op->bit_size, endian, value);
+        value->base_type = op->base_type;  // byte types read at a bit offset go through the generic decoders.
+        break;
+    case DecodeOpType::EXTRACT_BIT_RUN:
+    {
+        uint64_t fields[BIT_RUN_MAX_FIELDS];
+        auto run = op->bit_run;
+        auto word = load_unsigned(scratch + op->bit_offset / 8, 8, Endian::little) >> (op->bit_offset % 8);
+        binaryreader::extract_bit_run(word, &run->fields, fields);
+
+        for (uint32_t i = 0; i < run->fields.count; i += 1) {
+            auto builtin = run->builtins[i];
+            auto field = &values[op->slot + i];
+            field->type = value_type_of(builtin->base_type);
+            field->base_type = builtin->base_type;
+            field->count = 1;
+            field->u64 = fields[i];
+            if (builtin->is_signed) {
+                auto shift = 64 - run->fields.widths[i];
+                field->s64 = (int64_t)(fields[i] << shift) >> shift;
+            }
+        }
+        break;
+    }
+    case DecodeOpType::EXTRACT_ARRAY:
+    {
+        auto byte_size = op->count * (op->bit_size / 8);
+        auto is_bytes = op->bit_size == 8;
+        value->base_type = op->base_type;
+        auto data = value_init_data(value, is_bytes ? ValueType::BYTES : ValueType::ARRAY, op->count, byte_size);
+        std::memcpy(data, src, byte_size);
+        if (platform::TextEncoding::NONE != op->encoding) {
+            decode_text(op->encoding, value);
+        } else {
+            decode_swap_array(data, op->count, op->bit_size / 8, endian);
+        }
+        break;
+    }
+    case DecodeOpType::EXTRACT_STRUCT:
+    {
+        if (!op->is_array) {
+            decode_extract_record(op->sub_plan, src, endian, value);
+            break;
+        }
+
+        auto stride = op->bit_size / 8;
+        auto records = value_init_children(value, ValueType::LIST, op->count);
+        for (uint64_t n = 0; n < op->count; n += 1) {
+            decode_extract_record(op->sub_plan, src + n * stride, endian, &records[n]);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void
+decode_text(platform::TextEncoding encoding, Value *value)
+{
+    auto unit_size = platform::text_encoding_unit_size(encoding);
+    auto is_view = ValueType::VIEW == value->type;
+    auto src = is_view ? value->view : value->data;
+    auto size = is_view ? value->count : value->count * unit_size;
+
+    if (is_view && platform::TextEncoding::UTF8 == encoding) {
+        if (platform::utf8_validate(src, size)) {
+            value->base_type = AstTypeInfo::CHAR;
+        }
+        return;
+    }
+
+    auto text = Value{};
+    text.base_type = AstTypeInfo::CHAR;
+    auto data = value_init_data(&text, ValueType::BYTES, 0, platform::utf8_capacity(encoding, size));
+    if (!platform::transcode_to_utf8(encoding, src, size, data, &text.count)) {
+        value_free(&text);
+        if (ValueType::ARRAY == value->type) {
+            decode_swap_array(value->data, value->count, unit_size, platform::text_encoding_endian(encoding));
+        }
+        return;
+    }
+
+    value_free(value);
+    *value = text;
+}
+
+void
+decode_extract_record(const DecodePlan *plan, const uint8_t *src, Endian endian, Value *out_record)
+{
+    auto values = value_init_children(out_record, ValueType::RECORD, plan->slot_count);
+    for (uint32_t i = 0; i < plan->op_count; i += 1) {
+        auto op = &plan->ops[i];
+        if (DecodeOpType::READ_RUN != op->type) {
+            decode_extract(op, src, endian, values);
+        }
+    }
+}
+
+bool
+decode_op_count(const DecodeOp *op, const Value *values, uint64_t *out_count, DecodeStatus *out_status)
+{
+    if (op->is_unbounded) {
+        *out_status = DecodeStatus::UNBOUNDED_ARRAY;
+        return false;
+    }
+    if (DECODE_NO_SLOT == op->count_slot) {
+        *out_count = op->count;
+        return true;
+    }
+
+    auto &count_value = values[op->count_slot];
+    if ((ValueType::SIGNED == count_value.type && count_value.s64 < 0) ||
+        (ValueType::UNSIGNED != count_value.type && ValueType::SIGNED != count_value.type)) {
+        *out_status = DecodeStatus::LENGTH_OVERFLOW;
+        return false;
+    }
+
+    *out_count = count_value.u64;
+    return true;
+}
+
+/*
+ * Decoder of _builtin_ stored at any bit offset. Byte sized integers fall
+ * back to the generic bit decoders, floats and bools must be byte aligned.
+ */
+static BuiltinDecoder
+decode_bits_of(const BuiltinType *builtin)
+{
+    switch (value_type_of(builtin->base_type)) {
+    case ValueType::UNSIGNED:
+        return &decode_builtin_unsigned;
+    case ValueType::SIGNED:
+        return &decode_builtin_signed;
+    default:
+        return nullptr;
+    }
+}
+
+/*
+ * Replaces runs of adjacent EXTRACT_BITS ops with EXTRACT_BIT_RUN ops, so
+ * packed fields (DosDate's u5 u4 u7) come out of one load.
+ */
+static void
+decode_plan_merge_bits(DecodePlan *plan)
+{
+    uint32_t out = 0;
+    for (uint32_t i = 0; i < plan->op_count;) {
+        auto first = &plan->ops[i];
+        uint32_t end = i + 1;
+        uint32_t total_bits = first->bit_size;
+        if (DecodeOpType::EXTRACT_BITS == first->type) {
+            while (end < plan->op_count && end - i < BIT_RUN_MAX_FIELDS) {
+                auto op = &plan->ops[end];
+                auto prev = &plan->ops[end - 1];
+                auto is_adjacent = DecodeOpType::EXTRACT_BITS == op->type && op->slot == prev->slot + 1 &&
+                                   op->bit_offset == prev->bit_offset + prev->bit_size;
+                if (!is_adjacent || total_bits + op->bit_size > BIT_READER_REFILL_BITS) {
+                    break;
+                }
+                total_bits += op->bit_size;
+                end += 1;
+            }
+        }
+
+        if (end - i < 2) {
+            plan->ops[out++] = plan->ops[i++];
+            continue;
+        }
+
+        auto bit_run = (DecodeBitRun *)std::calloc(1, sizeof(DecodeBitRun));
+        if (!bit_run) {
+            std::exit(1);
+        }
+        uint8_t widths[BIT_RUN_MAX_FIELDS];
+        for (uint32_t n = i; n < end; n += 1) {
+            widths[n - i] = (uint8_t)plan->ops[n].bit_size;
+            bit_run->builtins[n - i] = type_registry_find(plan->ops[n].base_type);
+        }
+        binaryreader::bit_run_init(&bit_run->fields, widths, end - i, binaryreader::BitOrder::LSB_FIRST);
+
+        auto run_op = plan->ops[i];
+        run_op.type = DecodeOpType::EXTRACT_BIT_RUN;
+        run_op.bit_size = total_bits;
+        run_op.count = end - i;
+        run_op.decode = nullptr;
+        run_op.bit_run = bit_run;
+        plan->ops[out++] = run_op;
+        i = end;
+    }
+    plan->op_count = out;
+}
+
+/*
+ * Closes the open run, if any.
+ */
+static void
+decode_plan_close_run(DecodePlan *plan, uint32_t *run_op, uint64_t *run_bits)
+{
+    if (DECODE_NO_SLOT == *run_op) {
+        return;
+    }
+
+    auto run_size = (uint32_t)((*run_bits + 7) / 8);
+    plan->ops[*run_op].offset = run_size;
+    plan->scratch_size = std::max(plan->scratch_size, run_size);
+    plan->run_count += 1;
+
+    *run_op = DECODE_NO_SLOT;
+    *run_bits = 0;
+}
+
+DecodePlan *
+decode_plan_compile(AstTypeStruct *struct_def)
+{
+    if (struct_def->decode_plan) {
+        return struct_def->decode_plan;
+    }
+
+    auto plan = (DecodePlan *)std::calloc(1, sizeof(DecodePlan));
+    if (!plan) {
+        std::exit(1);
+    }
+    plan->struct_def = struct_def;
+    struct_def->decode_plan = plan;
+
+    auto layout = layout_struct(struct_def);
+    plan->slot_count = layout->field_count;
+    plan->min_byte_size = layout->bit_size / 8;
+    plan->ops = (DecodeOp *)std::calloc(layout->field_count * 2 + 1, sizeof(DecodeOp));
+    if (!plan->ops) {
+        std::exit(1);
+    }
+
+    uint32_t run_op = DECODE_NO_SLOT;
+    uint64_t run_bits = 0;
+    for (uint32_t slot = 0; slot < layout->field_count; slot += 1) {
+        auto field_layout = &layout->fields[slot];
+        auto is_struct = AstTypeInfo::STRUCT == field_layout->base_type;
+        auto is_array = !ast_vardef_count(field_layout->field).empty();
+        auto element_bits = (uint32_t)field_layout->element_bits;
+        auto sub_plan = is_struct ? decode_plan_compile((AstTypeStruct *)field_layout->type) : nullptr;
+        auto builtin = field_layout->builtin;
+        auto base_type = field_layout->base_type;
+        if (AstTypeInfo::STRING == field_layout->base_type) {
+            builtin = type_registry_find(AstTypeInfo::U8);
+            base_type = AstTypeInfo::U8;
+            element_bits = 8;  // fixed strings are stored as their characters.
+            is_array = true;
+        }
+
+        DecodeOp op = {};
+        op.slot = slot;
+        op.base_type = base_type;
+        op.bit_size = element_bits;
+        op.count = field_layout->count;
+        op.count_slot = DECODE_NO_SLOT;
+        op.is_array = is_array;
+        op.is_lazy = is_lazy_field(field_layout->field);
+        op.sub_plan = sub_plan;
+        op.encoding = field_layout->encoding;
+        if (builtin && builtin->decode && !is_array) {
+            op.target_plan = pointer_target_plan(struct_def, field_layout->field);
+        }
+
+        uint64_t field_bits = 0;
+        auto is_scalar = builtin && builtin->decode;
+        auto fits_run = field_layout->is_fixed && checked_mul(field_layout->element_bits, field_layout->count, &field_bits) &&
+                        field_bits <= DECODE_MAX_RUN * 8 && (is_scalar || is_struct);
+
+        if (fits_run) {
+            // A run starting mid-byte can't be read on its own, so runs are only split at byte boundaries.
+            if (DECODE_NO_SLOT != run_op && run_bits % 8 == 0 && run_bits + field_bits > DECODE_MAX_RUN * 8) {
+                decode_plan_close_run(plan, &run_op, &run_bits);
+            }
+            if (DECODE_NO_SLOT == run_op) {
+                run_op = plan->op_count;
+                plan->ops[run_op].type = DecodeOpType::READ_RUN;
+                plan->ops[run_op].slot = DECODE_NO_SLOT;
+                plan->op_count += 1;
+            }
+
+            auto is_aligned = run_bits % 8 == 0;
+            op.offset = (uint32_t)(run_bits / 8);
+            op.bit_offset = (uint32_t)run_bits;
+            if (is_struct) {
+                op.type = is_aligned ? DecodeOpType::EXTRACT_STRUCT : DecodeOpType::UNSUPPORTED;
+            } else if (is_array) {
+                op.type = is_aligned && is_byte_sized(element_bits) ? DecodeOpType::EXTRACT_ARRAY
+                                                                    : DecodeOpType::UNSUPPORTED;
+            } else if (is_aligned && is_byte_sized(element_bits)) {
+                op.type = DecodeOpType::EXTRACT;
+                op.decode = builtin->decode;
+            } else {
+                op.decode = decode_bits_of(builtin);
+                op.type = op.decode ? DecodeOpType::EXTRACT_BITS : DecodeOpType::UNSUPPORTED;
+            }
+            run_bits += field_bits;
+            plan->ops[plan->op_count] = op;
+            plan->op_count += 1;
+            continue;
+        }
+
+        decode_plan_close_run(plan, &run_op, &run_bits);
+
+        if (field_layout->count == 0) {
+            auto count = ast_vardef_count(field_layout->field);
+            auto count_layout = layout_find_field(layout, count);
+            if (".." == count) {
+                op.is_unbounded = true;
+            } else if (count_layout && count_layout < field_layout) {
+                op.count_slot = (uint32_t)(count_layout - layout->fields);
+            } else {
+                op.type = DecodeOpType::UNSUPPORTED;
+            }
+        }
+
+        if (DecodeOpType::UNSUPPORTED == op.type) {
+            // Keeps the unknown count.
+        } else if (is_struct) {
+            op.type = DecodeOpType::READ_STRUCT;
+        } else if (is_scalar && is_byte_sized(element_bits)) {
+            op.type = DecodeOpType::READ_ARRAY;
+            op.is_array = true;
+        } else {
+            op.type = DecodeOpType::UNSUPPORTED;
+        }
+        plan->ops[plan->op_count] = op;
+        plan->op_count += 1;
+    }
+    decode_plan_close_run(plan, &run_op, &run_bits);
+    decode_plan_merge_bits(plan);
+
+    return plan;
+}
+
+}  // namespace astraea
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/decode_table.hpp"
+#include "include/core/layout.hpp"
+#include "include/utils/cpu.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace astraea {
+
+static uint32_t
+column_width(uint32_t bit_size)
+{
+    if (bit_size <= 8) return 1;
+    if (bit_size <= 16) return 2;
+    if (bit_size <= 32) return 4;
+    return 8;
+}
+
+static void
+decode_table_add_column(
+    DecodedTable *table, const uint32_t *path, uint32_t depth, AstTypeInfo base_type, uint32_t bit_offset,
+    uint32_t bit_size, uint64_t per_record)
+{
+    auto reallocated_buffer =
+        (TableColumn *)std::realloc(table->columns, (table->column_count + 1) * sizeof(TableColumn));
+    if (!reallocated_buffer) {
+        std::exit(1);
+    }
+    table->columns = reallocated_buffer;
+
+    auto &column = table->columns[table->column_count];
+    table->column_count += 1;
+    std::memset(&column, 0, sizeof(TableColumn));
+    std::memcpy(column.path, path, depth * sizeof(uint32_t));
+    column.depth = depth;
+    column.base_type = base_type;
+    column.bit_offset = bit_offset;
+    column.bit_size = bit_size;
+    column.width = column_width(bit_size);
+    column.per_record = per_record;
+}
+
+/*
+ * Appends a column for every leaf field of _plan_, flattening fixed nested
+ * structs. Returns false for shapes that cannot be split in columns.
+ */
+static bool
+decode_table_add_columns(
+    DecodedTable *table, const DecodePlan *plan, uint32_t *path, uint32_t depth, uint32_t base_bit_offset)
+{
+    if (depth >= DECODE_TABLE_MAX_DEPTH) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < plan->op_count; i += 1) {
+        auto op = &plan->ops[i];
+        path[depth] = op->slot;
+        switch (op->type) {
+        case DecodeOpType::READ_RUN:
+            continue;
+        case DecodeOpType::EXTRACT_STRUCT:
+        {
+            if (op->is_array) {
+                return false;
+            }
+            if (!decode_table_add_columns(table, op->sub_plan, path, depth + 1, base_bit_offset + op->bit_offset)) {
+                return false;
+            }
+            continue;
+        }
+        case DecodeOpType::EXTRACT_BIT_RUN:
+        {
+            auto run = &op->bit_run->fields;
+            for (uint32_t n = 0; n < run->count; n += 1) {
+                path[depth] = op->slot + n;
+                auto bit_offset = base_bit_offset + op->bit_offset + run->shifts[n];  // LSB first, shift is the offset.
+                decode_table_add_column(
+                    table, path, depth + 1, op->bit_run->builtins[n]->base_type, bit_offset, run->widths[n], 1);
+            }
+            continue;
+        }
+        case DecodeOpType::EXTRACT:
+        case DecodeOpType::EXTRACT_BITS:
+        case DecodeOpType::EXTRACT_ARRAY:
+        {
+            auto per_record = DecodeOpType::EXTRACT_ARRAY == op->type ? op->count : 1;
+            decode_table_add_column(
+                table, path, depth + 1, op->base_type, base_bit_offset + op->bit_offset, op->bit_size, per_record);
+            continue;
+        }
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+decode_table_init(DecodedTable *table, const DecodePlan *plan, uint64_t count)
+{
+    std::memset(table, 0, sizeof(DecodedTable));
+    auto layout = plan->struct_def->layout;
+    if (!layout || !layout->is_fixed || plan->run_count > 1 || layout->byte_size > 0xFFFFFFFF) {
+        return false;
+    }
+
+    table->plan = plan;
+    table->count = count;
+    table->stride = (uint32_t)layout->byte_size;
+
+    uint32_t path[DECODE_TABLE_MAX_DEPTH];
+    if (!decode_table_add_columns(table, plan, path, 0, 0)) {
+        decode_table_free(table);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < table->column_count; i += 1) {
+        auto &column = table->columns[i];
+        uint64_t byte_size = 0;
+        if (!checked_mul<uint64_t>(count, column.per_record * column.width, &byte_size)) {
+            decode_table_free(table);
+            return false;
+        }
+        column.data = (uint8_t *)std::malloc(byte_size ? (size_t)byte_size : 1);
+        if (!column.data) {
+            std::exit(1);
+        }
+    }
+
+    return true;
+}
+
+void
+decode_table_free(DecodedTable *table)
+{
+    for (uint32_t i = 0; i < table->column_count; i += 1) {
+        std::free(table->columns[i].data);
+    }
+    std::free(table->columns);
+    table->columns = nullptr;
+    table->column_count = 0;
+}
+
+#ifdef ARCH_X86
+/*
+ * Gathers a 2, 4 or 8 byte field of 8 (4 for 8 bytes) records per iteration
+ * and byte swaps it with a shuffle. Returns the number of records done, the
+ * caller finishes the tail.
+ */
+ASTRAEA_TARGET("avx2")
+static uint64_t
+split_column_avx2(
+    const uint8_t *records, uint64_t count, uint32_t stride, uint32_t offset, uint32_t width, bool swap,
+    uint8_t *out)
+{
+    // Indices are 32-bit, the records of one gather must span less than 2 GiB.
+    if ((uint64_t)stride * 8 > 0x7FFFFFFF) {
+        return 0;
+    }
+
+    const auto s = (int32_t)stride;
+    const auto index = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+    uint64_t i = 0;
+
+    switch (width) {
+    case 2:
+    {
+        // The 32-bit gather reads two bytes past the field, keep it inside the buffer.
+        auto safe_count = offset + 4 > stride ? count - std::min<uint64_t>(count, 1) : count;
+        const auto pack = swap ? _mm256_setr_epi8(
+                                     1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+                                     1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1)
+                               : _mm256_setr_epi8(
+                                     0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                     0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        for (; i + 8 <= safe_count; i += 8) {
+            auto base = (const int *)(records + i * stride + offset);
+            auto v = _mm256_i32gather_epi32(base, index, 1);
+            v = _mm256_shuffle_epi8(v, pack);
+            v = _mm256_permute4x64_epi64(v, 0x08);  // qwords 0 and 2 to the low lane.
+            _mm_storeu_si128((__m128i *)(out + i * 2), _mm256_castsi256_si128(v));
+        }
+        break;
+    }
+    case 4:
+    {
+        const auto bswap = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for (; i + 8 <= count; i += 8) {
+            auto base = (const int *)(records + i * stride + offset);
+            auto v = _mm256_i32gather_epi32(base, index, 1);
+            if (swap) v = _mm256_shuffle_epi8(v, bswap);
+            _mm256_storeu_si256((__m256i *)(out + i * 4), v);
+        }
+        break;
+    }
+    case 8:
+    {
+        const auto index4 = _mm256_castsi256_si128(index);
+        const auto bswap = _mm256_setr_epi8(
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        for (; i + 4 <= count; i += 4) {
+            auto base = (const long long *)(records + i * stride + offset);
+            auto v = _mm256_i32gather_epi64(base, index4, 1);
+            if (swap) v = _mm256_shuffle_epi8(v, bswap);
+            _mm256_storeu_si256((__m256i *)(out + i * 8), v);
+        }
+        break;
+    }
+    }
+
+    return i;
+}
+#endif
+
+/*
+ * Copies a byte aligned field of every record into _out_, swapping each
+ * element of _element_size_ bytes.
+ */
+static void
+split_column(
+    const uint8_t *records, uint64_t count, uint32_t stride, uint32_t offset, uint32_t field_size,
+    uint32_t element_size, Endian endian, uint8_t *out)
+{
+    auto swap = Endian::native != endian && element_size > 1;
+    uint64_t done = 0;
+#ifdef ARCH_X86
+    if (field_size == element_size && field_size > 1 && platform::cpu_has(platform::CPU_AVX2)) {
+        done = split_column_avx2(records, count, stride, offset, field_size, swap, out);
+    }
+#endif
+
+    auto src = records + done * stride + offset;
+    auto dst = out + done * field_size;
+    for (uint64_t i = done; i < count; i += 1) {
+        std::memcpy(dst, src, field_size);
+        src += stride;
+        dst += field_size;
+    }
+
+    auto tail = out + done * field_size;
+    auto tail_elements = (count - done) * (field_size / element_size);
+    if (swap) {
+        decode_swap_array(tail, tail_elements, element_size, endian);
+    }
+}
+
+/*
+ * Extracts a bitfield of every record, least significant bit first.
+ */
+static void
+split_bit_column(const uint8_t *records, uint64_t count, uint32_t stride, const TableColumn *column, uint8_t *out)
+{
+    auto byte = column->bit_offset / 8;
+    auto shift = column->bit_offset % 8;
+    auto span = (shift + column->bit_size + 7) / 8;
+    auto mask = column->bit_size < 64 ? (uint64_t{1} << column->bit_size) - 1 : ~uint64_t{0};
+    auto sign_shift = 64 - column->bit_size;
+    auto is_signed = ValueType::SIGNED == value_type_of(column->base_type);
+
+    for (uint64_t i = 0; i < count; i += 1) {
+        uint8_t window[16] = {};
+        std::memcpy(window, records + i * stride + byte, span);
+        auto raw = load_unsigned(window, 8, Endian::little) >> shift;
+        if (shift + column->bit_size > 64) {
+            raw |= (uint64_t)window[8] << (64 - shift);
+        }
+        raw &= mask;
+        if (is_signed) {
+            raw = (uint64_t)((int64_t)(raw << sign_shift) >> sign_shift);
+        }
+
+        switch (column->width) {
+        case 1:
+            out[i] = (uint8_t)raw;
+            break;
+        case 2:
+        {
+            auto value = (uint16_t)raw;
+            std::memcpy(out + i * 2, &value, 2);
+            break;
+        }
+        case 4:
+        {
+            auto value = (uint32_t)raw;
+            std::memcpy(out + i * 4, &value, 4);
+            break;
+        }
+        default:
+            std::memcpy(out + i * 8, &raw, 8);
+            break;
+        }
+    }
+}
+
+void
+decode_table_split(DecodedTable *table, const uint8_t *records, uint64_t first, uint64_t count, Endian endian)
+{
+    for (uint32_t i = 0; i < table->column_count; i += 1) {
+        auto column = &table->columns[i];
+        auto field_size = (uint32_t)(column->per_record * column->width);
+        auto out = column->data + first * field_size;
+
+        auto is_byte_field = column->bit_offset % 8 == 0 && column->bit_size == column->width * 8;
+        if (is_byte_field) {
+            split_column(records, count, table->stride, column->bit_offset / 8, field_size, column->width, endian, out);
+        } else {
+            split_bit_column(records, count, table->stride, column, out);
+        }
+    }
+}
+
+}  // namespace astraea
@@ -0,0 +1,333 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/detect.hpp"
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace astraea {
+
+/*
+ * Node of the automaton, _next_ is the complete transition table so the scan
+ * takes one lookup per byte and never follows failure links.
+ */
+struct DetectState {
+    uint32_t next[256];
+    uint32_t fail;
+    std::vector<uint32_t> outputs;  // signatures ending here, including the ones of the fail chain.
+};
+
+struct DetectSignature {
+    std::string bytes;
+    uint32_t format;
+};
+
+struct DetectGlob {
+    std::string mask;  // lower case.
+    uint32_t format;
+};
+
+struct FormatDetector {
+    std::vector<std::string> names;
+    std::vector<DetectSignature> signatures;
+    std::unordered_map<std::string, std::vector<uint32_t>> extensions;  // "*.zip" masks, by "zip".
+    std::vector<DetectGlob> globs;
+    std::vector<DetectState> states;
+};
+
+static std::string
+to_lower(std::string_view text)
+{
+    auto lower = std::string{text};
+    for (auto &ch : lower) {
+        if (ch >= 'A' && ch <= 'Z') {
+            ch = (char)(ch - 'A' + 'a');
+        }
+    }
+
+    return lower;
+}
+
+/*
+ * Matches _name_ against _mask_ with `*` and `?` wildcards.
+ */
+static bool
+glob_match(std::string_view mask, std::string_view name)
+{
+    size_t m = 0;
+    size_t n = 0;
+    size_t star = std::string_view::npos;
+    size_t star_name = 0;
+    while (n < name.size()) {
+        if (m < mask.size() && (mask[m] == '?' || mask[m] == name[n])) {
+            m += 1;
+            n += 1;
+        } else if (m < mask.size() && mask[m] == '*') {
+            star = m;
+            star_name = n;
+            m += 1;
+        } else if (star != std::string_view::npos) {
+            m = star + 1;
+            star_name += 1;
+            n = star_name;
+        } else {
+            return false;
+        }
+    }
+    while (m < mask.size() && mask[m] == '*') {
+        m += 1;
+    }
+
+    return m == mask.size();
+}
+
+/*
+ * Bytes of a `_metadata` literal: quoted strings as they are, hex numbers in
+ * the order their digits are written. Returns false for other literals.
+ */
+static bool
+literal_bytes(std::string_view literal, std::string *out_bytes)
+{
+    out_bytes->clear();
+    if (literal.size() >= 2 && literal.front() == '"' && literal.back() == '"') {
+        *out_bytes = literal.substr(1, literal.size() - 2);
+        return true;
+    }
+    if (literal.size() < 3 || literal[0] != '0' || (literal[1] != 'x' && literal[1] != 'X')) {
+        return false;
+    }
+
+    auto digits = std::string{literal.substr(2)};
+    if (digits.size() % 2 != 0) {
+        digits.insert(digits.begin(), '0');
+    }
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        char *end = nullptr;
+        auto pair = digits.substr(i, 2);
+        auto byte = std::strtoul(pair.c_str(), &end, 16);
+        if (end != pair.c_str() + 2) {
+            return false;
+        }
+        out_bytes->push_back((char)byte);
+    }
+
+    return true;
+}
+
+static std::string_view
+literal_text(AstNode *value)
+{
+    auto literal = std::string_view{((AstString *)value)->literal};
+    if (literal.size() >= 2 && literal.front() == '"' && literal.back() == '"') {
+        literal = literal.substr(1, literal.size() - 2);
+    }
+
+    return literal;
+}
+
+FormatDetector *
+detector_create()
+{
+    return new FormatDetector{};
+}
+
+void
+detector_destroy(FormatDetector *detector)
+{
+    delete detector;
+}
+
+uint32_t
+detector_add_format(FormatDetector *detector, std::string_view name)
+{
+    detector->names.emplace_back(name);
+    return (uint32_t)detector->names.size() - 1;
+}
+
+uint32_t
+detector_add_module(FormatDetector *detector, std::string_view name, AstNode *root)
+{
+    auto format = detector_add_format(detector, name);
+    if (!root || AstNodeType::COMPOUND != root->node_type) {
+        return format;
+    }
+
+    auto compound = (AstCompound *)root;
+    for (uint32_t i = 0; i < compound->statement_count; i += 1) {
+        auto statement = compound->statements[i];
+        if (!statement || AstNodeType::TYPE_DEFINITION != statement->node_type) {
+            continue;
+        }
+        auto type_def = (AstType *)statement;
+        if (AstTypeInfo::STRUCT != type_def->base_type || "_metadata" != type_def->name) {
+            continue;
+        }
+
+        auto block = (AstCompound *)((AstTypeStruct *)type_def)->block;
+        for (uint32_t j = 0; block && j < block->statement_count; j += 1) {
+            auto entry = block->statements[j];
+            if (!entry || AstNodeType::CONSTANT_DEFINITION != entry->node_type) {
+                continue;
+            }
+
+            auto constant = (AstConstant *)entry;
+            for (uint32_t k = 0; k < constant->value_count; k += 1) {
+                auto bytes = std::string{};
+                if ("signatures" == constant->name &&
+                    literal_bytes(((AstString *)constant->values[k])->literal, &bytes)) {
+                    detector_add_signature(detector, format, bytes.data(), (uint32_t)bytes.size());
+                } else if ("file_masks" == constant->name) {
+                    detector_add_mask(detector, format, literal_text(constant->values[k]));
+                }
+            }
+        }
+    }
+
+    return format;
+}
+
+void
+detector_add_signature(FormatDetector *detector, uint32_t format, const void *bytes, uint32_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    detector->signatures.push_back(DetectSignature{std::string{(const char *)bytes, size}, format});
+}
+
+void
+detector_add_mask(FormatDetector *detector, uint32_t format, std::string_view mask)
+{
+    auto lower = to_lower(mask);
+    auto extension = std::string_view{lower}.substr(std::min<size_t>(2, lower.size()));
+    auto is_extension = lower.size() > 2 && lower[0] == '*' && lower[1] == '.' &&
+                        extension.find_first_of("*?.") == std::string_view::npos;
+    if (is_extension) {
+        detector->extensions[std::string{extension}].push_back(format);
+    } else {
+        detector->globs.push_back(DetectGlob{lower, format});
+    }
+}
+
+void
+detector_compile(FormatDetector *detector)
+{
+    auto &states = detector->states;
+    states.clear();
+    states.emplace_back();  // root.
+
+    // Trie of the signatures, zero is also "no transition" while building.
+    for (uint32_t s = 0; s < detector->signatures.size(); s += 1) {
+        uint32_t state = 0;
+        for (auto ch : detector->signatures[s].bytes) {
+            auto &next = states[state].next[(uint8_t)ch];
+            if (next == 0) {
+                next = (uint32_t)states.size();
+                states.emplace_back();
+            }
+            state = states[state].next[(uint8_t)ch];
+        }
+        states[state].outputs.push_back(s);
+    }
+
+    // Breadth first, so the fail state of a node is complete before the node.
+    std::deque<uint32_t> queue;
+    for (uint32_t ch = 0; ch < 256; ch += 1) {
+        if (states[0].next[ch]) {
+            states[states[0].next[ch]].fail = 0;
+            queue.push_back(states[0].next[ch]);
+        }
+    }
+    while (!queue.empty()) {
+        auto state = queue.front();
+        queue.pop_front();
+
+        auto fail = states[state].fail;
+        auto &fail_outputs = states[fail].outputs;
+        states[state].outputs.insert(states[state].outputs.end(), fail_outputs.begin(), fail_outputs.end());
+        for (uint32_t ch = 0; ch < 256; ch += 1) {
+            auto next = states[state].next[ch];
+            if (next) {
+                states[next].fail = states[fail].next[ch];
+                queue.push_back(next);
+            } else {
+                states[state].next[ch] = states[fail].next[ch];
+            }
+        }
+    }
+}
+
+std::string_view
+detector_format_name(const FormatDetector *detector, uint32_t format)
+{
+    return format < detector->names.size() ? std::string_view{detector->names[format]} : std::string_view{};
+}
+
+uint32_t
+detector_match(
+    const FormatDetector *detector,
+    std::string_view file_name,
+    const uint8_t *head,
+    uint64_t head_size,
+    DetectCandidate *out_candidates,
+    uint32_t max_candidates)
+{
+    std::vector<uint32_t> scores(detector->names.size(), 0);
+
+    auto &states = detector->states;
+    auto size = std::min<uint64_t>(head_size, DETECT_HEAD_SIZE);
+    uint32_t state = 0;
+    for (uint64_t i = 0; !states.empty() && i < size; i += 1) {
+        state = states[state].next[head[i]];
+        for (auto s : states[state].outputs) {
+            auto &signature = detector->signatures[s];
+            auto length = (uint32_t)signature.bytes.size();
+            auto is_magic = i + 1 == length;  // starts at offset zero.
+            auto score = (is_magic ? DETECT_SCORE_MAGIC : DETECT_SCORE_EMBEDDED) + length;
+            scores[signature.format] = std::max(scores[signature.format], score);
+        }
+    }
+
+    auto separator = file_name.find_last_of("/\\");
+    auto base_name = to_lower(separator == std::string_view::npos ? file_name : file_name.substr(separator + 1));
+    std::vector<bool> has_mask(detector->names.size(), false);
+    auto dot = base_name.find_last_of('.');
+    if (dot != std::string::npos) {
+        auto found = detector->extensions.find(base_name.substr(dot + 1));
+        if (found != detector->extensions.end()) {
+            for (auto format : found->second) {
+                has_mask[format] = true;
+            }
+        }
+    }
+    for (auto &glob : detector->globs) {
+        if (!has_mask[glob.format] && glob_match(glob.mask, base_name)) {
+            has_mask[glob.format] = true;
+        }
+    }
+
+    std::vector<DetectCandidate> candidates;
+    for (uint32_t format = 0; format < scores.size(); format += 1) {
+        auto score = scores[format] + (has_mask[format] ? DETECT_SCORE_MASK : 0);
+        if (score > 0) {
+            candidates.push_back(DetectCandidate{format, score});
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const DetectCandidate &a, const DetectCandidate &b) {
+        return a.score > b.score;
+    });
+
+    auto count = std::min<uint32_t>((uint32_t)candidates.size(), max_candidates);
+    std::copy(candidates.begin(), candidates.begin() + count, out_candidates);
+    return count;
+}
+
+}  // namespace astraea
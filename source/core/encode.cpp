@@ -0,0 +1,388 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/encode.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace astraea {
+
+// Byte swapped array elements are written through a buffer of this size.
+#define ENCODE_SWAP_CHUNK (64 * 1024)
+
+static uint16_t
+half_of(double value)
+{
+    uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+    value = std::fabs(value);
+    if (std::isnan(value)) {
+        return sign | 0x7E00;
+    }
+    if (value < std::ldexp(1.0, -14)) {
+        return sign | (uint16_t)std::nearbyint(std::ldexp(value, 24));  // subnormal
+    }
+
+    int exponent;
+    auto fraction = std::frexp(value, &exponent);
+    auto mantissa = (uint32_t)std::nearbyint(std::ldexp(fraction, 11));
+    auto biased = exponent + 14;
+    if (mantissa == 2048) {
+        mantissa = 1024;  // rounded up to the next power of two.
+        biased += 1;
+    }
+    if (biased >= 31) {
+        return sign | 0x7C00;
+    }
+
+    return sign | (uint16_t)(biased << 10) | (uint16_t)(mantissa - 1024);
+}
+
+/*
+ * Bits of _value_ stored as _base_type_.
+ */
+static uint64_t
+raw_of(const Value *value, AstTypeInfo base_type, uint32_t bit_size)
+{
+    auto is_float = AstTypeInfo::F16 == base_type || AstTypeInfo::F32 == base_type ||
+                    AstTypeInfo::F64 == base_type || AstTypeInfo::FLOAT == base_type;
+    if (!is_float) {
+        if (ValueType::FLOAT == value->type) {
+            return (uint64_t)(int64_t)value->f64;
+        }
+        return value->u64;
+    }
+
+    auto number = value->f64;
+    if (ValueType::UNSIGNED == value->type) {
+        number = (double)value->u64;
+    } else if (ValueType::SIGNED == value->type) {
+        number = (double)value->s64;
+    }
+
+    switch (bit_size) {
+    case 16:
+        return half_of(number);
+    case 32:
+    {
+        auto single = (float)number;
+        uint32_t bits;
+        std::memcpy(&bits, &single, sizeof(bits));
+        return bits;
+    }
+    default:
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        return bits;
+    }
+    }
+}
+
+/*
+ * Stores the low _bit_size_ bits of _raw_ at _bit_offset_, least significant
+ * bit first, the other bits of _dst_ are kept.
+ */
+static void
+store_bits(uint8_t *dst, uint32_t bit_offset, uint32_t bit_size, uint64_t raw)
+{
+    for (uint32_t done = 0; done < bit_size;) {
+        auto byte = (bit_offset + done) / 8;
+        auto shift = (bit_offset + done) % 8;
+        auto count = std::min(8 - shift, bit_size - done);
+        auto mask = (uint8_t)(((1u << count) - 1) << shift);
+        dst[byte] = (uint8_t)((dst[byte] & ~mask) | (((raw >> done) << shift) & mask));
+        done += count;
+    }
+}
+
+void
+encode_scalar(const Value *value, AstTypeInfo base_type, uint8_t *dst, uint32_t bit_offset, uint32_t bit_size, Endian endian)
+{
+    auto raw = raw_of(value, base_type, bit_size);
+    auto is_byte_sized = bit_size == 8 || bit_size == 16 || bit_size == 32 || bit_size == 64;
+    if (bit_offset % 8 == 0 && is_byte_sized) {
+        store_unsigned(dst + bit_offset / 8, raw, bit_size / 8, endian);
+        return;
+    }
+
+    store_bits(dst, bit_offset, bit_size, raw);
+}
+
+/*
+ * Elements of a BYTES, ARRAY or VIEW value, null for the other types.
+ */
+static const uint8_t *
+array_data(const Value *value)
+{
+    switch (value->type) {
+    case ValueType::BYTES:
+    case ValueType::ARRAY:
+        return value->data;
+    case ValueType::VIEW:
+        return value->view;
+    default:
+        return nullptr;
+    }
+}
+
+/*
+ * Byte order of the elements of _op_, strings keep the one of their encoding.
+ */
+static Endian
+field_endian(const DecodeOp *op, Endian endian)
+{
+    return platform::TextEncoding::NONE == op->encoding ? endian : platform::text_encoding_endian(op->encoding);
+}
+
+/*
+ * Whether _value_ is the UTF-8 decode_text made of a string field of _op_.
+ */
+static bool
+is_text(const DecodeOp *op, const Value *value)
+{
+    return platform::TextEncoding::NONE != op->encoding && AstTypeInfo::CHAR == value->base_type &&
+           (ValueType::BYTES == value->type || ValueType::VIEW == value->type);
+}
+
+static void encode_fixed_record(const DecodePlan *plan, const Value *record, uint8_t *dst, Endian endian);
+
+/*
+ * Inverse of decode_extract, stores the field of _op_ into the run in _dst_.
+ */
+static void
+encode_extract(const DecodeOp *op, const Value *values, uint8_t *dst, Endian endian)
+{
+    auto value = &values[op->slot];
+
+    switch (op->type) {
+    case DecodeOpType::EXTRACT:
+    case DecodeOpType::EXTRACT_BITS:
+        encode_scalar(value, op->base_type, dst, op->bit_offset, op->bit_size, endian);
+        break;
+    case DecodeOpType::EXTRACT_BIT_RUN:
+    {
+        auto run = op->bit_run;
+        auto bit_offset = op->bit_offset;
+        for (uint32_t i = 0; i < run->fields.count; i += 1) {
+            store_bits(dst, bit_offset, run->fields.widths[i], values[op->slot + i].u64);
+            bit_offset += run->fields.widths[i];
+        }
+        break;
+    }
+    case DecodeOpType::EXTRACT_ARRAY:
+    {
+        auto element_size = op->bit_size / 8;
+        auto data = array_data(value);
+        if (is_text(op, value)) {
+            uint64_t size = 0;  // text too long for the field is cut after the last code point that fits.
+            platform::transcode_from_utf8(op->encoding, data, value->count, dst + op->offset, op->count * element_size, &size);
+            break;
+        }
+        auto count = data ? std::min(op->count, value->type == ValueType::VIEW ? value->count / element_size : value->count) : 0;
+        std::memcpy(dst + op->offset, data, (size_t)(count * element_size));
+        decode_swap_array(dst + op->offset, count, element_size, field_endian(op, endian));
+        break;
+    }
+    case DecodeOpType::EXTRACT_STRUCT:
+    {
+        if (!op->is_array) {
+            encode_fixed_record(op->sub_plan, value, dst + op->offset, endian);
+            break;
+        }
+
+        auto stride = op->bit_size / 8;
+        auto count = ValueType::LIST == value->type ? std::min(op->count, value->count) : 0;
+        for (uint64_t n = 0; n < count; n += 1) {
+            encode_fixed_record(op->sub_plan, &value->values[n], dst + op->offset + n * stride, endian);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void
+encode_fixed_record(const DecodePlan *plan, const Value *record, uint8_t *dst, Endian endian)
+{
+    if (ValueType::RECORD != record->type || record->count != plan->slot_count) {
+        return;  // left zeroed.
+    }
+
+    for (uint32_t i = 0; i < plan->op_count; i += 1) {
+        auto op = &plan->ops[i];
+        if (DecodeOpType::READ_RUN != op->type) {
+            encode_extract(op, record->values, dst, endian);
+        }
+    }
+}
+
+static DecodeStatus
+encode_array(const DecodeOp *op, const Value *value, binarywriter::WriterFile &writer, Endian endian)
+{
+    auto element_size = op->bit_size / 8;
+    auto data = array_data(value);
+    if (!data && value->count > 0) {
+        return DecodeStatus::UNSUPPORTED_TYPE;  // LAZY, or not an array.
+    }
+
+    if (is_text(op, value)) {
+        auto capacity = value->count * 4;  // UTF-32 takes 4 bytes per ASCII character.
+        auto units = (uint8_t *)std::malloc((size_t)std::max<uint64_t>(capacity, 1));
+        if (!units) {
+            std::exit(1);
+        }
+        uint64_t size = 0;
+        auto status = DecodeStatus::UNSUPPORTED_TYPE;
+        if (platform::transcode_from_utf8(op->encoding, data, value->count, units, capacity, &size)) {
+            status = binarywriter::write_bytes(writer, units, size) ? DecodeStatus::OK : DecodeStatus::WRITE_FAILED;
+        }
+        std::free(units);
+        return status;
+    }
+    endian = field_endian(op, endian);
+
+    auto byte_size = ValueType::VIEW == value->type ? value->count : value->count * element_size;
+    if (Endian::native == endian || element_size == 1) {
+        return binarywriter::write_bytes(writer, data, byte_size) ? DecodeStatus::OK : DecodeStatus::WRITE_FAILED;
+    }
+
+    uint8_t chunk[ENCODE_SWAP_CHUNK];
+    auto chunk_size = ENCODE_SWAP_CHUNK / element_size * element_size;
+    for (uint64_t done = 0; done < byte_size; done += chunk_size) {
+        auto size = std::min<uint64_t>(chunk_size, byte_size - done);
+        std::memcpy(chunk, data + done, (size_t)size);
+        decode_swap_array(chunk, size / element_size, element_size, endian);
+        if (!binarywriter::write_bytes(writer, chunk, size)) {
+            return DecodeStatus::WRITE_FAILED;
+        }
+    }
+
+    return DecodeStatus::OK;
+}
+
+DecodeStatus
+encode_plan_execute(const DecodePlan *plan, const Value *record, binarywriter::WriterFile &writer, Endian endian)
+{
+    if (ValueType::RECORD != record->type || record->count != plan->slot_count) {
+        return DecodeStatus::UNSUPPORTED_TYPE;
+    }
+
+    auto scratch = (uint8_t *)std::calloc(plan->scratch_size + 16, 1);
+    if (!scratch) {
+        std::exit(1);
+    }
+
+    auto status = DecodeStatus::OK;
+    uint32_t run_size = 0;  // bytes of the run being filled in _scratch_.
+    auto flush_run = [&]() {
+        if (run_size > 0 && !binarywriter::write_bytes(writer, scratch, run_size)) {
+            status = DecodeStatus::WRITE_FAILED;
+        }
+        run_size = 0;
+    };
+
+    auto values = record->values;
+    for (uint32_t i = 0; i < plan->op_count && DecodeStatus::OK == status; i += 1) {
+        auto op = &plan->ops[i];
+        switch (op->type) {
+        case DecodeOpType::READ_RUN:
+            flush_run();
+            std::memset(scratch, 0, op->offset);
+            run_size = op->offset;
+            break;
+        case DecodeOpType::EXTRACT:
+        case DecodeOpType::EXTRACT_BITS:
+        case DecodeOpType::EXTRACT_BIT_RUN:
+        case DecodeOpType::EXTRACT_ARRAY:
+        case DecodeOpType::EXTRACT_STRUCT:
+            encode_extract(op, values, scratch, endian);
+            break;
+        case DecodeOpType::READ_ARRAY:
+            flush_run();
+            if (DecodeStatus::OK == status) {
+                status = encode_array(op, &values[op->slot], writer, endian);
+            }
+            break;
+        case DecodeOpType::READ_STRUCT:
+        {
+            flush_run();
+            auto &value = values[op->slot];
+            if (DecodeStatus::OK != status || !op->is_array) {
+                status = DecodeStatus::OK == status ? encode_plan_execute(op->sub_plan, &value, writer, endian) : status;
+                break;
+            }
+            if (ValueType::LIST != value.type) {
+                status = DecodeStatus::UNSUPPORTED_TYPE;
+                break;
+            }
+            for (uint64_t n = 0; n < value.count && DecodeStatus::OK == status; n += 1) {
+                status = encode_plan_execute(op->sub_plan, &value.values[n], writer, endian);
+            }
+            break;
+        }
+        case DecodeOpType::UNSUPPORTED:
+            status = DecodeStatus::UNSUPPORTED_TYPE;
+            break;
+        }
+    }
+    if (DecodeStatus::OK == status) {
+        flush_run();
+    }
+    std::free(scratch);
+
+    return status;
+}
+
+bool
+encode_patch_field(
+    const DecodePlan *plan,
+    uint64_t record_offset,
+    uint32_t slot,
+    const Value *value,
+    Endian endian,
+    binarywriter::PatchJournal *journal)
+{
+    uint64_t offset = 0;      // bytes of the record before the current op.
+    uint64_t run_offset = 0;  // record offset of the current run.
+    for (uint32_t i = 0; i < plan->op_count; i += 1) {
+        auto op = &plan->ops[i];
+        if (DecodeOpType::READ_RUN == op->type) {
+            run_offset = offset;
+            offset += op->offset;
+            continue;
+        }
+
+        auto is_field = op->slot == slot ||
+                        (DecodeOpType::EXTRACT_BIT_RUN == op->type && slot >= op->slot &&
+                         slot < op->slot + op->bit_run->fields.count);
+        if (is_field) {
+            if (DecodeOpType::EXTRACT != op->type) {
+                return false;  // bit fields and arrays are not patched.
+            }
+            uint8_t bytes[8] = {};
+            encode_scalar(value, op->base_type, bytes, 0, op->bit_size, endian);
+            binarywriter::patch_add(journal, record_offset + run_offset + op->offset, bytes, op->bit_size / 8);
+            return true;
+        }
+
+        // Fields after a variable sized one have no fixed offset.
+        auto is_fixed_array = DecodeOpType::READ_ARRAY == op->type && DECODE_NO_SLOT == op->count_slot && !op->is_unbounded;
+        if (is_fixed_array) {
+            offset += op->count * (op->bit_size / 8);
+        } else if (DecodeOpType::READ_ARRAY == op->type || DecodeOpType::READ_STRUCT == op->type ||
+                   DecodeOpType::UNSUPPORTED == op->type) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+}  // namespace astraea
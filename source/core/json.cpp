@@ -0,0 +1,420 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/json.hpp"
+#include "include/core/layout.hpp"
+#include "include/utils/binarywriter.hpp"
+#include "include/utils/cpu.hpp"
+#include "include/utils/platform_console.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace astraea {
+
+void
+json_writer_init(JsonWriter *writer, JsonMode mode, JsonFlush flush, void *user)
+{
+    *writer = JsonWriter{};
+    writer->buffer = (uint8_t *)std::malloc(JSON_WRITER_BUFFER_SIZE);
+    if (!writer->buffer) {
+        std::exit(1);
+    }
+    writer->flush = flush;
+    writer->user = user;
+    writer->mode = mode;
+}
+
+bool
+json_writer_flush(JsonWriter *writer)
+{
+    if (writer->count > 0 && !writer->has_failed) {
+        writer->has_failed = !writer->flush(writer->user, writer->buffer, writer->count);
+        writer->flushed += writer->count;
+    }
+    writer->count = 0;
+    return !writer->has_failed;
+}
+
+/*
+ * Room for _size_ more bytes at the end of the buffer, flushed if needed.
+ */
+static uint8_t *
+json_reserve(JsonWriter *writer, uint64_t size)
+{
+    if (writer->count + size > JSON_WRITER_BUFFER_SIZE) {
+        json_writer_flush(writer);
+    }
+    return writer->buffer + writer->count;
+}
+
+static void
+json_put(JsonWriter *writer, std::string_view text)
+{
+    auto out = json_reserve(writer, text.size());
+    std::memcpy(out, text.data(), text.size());
+    writer->count += text.size();
+}
+
+static void
+json_put(JsonWriter *writer, char ch)
+{
+    json_reserve(writer, 1)[0] = (uint8_t)ch;
+    writer->count += 1;
+}
+
+bool
+json_writer_finish(JsonWriter *writer)
+{
+    if (JsonMode::DOCUMENT == writer->mode) {
+        json_put(writer, writer->record_count ? "]\n" : "[]\n");
+    }
+    auto is_written = json_writer_flush(writer);
+    std::free(writer->buffer);
+    writer->buffer = nullptr;
+
+    return is_written;
+}
+
+template <typename Type>
+static void
+json_number(JsonWriter *writer, Type number)
+{
+    if constexpr (std::is_floating_point_v<Type>) {
+        if (!std::isfinite(number)) {
+            json_put(writer, "null");  // JSON has no NaN nor infinities.
+            return;
+        }
+    }
+
+    auto out = (char *)json_reserve(writer, 32);
+    auto result = std::to_chars(out, out + 32, number);
+    writer->count += (uint64_t)(result.ptr - out);
+}
+
+static inline bool
+json_needs_escape(uint8_t byte, bool is_latin1)
+{
+    return byte < 0x20 || byte == '"' || byte == '\\' || (is_latin1 && byte >= 0x80);
+}
+
+static uint8_t *
+json_escape_byte(uint8_t *out, uint8_t byte)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    out[0] = '\\';
+    switch (byte) {
+    case '"': out[1] = '"'; return out + 2;
+    case '\\': out[1] = '\\'; return out + 2;
+    case '\b': out[1] = 'b'; return out + 2;
+    case '\f': out[1] = 'f'; return out + 2;
+    case '\n': out[1] = 'n'; return out + 2;
+    case '\r': out[1] = 'r'; return out + 2;
+    case '\t': out[1] = 't'; return out + 2;
+    }
+    out[1] = 'u';
+    out[2] = '0';
+    out[3] = '0';
+    out[4] = (uint8_t)hex_digits[byte >> 4];
+    out[5] = (uint8_t)hex_digits[byte & 15];
+    return out + 6;
+}
+
+#ifdef ARCH_X86
+
+/*
+ * Copies 16 bytes at a time, the block is stored before it is checked so
+ * _dst_ needs 16 bytes of room past _size_. Returns the bytes before the
+ * first one to escape.
+ */
+ASTRAEA_TARGET("sse2")
+static uint64_t
+json_copy_plain_sse2(const uint8_t *src, uint64_t size, uint8_t *dst, bool is_latin1)
+{
+    auto quote = _mm_set1_epi8('"');
+    auto backslash = _mm_set1_epi8('\\');
+    auto last_control = _mm_set1_epi8(0x1F);
+    uint64_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        auto bytes = _mm_loadu_si128((const __m128i *)(src + pos));
+        _mm_storeu_si128((__m128i *)(dst + pos), bytes);
+        auto is_control = _mm_cmpeq_epi8(_mm_max_epu8(bytes, last_control), last_control);
+        auto is_special = _mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash));
+        auto mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(is_control, is_special));
+        if (is_latin1) {
+            mask |= (uint32_t)_mm_movemask_epi8(bytes);
+        }
+        if (mask) {
+            return pos + std::countr_zero(mask);
+        }
+    }
+    return pos;
+}
+
+#endif
+
+/*
+ * Writes the _size_ bytes at _data_ as a JSON string, _is_latin1_ escapes
+ * the bytes over 0x7F as the code points of the same value.
+ */
+static void
+json_string(JsonWriter *writer, const uint8_t *data, uint64_t size, bool is_latin1)
+{
+#ifdef ARCH_X86
+    auto has_sse2 = platform::cpu_has(platform::CPU_SSE2);
+#endif
+
+    json_put(writer, '"');
+    uint64_t pos = 0;
+    while (pos < size) {
+        auto end = pos + std::min<uint64_t>(size - pos, JSON_ESCAPE_CHUNK);
+        auto out = json_reserve(writer, (end - pos) * 6 + 16);
+        while (pos < end) {
+#ifdef ARCH_X86
+            if (has_sse2) {
+                auto plain = json_copy_plain_sse2(data + pos, end - pos, out, is_latin1);
+                pos += plain;
+                out += plain;
+            }
+#endif
+            for (; pos < end && !json_needs_escape(data[pos], is_latin1); pos += 1) {
+                *out++ = data[pos];
+            }
+            if (pos < end) {
+                out = json_escape_byte(out, data[pos]);
+                pos += 1;
+            }
+        }
+        writer->count = (uint64_t)(out - writer->buffer);
+    }
+    json_put(writer, '"');
+}
+
+static void
+json_text(JsonWriter *writer, const uint8_t *data, uint64_t size)
+{
+    json_string(writer, data, size, !platform::utf8_validate(data, size));
+}
+
+static void
+json_scalar(JsonWriter *writer, const Value *value)
+{
+    switch (value->type) {
+    case ValueType::UNSIGNED:
+        json_number(writer, value->u64);
+        break;
+    case ValueType::SIGNED:
+        json_number(writer, value->s64);
+        break;
+    case ValueType::FLOAT:
+        json_number(writer, value->f64);
+        break;
+    case ValueType::BOOL:
+        json_put(writer, value->u64 ? "true" : "false");
+        break;
+    default:
+        json_put(writer, "null");
+        break;
+    }
+}
+
+template <typename Type>
+static void
+json_numbers(JsonWriter *writer, const uint8_t *data, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i += 1) {
+        Type element;
+        std::memcpy(&element, data + i * sizeof(Type), sizeof(Type));
+        if (i > 0) {
+            json_put(writer, ',');
+        }
+        json_number(writer, element);
+    }
+}
+
+/*
+ * Writes _count_ elements of _base_type_, in native byte order, as an array.
+ */
+static void
+json_elements(JsonWriter *writer, AstTypeInfo base_type, const uint8_t *data, uint64_t count)
+{
+    json_put(writer, '[');
+    switch (base_type) {
+    case AstTypeInfo::U8: json_numbers<uint8_t>(writer, data, count); break;
+    case AstTypeInfo::U16: json_numbers<uint16_t>(writer, data, count); break;
+    case AstTypeInfo::U32: json_numbers<uint32_t>(writer, data, count); break;
+    case AstTypeInfo::U64: json_numbers<uint64_t>(writer, data, count); break;
+    case AstTypeInfo::S8: json_numbers<int8_t>(writer, data, count); break;
+    case AstTypeInfo::S16: json_numbers<int16_t>(writer, data, count); break;
+    case AstTypeInfo::S32: json_numbers<int32_t>(writer, data, count); break;
+    case AstTypeInfo::S64: json_numbers<int64_t>(writer, data, count); break;
+    case AstTypeInfo::F32: json_numbers<float>(writer, data, count); break;
+    case AstTypeInfo::F64: json_numbers<double>(writer, data, count); break;
+    default:
+    {
+        // Halves, bools and the other builtins go through their decoders.
+        auto builtin = type_registry_find(base_type);
+        uint32_t element_size = builtin ? builtin->bit_size / 8 : 0;
+        for (uint64_t i = 0; i < count && element_size > 0; i += 1) {
+            auto element = Value{};
+            builtin->decode(data + i * element_size, 0, builtin->bit_size, Endian::native, &element);
+            if (i > 0) {
+                json_put(writer, ',');
+            }
+            json_scalar(writer, &element);
+        }
+        break;
+    }
+    }
+    json_put(writer, ']');
+}
+
+static DecodeStatus json_record(JsonWriter *writer, const DecodePlan *plan, const Value *record);
+
+/*
+ * Plan of the records held by a struct field, null for the other fields.
+ */
+static const DecodePlan *
+json_sub_plan(const FieldLayout *field_layout)
+{
+    if (AstTypeInfo::STRUCT != field_layout->base_type || !field_layout->type) {
+        return nullptr;
+    }
+    return decode_plan_compile((AstTypeStruct *)field_layout->type);
+}
+
+static DecodeStatus
+json_value(JsonWriter *writer, const FieldLayout *field_layout, const Value *value)
+{
+    switch (value->type) {
+    case ValueType::BYTES:
+    case ValueType::VIEW:
+    {
+        auto data = ValueType::BYTES == value->type ? value->data : value->view;
+        if (AstTypeInfo::CHAR == value->base_type) {
+            json_text(writer, data, value->count);
+        } else {
+            json_elements(writer, value->base_type, data, value->count);
+        }
+        break;
+    }
+    case ValueType::ARRAY:
+        json_elements(writer, value->base_type, value->data, value->count);
+        break;
+    case ValueType::RECORD:
+    {
+        auto sub_plan = json_sub_plan(field_layout);
+        if (!sub_plan) {
+            return DecodeStatus::UNSUPPORTED_TYPE;
+        }
+        return json_record(writer, sub_plan, value);
+    }
+    case ValueType::LIST:
+    {
+        auto sub_plan = json_sub_plan(field_layout);
+        if (!sub_plan) {
+            return DecodeStatus::UNSUPPORTED_TYPE;
+        }
+        json_put(writer, '[');
+        for (uint64_t i = 0; i < value->count; i += 1) {
+            if (i > 0) {
+                json_put(writer, ',');
+            }
+            auto status = json_record(writer, sub_plan, &value->values[i]);
+            if (DecodeStatus::OK != status) {
+                return status;
+            }
+        }
+        json_put(writer, ']');
+        break;
+    }
+    case ValueType::LAZY:
+        return DecodeStatus::UNSUPPORTED_TYPE;
+    default:
+        json_scalar(writer, value);
+        break;
+    }
+
+    return DecodeStatus::OK;
+}
+
+static DecodeStatus
+json_record(JsonWriter *writer, const DecodePlan *plan, const Value *record)
+{
+    auto layout = plan->struct_def->layout;
+    auto count = std::min<uint64_t>(record->count, layout->field_count);
+
+    json_put(writer, '{');
+    for (uint64_t slot = 0; slot < count; slot += 1) {
+        auto field_layout = &layout->fields[slot];
+        auto &name = field_layout->field->name;
+        if (slot > 0) {
+            json_put(writer, ',');
+        }
+        json_string(writer, (const uint8_t *)name.data(), name.size(), false);
+        json_put(writer, ':');
+
+        auto status = json_value(writer, field_layout, &record->values[slot]);
+        if (DecodeStatus::OK != status) {
+            return status;
+        }
+    }
+    json_put(writer, '}');
+
+    return DecodeStatus::OK;
+}
+
+DecodeStatus
+json_write_record(JsonWriter *writer, const DecodePlan *plan, const Value *record)
+{
+    auto start = writer->count;
+    auto flushed = writer->flushed;
+    if (JsonMode::DOCUMENT == writer->mode) {
+        json_put(writer, writer->record_count ? ",\n" : "[");
+    }
+
+    auto status = json_record(writer, plan, record);
+    if (DecodeStatus::OK != status) {
+        // A half written record would leave the document invalid.
+        if (writer->flushed == flushed) {
+            writer->count = start;
+        } else {
+            writer->has_failed = true;
+        }
+        return status;
+    }
+    if (JsonMode::LINES == writer->mode) {
+        json_put(writer, '\n');
+    }
+    writer->record_count += 1;
+
+    return writer->has_failed ? DecodeStatus::WRITE_FAILED : DecodeStatus::OK;
+}
+
+bool
+json_flush_file(void *user, const uint8_t *data, uint64_t size)
+{
+    return binarywriter::write_bytes(*(binarywriter::WriterFile *)user, data, size);
+}
+
+bool
+json_flush_console(void *user, const uint8_t *data, uint64_t size)
+{
+    platform::console_sink_write((platform::ConsoleSink *)user, std::string_view{(const char *)data, (size_t)size});
+    return true;
+}
+
+}  // namespace astraea
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/layout.hpp"
+#include "include/core/scope.hpp"
+#include "include/core/type_registry.hpp"
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+namespace astraea {
+
+enum class CountKind : uint32_t {
+    SCALAR,   // No brackets.
+    LITERAL,  // [4]
+    DYNAMIC   // [..] or [field_name]
+};
+
+static CountKind
+parse_count(std::string_view count, uint64_t *out_count)
+{
+    *out_count = 1;
+    if (count.empty()) {
+        return CountKind::SCALAR;
+    }
+
+    int base = 10;
+    if (count.size() > 2 && count[0] == '0' && (count[1] == 'x' || count[1] == 'X')) {
+        count.remove_prefix(2);
+        base = 16;
+    }
+
+    auto result = std::from_chars(count.data(), count.data() + count.size(), *out_count, base);
+    if (result.ec != std::errc{} || result.ptr != count.data() + count.size()) {
+        *out_count = 0;
+        return CountKind::DYNAMIC;
+    }
+
+    return CountKind::LITERAL;
+}
+
+static uint32_t
+natural_alignment(uint64_t element_bits)
+{
+    if (element_bits % 8 != 0 || !is_pow2(element_bits)) {
+        return 1;
+    }
+
+    return (uint32_t)std::min<uint64_t>(element_bits / 8, 8);
+}
+
+/*
+ * Strings hold code units of the encoding named by their `._encoding`, or
+ * by their string type, bytes as stored when there is none. Unknown
+ * encodings take no space, so the field is not decoded.
+ */
+static uint64_t
+layout_text_bits(FieldLayout *field_layout, std::string_view encoding_name)
+{
+    auto attribute = ast_vardef_find_attribute(field_layout->field, "_encoding");
+    if (attribute) {
+        encoding_name = attribute->value;
+    }
+
+    auto encoding = platform::TextEncoding::NONE;
+    if (!encoding_name.empty() && !platform::text_encoding_parse(encoding_name, &encoding)) {
+        return 0;
+    }
+
+    auto unit_size = platform::text_encoding_unit_size(encoding);
+    auto unit_type = 4 == unit_size ? AstTypeInfo::U32 : 2 == unit_size ? AstTypeInfo::U16 : AstTypeInfo::U8;
+    field_layout->encoding = encoding;
+    field_layout->builtin = type_registry_find(platform::TextEncoding::NONE == encoding ? AstTypeInfo::CHAR : unit_type);
+    field_layout->base_type = field_layout->builtin->base_type;
+    return unit_size * 8;
+}
+
+/*
+ * Resolves the size of one element of _field_, returns zero if it has no
+ * static size.
+ */
+static uint64_t
+layout_element_bits(AstTypeStruct *struct_def, FieldLayout *field_layout, uint32_t *out_alignment)
+{
+    auto var_def = field_layout->field;
+    auto builtin = type_registry_find(var_def->type);
+    if (builtin && builtin->bit_size) {
+        field_layout->builtin = builtin;
+        field_layout->base_type = builtin->base_type;
+        *out_alignment = natural_alignment(builtin->bit_size);
+        return builtin->bit_size;
+    }
+
+    auto type_def = scope_lookup_typedef(struct_def->scope, var_def->type);
+    field_layout->type = type_def;
+    if (!type_def) {
+        if ("string" == var_def->type) {
+            // `string << ._lenght = n` holds n code units.
+            return layout_text_bits(field_layout, {});
+        }
+        return 0;
+    }
+
+    switch (type_def->base_type) {
+    case AstTypeInfo::STRUCT:
+    {
+        auto sub_layout = layout_struct((AstTypeStruct *)type_def);
+        field_layout->base_type = AstTypeInfo::STRUCT;
+        if (LayoutState::DONE != sub_layout->state || !sub_layout->is_fixed) {
+            return 0;
+        }
+        *out_alignment = sub_layout->alignment;
+        return sub_layout->byte_size * 8;
+    }
+    case AstTypeInfo::STRING:
+    {
+        auto string_def = (AstTypeString *)type_def;
+        if (!string_def->count) {
+            return layout_text_bits(field_layout, string_def->encoding);  // sized by the field, like `string`.
+        }
+        field_layout->base_type = AstTypeInfo::STRING;
+        *out_alignment = 1;
+        return (uint64_t)string_def->count * 8;
+    }
+    default:
+    {
+        // Enums are stored as their base type.
+        builtin = ((AstTypeEnum *)type_def)->builtin;
+        field_layout->builtin = builtin ? builtin : type_registry_find(type_def->base_type);
+        field_layout->base_type = type_def->base_type;
+        if (!field_layout->builtin) {
+            return 0;
+        }
+        *out_alignment = natural_alignment(field_layout->builtin->bit_size);
+        return field_layout->builtin->bit_size;
+    }
+    }
+}
+
+StructLayout *
+layout_struct(AstTypeStruct *struct_def)
+{
+    if (struct_def->layout) {
+        return struct_def->layout;
+    }
+
+    auto layout = (StructLayout *)std::calloc(1, sizeof(StructLayout));
+    if (!layout) {
+        std::exit(1);
+    }
+    layout->state = LayoutState::IN_PROGRESS;
+    layout->alignment = 1;
+    layout->is_fixed = true;
+    struct_def->layout = layout;
+
+    auto block = (AstCompound *)struct_def->block;
+    uint32_t statement_count = block ? block->statement_count : 0;
+    if (statement_count > 0) {
+        layout->fields = (FieldLayout *)std::calloc(statement_count, sizeof(FieldLayout));
+        if (!layout->fields) {
+            std::exit(1);
+        }
+    }
+
+    uint64_t bit_offset = 0;
+    bool is_prefix = true;
+    for (uint32_t i = 0; i < statement_count; i += 1) {
+        auto statement = block->statements[i];
+        if (!statement || AstNodeType::VARIABLE_DEFINITION != statement->node_type) {
+            continue;  // nested type definitions take no space.
+        }
+
+        auto &field_layout = layout->fields[layout->field_count];
+        layout->field_count += 1;
+        field_layout.field = (AstVariable *)statement;
+
+        uint32_t alignment = 1;
+        field_layout.element_bits = layout_element_bits(struct_def, &field_layout, &alignment);
+        auto count_kind = parse_count(ast_vardef_count(field_layout.field), &field_layout.count);
+
+        uint64_t field_bits = 0;
+        field_layout.is_fixed = field_layout.element_bits > 0 && CountKind::DYNAMIC != count_kind &&
+                                checked_mul(field_layout.element_bits, field_layout.count, &field_bits);
+        layout->alignment = std::max(layout->alignment, alignment);
+
+        if (!is_prefix) {
+            continue;
+        }
+        field_layout.bit_offset = bit_offset;
+        if (!field_layout.is_fixed || !checked_add(bit_offset, field_bits, &bit_offset)) {
+            is_prefix = false;
+            layout->is_fixed = false;
+            continue;
+        }
+        layout->fixed_prefix += 1;
+    }
+
+    layout->bit_size = bit_offset;
+    layout->byte_size = (bit_offset + 7) / 8;
+    layout->state = LayoutState::DONE;
+
+    return layout;
+}
+
+FieldLayout *
+layout_find_field(StructLayout *layout, std::string_view field_name)
+{
+    for (uint32_t i = 0; i < layout->field_count; i += 1) {
+        if (layout->fields[i].field->name == field_name) {
+            return &layout->fields[i];
+        }
+    }
+
+    return nullptr;
+}
+
+bool
+layout_element_offset(const StructLayout *layout, uint64_t index, uint64_t *out_offset)
+{
+    if (!layout->is_fixed) {
+        return false;
+    }
+
+    return checked_mul(index, layout->byte_size, out_offset);
+}
+
+void
+LayoutPass::leave_type_definition(AstType *type_def)
+{
+    if (AstTypeInfo::STRUCT == type_def->base_type) {
+        layout_struct((AstTypeStruct *)type_def);
+    }
+}
+
+void
+layout_compute_all(AstNode *root)
+{
+    LayoutPass layout_pass;
+    layout_pass.walk(root);
+}
+
+}  // namespace astraea
@@ -9,6 +9,7 @@
 #include "include/utils/array.hpp"
 #include "include/utils/binaryreader.hpp"
 #include "include/utils/platform_console.hpp"
+#include <algorithm>
 #include <cstdio>
 
 #include "include/core/lexer.inl"
@@ -17,24 +18,27 @@ Lexer::Lexer(std::string_view source_path) :
     path(source_path),
     col(1),
     row(1),
-    pos(0),
-    contents("")
+    pos(0)
 {
     namespace br = binaryreader;
     auto source_file = br::open_file(source_path);
     auto source_file_size = br::file_size(source_file);
-    auto source_contents = br::read<char>(source_file, 0x0, source_file_size);
+    auto buffer = shared_buffer_create(source_file_size);
+    source = Slice{buffer, buffer->data, source_file_size};
+    shared_buffer_release(buffer);
+    auto is_read = br::read_bytes(source_file, buffer->data, source_file_size);
     br::close_file(source_file);
 
-    if (source_contents.count > 0) {
-        contents = std::string{source_contents.data, source_contents.count};
+    if (is_read && source.size > 0) {
+        contents = source.as_string();
         status = Status::OK;
     } else {
+        source = Slice{};
         status = Status::ERROR;
     }
     /*{
         platform::print(contents, 3);
-        std::printf("\n%I64u == %d\n", contents.length(), source_contents.count);
+        std::printf("\n%I64u == %d\n", contents.length(), source.size);
 
         auto len1 = platform::utf8_cp_size(std::string_view{contents.data(), 4});
         platform::print(std::string{contents.data(), len1}, 2);
@@ -87,7 +91,7 @@ Lexer::advance_cursor()
         } else if (ch != 13) {
             col += 1;
         }
-        pos += platform::utf8_cp_size(contents.data() + pos);
+        pos += std::max<uint32_t>(1, platform::utf8_cp_size(contents.substr(pos)));
     }
 }
 
@@ -105,15 +109,15 @@ Lexer::current_character()
 char
 Lexer::next_character()
 {
-    auto sz = platform::utf8_cp_size(contents.data() + pos);
+    auto sz = platform::utf8_cp_size(contents.substr(pos));
     return contents.at(pos + sz);
 }
 
 std::string
 Lexer::current_character_as_u8string()
 {
-    auto sz = platform::utf8_cp_size(contents.data() + pos);
-    auto str = std::string{contents.data() + pos, sz};
+    auto sz = platform::utf8_cp_size(contents.substr(pos));
+    auto str = std::string{contents.substr(pos, sz)};
 
     return str;
 }
@@ -145,14 +149,14 @@ Lexer::get_next_token()
             return Token(TokenType::ILLEGAL, "", path, row, col);
         }
     }
-    printf("LEXER: End of file.\n");
+    platform::print("LEXER: End of file.\n");
     return Token(TokenType::EOF_, "", path, row, col);
 }
 
 Token
 Lexer::collect_character()
 {
-    printf("LEXER: collect_character.\n");
+    platform::print("LEXER: collect_character.\n");
     uint32_t init_row = row;
     uint32_t init_col = col;
     advance_cursor();  // eat APOSTROPHE
@@ -191,7 +195,7 @@ Lexer::collect_identifier()
 Token
 Lexer::collect_keyword()
 {
-    printf("LEXER: Collect Keyword.\n");
+    platform::print("LEXER: Collect Keyword.\n");
     uint32_t init_row = row;
     uint32_t init_col = col;
 
@@ -213,7 +217,7 @@ Lexer::collect_number_binary()
     }
     if (is_character_number(ch)) {
         status = Status::ERROR;
-        printf("LEXER [ERROR]: %c is to big to base 2.\n", ch);
+        platform::print_error(std::string("LEXER [ERROR]: ") + ch + " is to big to base 2.\n");
         return Token(TokenType::ILLEGAL, literal, path, init_row, init_col);
     }
 
@@ -296,7 +300,7 @@ Lexer::collect_number()
         ch = current_character();
         if (!is_character_number(ch)) {
             status = Status::ERROR;
-            printf("LEXER [ERROR]: %c is not a valid value for a floating point number.\n", ch);
+            platform::print_error(std::string("LEXER [ERROR]: ") + ch + " is not a valid value for a floating point number.\n");
             return Token(TokenType::ILLEGAL, literal, path, init_row, init_col);
         }
         while (Status::OK == status && is_character_number(ch)) {
@@ -534,6 +538,14 @@ Lexer::collect_operator()
         }
         }
         advance_cursor();
+    } else if (current_character() == '.' && TokenType::DOT == token_type) {
+        token_type = TokenType::DOT_DOT;  // [ DOT_DOT ]
+        token_literal += current_character_as_u8string();
+        advance_cursor();
+    } else if (current_character() == '<' && TokenType::LESSER == token_type) {
+        token_type = TokenType::LESSER_LESSER;  // [ LESSER_LESSER ]
+        token_literal += current_character_as_u8string();
+        advance_cursor();
     }
 
     return Token(token_type, token_literal, path, init_row, init_col);
@@ -578,7 +590,7 @@ Lexer::skip_comment()
             is_comment = false;
         }
     } while (is_comment);
-    printf("LEXER: Skiped multi-line comment.\n");
+    platform::print("LEXER: Skiped multi-line comment.\n");
 }
 
 void
@@ -587,7 +599,7 @@ Lexer::skip_line_comment()
     while (current_character() != 10) {
         advance_cursor();
     }
-    printf("LEXER: Skiped line comment.\n");
+    platform::print("LEXER: Skiped line comment.\n");
 }
 
 inline void
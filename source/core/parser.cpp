@@ -7,6 +7,7 @@
  */
 #include "include/core/parser.hpp"
 #include "include/core/ast.hpp"
+#include "include/core/type_registry.hpp"
 #include "include/utils/platform_console.hpp"
 #include <algorithm>
 
@@ -172,11 +173,12 @@ Parser::parse_type_enum(std::string_view enum_name)
     auto ast_type_enum = ast_typedef_enum_init(enum_name);
 
     if (TokenType::LEFT_BRACE != current_token.type) {
-        auto enum_base_type = parse_type_info(current_token.literal);
+        auto builtin = type_registry_find(current_token.literal);
         // if (enum_base_type != AstTypeInfo::UNKNOWN) {
         eat(TokenType::IDENTIFIER);  // eat base_type
         // }
-        ast_type_enum->base_type = enum_base_type;
+        ast_type_enum->base_type = builtin ? builtin->base_type : AstTypeInfo::UNKNOWN;
+        ast_type_enum->builtin = builtin;
     }
 
     eat(TokenType::LEFT_BRACE);
@@ -195,7 +197,7 @@ Parser::parse_type_enum(std::string_view enum_name)
             // printf(", value := %s", enum_elem->value);
             eat(current_token.type);
         }
-        printf(" }\n");
+        platform::print(" }\n");
 
         /*
          * @TODO: type check enum element values
@@ -254,6 +256,9 @@ Parser::parse_type_struct(std::string_view struct_name)
     eat(TokenType::LEFT_BRACE);
     ast_type_struct->block = parse_statements();
     eat(TokenType::RIGHT_BRACE);
+    if (TokenType::LESSER_LESSER == current_token.type) {
+        parse_attributes(&ast_type_struct->attributes, &ast_type_struct->attribute_count);
+    }
 
     return (AstNode *)ast_type_struct;
 }
@@ -263,6 +268,9 @@ Parser::parse_const_definition()
 {
     auto const_name = previous_token.literal;
     eat(TokenType::COLON_COLON);
+    if (TokenType::IDENTIFIER != current_token.type) {
+        return parse_constant(const_name);
+    }
 
     auto const_type = current_token.literal;
     eat(TokenType::IDENTIFIER);
@@ -282,6 +290,42 @@ Parser::parse_const_definition()
     return nullptr;
 }
 
+AstNode *
+Parser::parse_constant(std::string_view constant_name)
+{
+    auto ast_constant = ast_constant_init(constant_name);
+    if (TokenType::LEFT_BRACE != current_token.type) {
+        ast_constant_add_value(ast_constant, parse_literal());
+        return (AstNode *)ast_constant;
+    }
+
+    eat(TokenType::LEFT_BRACE);
+    while (TokenType::RIGHT_BRACE != current_token.type) {
+        ast_constant_add_value(ast_constant, parse_literal());
+        if (TokenType::COMMA != current_token.type) {
+            break;
+        }
+        eat(TokenType::COMMA);
+    }
+    eat(TokenType::RIGHT_BRACE);
+
+    return (AstNode *)ast_constant;
+}
+
+AstNode *
+Parser::parse_literal()
+{
+    auto literal = current_token.literal;
+    if (TokenType::STRING == current_token.type) {
+        literal = "\"" + literal + "\"";
+    } else if (TokenType::HEX == current_token.type) {
+        literal = "0x" + literal;
+    }
+    eat(current_token.type);
+
+    return (AstNode *)ast_string_init(literal);
+}
+
 AstNode *
 Parser::parse_variable_definition()
 {
@@ -291,10 +335,23 @@ Parser::parse_variable_definition()
 
     if (TokenType::COLON == current_token.type) {
         eat(TokenType::COLON);
+        if (TokenType::LEFT_BRACKET == current_token.type) {
+            eat(TokenType::LEFT_BRACKET);
+            if (TokenType::HEX == current_token.type) {
+                var_def->count = "0x" + current_token.literal;
+            } else {
+                var_def->count = current_token.literal;
+            }
+            eat(current_token.type);  // [N], [..] or [field_name]
+            eat(TokenType::RIGHT_BRACKET);
+        }
         auto variable_type = current_token.literal;
         eat(TokenType::IDENTIFIER);
         var_def->type = variable_type;
         // std::printf("\twith type %s\n", var_def->type.c_str());
+        if (TokenType::LESSER_LESSER == current_token.type) {
+            parse_attributes(&var_def->attributes, &var_def->attribute_count);
+        }
         if (TokenType::SEMICOLON == current_token.type) {
             return (AstNode *)var_def;
         } else {
@@ -313,4 +370,36 @@ Parser::parse_variable_definition()
     return (AstNode *)var_def;
 }
 
+void
+Parser::parse_attributes(AstAttribute ***attributes, uint32_t *attribute_count)
+{
+    eat(TokenType::LESSER_LESSER);
+
+    while (true) {
+        eat(TokenType::DOT);
+        auto attribute_name = current_token.literal;
+        eat(TokenType::IDENTIFIER);
+        eat(TokenType::EQUAL);
+
+        auto attribute_value = std::string{};
+        if (TokenType::DOT == current_token.type) {
+            eat(TokenType::DOT);
+            attribute_value = "." + current_token.literal;  // ._lenght = .field
+            eat(TokenType::IDENTIFIER);
+        } else if (TokenType::HEX == current_token.type) {
+            attribute_value = "0x" + current_token.literal;
+            eat(TokenType::HEX);
+        } else {
+            attribute_value = current_token.literal;
+            eat(current_token.type);
+        }
+        ast_attribute_add(attributes, attribute_count, ast_attribute_init(attribute_name, attribute_value));
+
+        if (TokenType::COMMA != current_token.type) {
+            break;
+        }
+        eat(TokenType::COMMA);
+    }
+}
+
 }  // namespace astraea
\ No newline at end of file
@@ -6,7 +6,102 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #include "include/core/runtime.hpp"
+#include <cstdlib>
 
 namespace astraea {
 
-}
\ No newline at end of file
+Value *
+value_init_children(Value *value, ValueType type, uint64_t count)
+{
+    value->type = type;
+    value->count = count;
+    value->values = nullptr;
+    if (count > 0) {
+        value->values = (Value *)std::calloc((size_t)count, sizeof(Value));
+        if (!value->values) {
+            std::exit(1);
+        }
+    }
+
+    return value->values;
+}
+
+uint8_t *
+value_init_data(Value *value, ValueType type, uint64_t count, uint64_t byte_size)
+{
+    value->type = type;
+    value->count = count;
+    value->data = nullptr;
+    value->buffer = nullptr;
+    if (ValueType::BYTES == type) {
+        value->buffer = shared_buffer_create(byte_size);
+        value->data = value->buffer->data;
+    } else if (byte_size > 0) {
+        value->data = (uint8_t *)std::malloc((size_t)byte_size);
+        if (!value->data) {
+            std::exit(1);
+        }
+    }
+
+    return value->data;
+}
+
+void
+value_init_view(Value *value, const uint8_t *data, uint64_t size, SharedBuffer *buffer)
+{
+    value->type = ValueType::VIEW;
+    value->count = size;
+    value->view = data;
+    value->buffer = shared_buffer_retain(buffer);
+}
+
+Slice
+value_slice(const Value *value)
+{
+    switch (value->type) {
+    case ValueType::BYTES:
+        return Slice{value->buffer, value->data, value->count};
+    case ValueType::VIEW:
+        return Slice{value->buffer, value->view, value->count};
+    default:
+        return Slice{};
+    }
+}
+
+void
+value_init_lazy(Value *value, uint64_t offset, uint64_t count)
+{
+    value->type = ValueType::LAZY;
+    value->count = count;
+    value->u64 = offset;
+}
+
+void
+value_free(Value *value)
+{
+    switch (value->type) {
+    case ValueType::BYTES:
+    case ValueType::VIEW:
+        shared_buffer_release(value->buffer);
+        break;
+    case ValueType::ARRAY:
+        std::free(value->data);
+        break;
+    case ValueType::RECORD:
+    case ValueType::LIST:
+        for (uint64_t i = 0; i < value->count; i += 1) {
+            value_free(&value->values[i]);
+        }
+        std::free(value->values);
+        break;
+    default:
+        break;
+    }
+
+    value->type = ValueType::NONE;
+    value->count = 0;
+    value->u64 = 0;
+    value->buffer = nullptr;
+}
+
+}  // namespace astraea
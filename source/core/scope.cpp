@@ -14,10 +14,11 @@
 namespace astraea {
 
 Scope *
-scope_init()
+scope_init(Scope *parent)
 {
     auto scope = (Scope *)std::calloc(1, sizeof(Scope));
 
+    scope->parent = parent;
     scope->function_definitions = nullptr;
     scope->num_function_definitions = 0;
     scope->type_definitions = nullptr;
@@ -88,6 +89,19 @@ scope_get_typedef(Scope *scope, std::string_view type_name)
     return nullptr;
 }
 
+AstType *
+scope_lookup_typedef(Scope *scope, std::string_view type_name)
+{
+    for (; scope != nullptr; scope = scope->parent) {
+        auto type_def = scope_get_typedef(scope, type_name);
+        if (type_def) {
+            return type_def;
+        }
+    }
+
+    return nullptr;
+}
+
 AstVariable *
 scope_add_variable_definition(Scope *scope, AstVariable *var_def)
 {
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/core/type_registry.hpp"
+#include <cmath>
+#include <cstring>
+
+namespace astraea {
+
+/*
+ * Loads _bit_size_ bits starting _bit_offset_ bits into _src_, least
+ * significant bit first.
+ */
+static uint64_t
+load_bits(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size)
+{
+    auto byte = bit_offset / 8;
+    auto shift = bit_offset % 8;
+
+    auto raw = load_unsigned(src + byte, 8, Endian::little) >> shift;
+    if (shift + bit_size > 64) {
+        raw |= (uint64_t)src[byte + 8] << (64 - shift);
+    }
+
+    return bit_size < 64 ? raw & ((uint64_t{1} << bit_size) - 1) : raw;
+}
+
+static void
+set_unsigned(Value *out, AstTypeInfo base_type, uint64_t raw)
+{
+    out->type = ValueType::UNSIGNED;
+    out->base_type = base_type;
+    out->count = 1;
+    out->u64 = raw;
+}
+
+static void
+set_signed(Value *out, AstTypeInfo base_type, uint64_t raw, uint32_t bit_size)
+{
+    auto shift = 64 - bit_size;
+    out->type = ValueType::SIGNED;
+    out->base_type = base_type;
+    out->count = 1;
+    out->s64 = (int64_t)(raw << shift) >> shift;
+}
+
+static void
+set_float(Value *out, AstTypeInfo base_type, double value)
+{
+    out->type = ValueType::FLOAT;
+    out->base_type = base_type;
+    out->count = 1;
+    out->f64 = value;
+}
+
+void
+decode_builtin_unsigned(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian, Value *out)
+{
+    set_unsigned(out, AstTypeInfo::UNSIGNED, load_bits(src, bit_offset, bit_size));
+}
+
+void
+decode_builtin_signed(const uint8_t *src, uint32_t bit_offset, uint32_t bit_size, Endian, Value *out)
+{
+    set_signed(out, AstTypeInfo::SIGNED, load_bits(src, bit_offset, bit_size), bit_size);
+}
+
+void
+decode_builtin_u8(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian, Value *out)
+{
+    set_unsigned(out, AstTypeInfo::U8, src[bit_offset / 8]);
+}
+
+void
+decode_builtin_u16(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    set_unsigned(out, AstTypeInfo::U16, load_unsigned(src + bit_offset / 8, 2, endian));
+}
+
+void
+decode_builtin_u32(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    set_unsigned(out, AstTypeInfo::U32, load_unsigned(src + bit_offset / 8, 4, endian));
+}
+
+void
+decode_builtin_u64(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    set_unsigned(out, AstTypeInfo::U64, load_unsigned(src + bit_offset / 8, 8, endian));
+}
+
+void
+decode_builtin_s8(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian, Value *out)
+{
+    set_signed(out, AstTypeInfo::S8, src[bit_offset / 8], 8);
+}
+
+void
+decode_builtin_s16(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    set_signed(out, AstTypeInfo::S16, load_unsigned(src + bit_offset / 8, 2, endian), 16);
+}
+
+void
+decode_builtin_s32(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    set_signed(out, AstTypeInfo::S32, load_unsigned(src + bit_offset / 8, 4, endian), 32);
+}
+
+void
+decode_builtin_s64(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    set_signed(out, AstTypeInfo::S64, load_unsigned(src + bit_offset / 8, 8, endian), 64);
+}
+
+void
+decode_builtin_f16(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    auto half = (uint32_t)load_unsigned(src + bit_offset / 8, 2, endian);
+    auto sign = (half >> 15) ? -1.0 : 1.0;
+    auto exponent = (int32_t)((half >> 10) & 0x1F);
+    auto mantissa = (double)(half & 0x3FF);
+
+    double value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);  // subnormal
+    } else if (exponent == 0x1F) {
+        value = mantissa == 0 ? HUGE_VAL : NAN;
+    } else {
+        value = std::ldexp(mantissa + 1024.0, exponent - 25);
+    }
+    set_float(out, AstTypeInfo::F16, sign * value);
+}
+
+void
+decode_builtin_f32(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    auto bits = (uint32_t)load_unsigned(src + bit_offset / 8, 4, endian);
+    float single;
+    std::memcpy(&single, &bits, sizeof(single));
+    set_float(out, AstTypeInfo::F32, single);
+}
+
+void
+decode_builtin_f64(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian endian, Value *out)
+{
+    auto bits = load_unsigned(src + bit_offset / 8, 8, endian);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    set_float(out, AstTypeInfo::F64, value);
+}
+
+void
+decode_builtin_char(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian, Value *out)
+{
+    set_unsigned(out, AstTypeInfo::CHAR, src[bit_offset / 8]);
+}
+
+void
+decode_builtin_bool(const uint8_t *src, uint32_t bit_offset, uint32_t, Endian, Value *out)
+{
+    out->type = ValueType::BOOL;
+    out->base_type = AstTypeInfo::BOOL;
+    out->count = 1;
+    out->u64 = src[bit_offset / 8] != 0;
+}
+
+const BuiltinType *
+type_registry_find(AstTypeInfo base_type)
+{
+    switch (base_type) {
+    case AstTypeInfo::UNSIGNED: return type_registry_find("uint");
+    case AstTypeInfo::SIGNED: return type_registry_find("int");
+    case AstTypeInfo::FLOAT: return type_registry_find("float");
+    case AstTypeInfo::U8: return type_registry_find("u8");
+    case AstTypeInfo::U16: return type_registry_find("u16");
+    case AstTypeInfo::U32: return type_registry_find("u32");
+    case AstTypeInfo::U64: return type_registry_find("u64");
+    case AstTypeInfo::S8: return type_registry_find("s8");
+    case AstTypeInfo::S16: return type_registry_find("s16");
+    case AstTypeInfo::S32: return type_registry_find("s32");
+    case AstTypeInfo::S64: return type_registry_find("s64");
+    case AstTypeInfo::F16: return type_registry_find("f16");
+    case AstTypeInfo::F32: return type_registry_find("f32");
+    case AstTypeInfo::F64: return type_registry_find("f64");
+    case AstTypeInfo::CHAR: return type_registry_find("char");
+    case AstTypeInfo::BOOL: return type_registry_find("bool");
+    default: return nullptr;
+    }
+}
+
+ValueType
+value_type_of(AstTypeInfo base_type)
+{
+    switch (base_type) {
+    case AstTypeInfo::SIGNED:
+    case AstTypeInfo::S8:
+    case AstTypeInfo::S16:
+    case AstTypeInfo::S32:
+    case AstTypeInfo::S64:
+        return ValueType::SIGNED;
+    case AstTypeInfo::FLOAT:
+    case AstTypeInfo::F16:
+    case AstTypeInfo::F32:
+    case AstTypeInfo::F64:
+        return ValueType::FLOAT;
+    case AstTypeInfo::BOOL:
+        return ValueType::BOOL;
+    case AstTypeInfo::UNSIGNED:
+    case AstTypeInfo::U8:
+    case AstTypeInfo::U16:
+    case AstTypeInfo::U32:
+    case AstTypeInfo::U64:
+    case AstTypeInfo::CHAR:
+        return ValueType::UNSIGNED;
+    default:
+        return ValueType::NONE;
+    }
+}
+
+}  // namespace astraea
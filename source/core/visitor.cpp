@@ -8,92 +8,72 @@
 #include "include/core/visitor.hpp"
 #include "include/core/scope.hpp"
 #include "include/utils/types.hpp"
-#include <cstdio>
-
 
 namespace astraea {
 
 AstNode *
 visitor_visit(Visitor *visitor, AstNode *node)
 {
-    if (!node) return ast_noop_init();
-
-    switch (node->node_type) {
-    case AstNodeType::COMPOUND:
-        return visitor_visit_compound(visitor, node);
-        break;
-    case AstNodeType::FUNCTION_DEFINITION:
-        return visitor_visit_function_definition(visitor, node);
-        break;
-    case AstNodeType::TYPE_DEFINITION:
-        return visitor_visit_type_definition(visitor, node);
-        break;
-    case AstNodeType::VARIABLE_DEFINITION:
-        return visitor_visit_variable_definition(visitor, node);
-        break;
-    case AstNodeType::NO_OPERATION:
-        return node;
-        break;
-    }
+    visitor->walk(node);
 
-    std::printf("VISITOR: Uncaught statement of type `%d`\n", node->node_type);
-    exit(1);
+    return node;
 }
 
-AstNode *
-visitor_visit_compound(Visitor *visitor, AstNode *node)
+WalkAction
+Visitor::enter_compound(AstCompound *compound)
 {
-    auto compound = (AstCompound *)node;
-    std::printf("VISITOR [Compound] Statement Count %u\n", compound->statement_count);
-
     if (compound->scope == nullptr) {
-        compound->scope = scope_init();
+        compound->scope = scope_init(current_scope);
     }
+    current_scope = compound->scope;
 
-    for (uint32_t i = 0; i < compound->statement_count; i += 1) {
-        auto &statement = compound->statements[i];
-        std::printf(
-            "VISITOR [Compound: Statement %d] %s\n", i, ast_node_type_as_string(statement->node_type).c_str());
-
-        visitor->current_scope = compound->scope;
-        visitor_visit(visitor, statement);
-    }
-
-    return ast_noop_init();
+    return WalkAction::CONTINUE;
 }
 
-AstNode *
-visitor_visit_function_definition(Visitor *visitor, AstNode *node)
+void
+Visitor::leave_compound(AstCompound *compound)
 {
-    std::printf("VISITOR [Function Definition]\n");
+    current_scope = compound->scope->parent;
+}
 
-    auto func_def = (AstFunction *)node;
-    scope_add_function_definition(visitor->current_scope, func_def);
+WalkAction
+Visitor::visit_function_definition(AstFunction *func_def)
+{
+    scope_add_function_definition(current_scope, func_def);
 
-    return node;
+    return WalkAction::CONTINUE;
 }
 
-AstNode *
-visitor_visit_type_definition(Visitor *visitor, AstNode *node)
+WalkAction
+Visitor::visit_type_definition(AstType *type_def)
 {
-    auto type_def = (AstType *)node;
-    scope_add_typedef(visitor->current_scope, type_def);
+    scope_add_typedef(current_scope, type_def);
 
+    // Only structs own a block, its compound opens the struct scope.
     if (AstTypeInfo::STRUCT == type_def->base_type) {
-        auto struct_def = (AstTypeStruct *)node;
-        visitor_visit(visitor, struct_def->block);  // COMPOUND BLOCK
+        return WalkAction::CONTINUE;
     }
 
-    return node;
+    return WalkAction::SKIP_CHILDREN;
 }
 
-AstNode *
-visitor_visit_variable_definition(Visitor *visitor, AstNode *node)
+void
+Visitor::leave_type_definition(AstType *type_def)
 {
-    auto var_def = (AstVariable *)node;
-    scope_add_variable_definition(visitor->current_scope, var_def);
+    if (AstTypeInfo::STRUCT == type_def->base_type) {
+        auto struct_def = (AstTypeStruct *)type_def;
+        if (struct_def->block) {
+            struct_def->scope = ((AstCompound *)struct_def->block)->scope;
+        }
+    }
+}
 
-    return node;
+WalkAction
+Visitor::visit_variable_definition(AstVariable *var_def)
+{
+    scope_add_variable_definition(current_scope, var_def);
+
+    return WalkAction::SKIP_CHILDREN;
 }
 
-}  // namespace astraea
\ No newline at end of file
+}  // namespace astraea
@@ -0,0 +1,440 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/checksum.hpp"
+#include "include/utils/cpu.hpp"
+#include "include/utils/platform_console.hpp"
+#include "include/utils/signaturescan.hpp"
+#include "include/utils/streamreader.hpp"
+#include "include/utils/transcode.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef ASTRAEA_USE_ZLIB
+#include <zlib.h>
+#endif
+
+/*
+ * Checks every SIMD path picked by CPU dispatch against a scalar reference.
+ *
+ * The checks run once per tier, each tier hides the wider instruction sets
+ * with cpu_limit_features, so a machine with AVX2 also checks the SSE and
+ * scalar fallbacks. Checksums are compared with bitwise implementations
+ * (and zlib when available), the text kernels with their own scalar path.
+ * Checks that don't depend on the CPU run once, after the tiers.
+ */
+
+using namespace binaryreader;
+using namespace platform;
+
+struct CheckTier {
+    const char *name;
+    uint32_t mask;
+};
+
+static const CheckTier check_tiers[] = {
+    {"native", 0xFFFFFFFFu},
+    {"without avx2", ~(uint32_t)CPU_AVX2},
+    {"ssse3", CPU_SSE2 | CPU_SSSE3},
+    {"sse2", CPU_SSE2},
+    {"scalar", 0},
+};
+
+static const CheckTier *current_tier;
+static uint64_t check_count;
+static uint64_t failure_count;
+
+static void
+check(bool is_ok, const std::string &what)
+{
+    check_count += 1;
+    if (!is_ok) {
+        failure_count += 1;
+        print_error(std::string("FAILED [") + current_tier->name + "] " + what + "\n");
+    }
+}
+
+/*
+ * xorshift64*, fixed seed so failures reproduce.
+ */
+static uint64_t random_state = 0x9E3779B97F4A7C15;
+
+static uint64_t
+random_next()
+{
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return random_state * 0x2545F4914F6CDD1D;
+}
+
+static uint32_t
+random_below(uint32_t bound)
+{
+    return (uint32_t)(random_next() % bound);
+}
+
+static std::vector<uint8_t>
+random_bytes(uint64_t size, uint32_t alphabet = 256)
+{
+    auto bytes = std::vector<uint8_t>(size);
+    for (auto &byte : bytes) {
+        byte = (uint8_t)random_below(alphabet);
+    }
+    return bytes;
+}
+
+/*
+ * Code point of a random text: long ASCII runs so the vector loops start,
+ * mixed with 2, 3 and 4 byte code points.
+ */
+static uint32_t
+random_code_point()
+{
+    switch (random_below(8)) {
+    case 0:
+        return 0x80 + random_below(0x780);
+    case 1:
+        return 0x800 + random_below(0xD000 - 0x800);
+    case 2:
+        return 0x10000 + random_below(0x100000);
+    default:
+        return 0x20 + random_below(0x5F);
+    }
+}
+
+static void
+put_utf8(std::vector<uint8_t> &out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        out.push_back((uint8_t)cp);
+    } else if (cp < 0x800) {
+        out.push_back((uint8_t)(0xC0 | cp >> 6));
+        out.push_back((uint8_t)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((uint8_t)(0xE0 | cp >> 12));
+        out.push_back((uint8_t)(0x80 | (cp >> 6 & 0x3F)));
+        out.push_back((uint8_t)(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((uint8_t)(0xF0 | cp >> 18));
+        out.push_back((uint8_t)(0x80 | (cp >> 12 & 0x3F)));
+        out.push_back((uint8_t)(0x80 | (cp >> 6 & 0x3F)));
+        out.push_back((uint8_t)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static void
+put_unit(std::vector<uint8_t> &out, uint32_t unit, uint32_t unit_size, bool is_big)
+{
+    for (uint32_t i = 0; i < unit_size; i += 1) {
+        auto shift = 8 * (is_big ? unit_size - 1 - i : i);
+        out.push_back((uint8_t)(unit >> shift));
+    }
+}
+
+/*
+ * Random text of _count_ code points in _encoding_, with an invalid code
+ * unit now and then when _has_errors_.
+ */
+static std::vector<uint8_t>
+random_text(TextEncoding encoding, uint32_t count, bool has_errors)
+{
+    auto out = std::vector<uint8_t>{};
+    auto unit_size = text_encoding_unit_size(encoding);
+    auto is_big = TextEncoding::UTF16BE == encoding || TextEncoding::UTF32BE == encoding;
+    for (uint32_t i = 0; i < count; i += 1) {
+        auto is_error = has_errors && random_below(64) == 0;
+        auto cp = random_code_point();
+        switch (encoding) {
+        case TextEncoding::ASCII:
+            out.push_back(is_error ? (uint8_t)(0x80 + random_below(0x80)) : (uint8_t)(cp & 0x7F));
+            break;
+        case TextEncoding::LATIN1:
+            out.push_back((uint8_t)random_below(256));
+            break;
+        case TextEncoding::UTF8:
+            put_utf8(out, cp);
+            if (is_error) {
+                out[random_below((uint32_t)out.size())] = (uint8_t)random_below(256);
+            }
+            break;
+        case TextEncoding::UTF16LE:
+        case TextEncoding::UTF16BE:
+            if (is_error) {
+                put_unit(out, 0xD800 + random_below(0x800), 2, is_big);  // lone surrogate.
+            } else if (cp >= 0x10000) {
+                put_unit(out, 0xD800 + ((cp - 0x10000) >> 10), 2, is_big);
+                put_unit(out, 0xDC00 + ((cp - 0x10000) & 0x3FF), 2, is_big);
+            } else {
+                put_unit(out, cp, 2, is_big);
+            }
+            break;
+        case TextEncoding::UTF32LE:
+        case TextEncoding::UTF32BE:
+            put_unit(out, is_error ? 0x110000 + random_below(0x1000) : cp, 4, is_big);
+            break;
+        default:
+            break;
+        }
+    }
+    if (has_errors && unit_size > 1 && random_below(4) == 0) {
+        out.push_back(0x41);  // cut code unit.
+    }
+    return out;
+}
+
+static uint32_t
+crc_bitwise(uint32_t polynomial, uint32_t crc, const uint8_t *data, uint64_t size)
+{
+    crc = ~crc;
+    for (uint64_t i = 0; i < size; i += 1) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit += 1) {
+            crc = (crc >> 1) ^ (polynomial & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t
+adler32_bytewise(uint32_t adler, const uint8_t *data, uint64_t size)
+{
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+    for (uint64_t i = 0; i < size; i += 1) {
+        s1 = (s1 + data[i]) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    return s2 << 16 | s1;
+}
+
+static void
+check_checksums()
+{
+    static const uint64_t sizes[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 255, 256, 1000, 4096, 5552, 20000};
+    auto buffer = random_bytes(20000 + 16);
+    for (auto size : sizes) {
+        for (uint64_t misalign = 0; misalign < 4; misalign += 1) {
+            auto data = buffer.data() + misalign;
+            auto where = std::to_string(size) + " bytes at +" + std::to_string(misalign);
+
+            auto crc32 = crc32_update(0, data, size);
+            auto crc32c = crc32c_update(0, data, size);
+            auto adler32 = adler32_update(1, data, size);
+            check(crc32 == crc_bitwise(0xEDB88320, 0, data, size), "crc32 of " + where);
+            check(crc32c == crc_bitwise(0x82F63B78, 0, data, size), "crc32c of " + where);
+            check(adler32 == adler32_bytewise(1, data, size), "adler32 of " + where);
+#ifdef ASTRAEA_USE_ZLIB
+            check(crc32 == (uint32_t)::crc32(0, data, (uInt)size), "crc32 of " + where + " against zlib");
+            check(adler32 == (uint32_t)::adler32(1, data, (uInt)size), "adler32 of " + where + " against zlib");
+#endif
+
+            // Fed in two pieces, the second one misaligned.
+            auto split = size / 3;
+            check(crc32_update(crc32_update(0, data, split), data + split, size - split) == crc32, "split crc32 of " + where);
+            check(crc32c_update(crc32c_update(0, data, split), data + split, size - split) == crc32c, "split crc32c of " + where);
+            check(adler32_update(adler32_update(1, data, split), data + split, size - split) == adler32, "split adler32 of " + where);
+        }
+    }
+}
+
+/*
+ * Runs _function_ with the features of the current tier, then with none.
+ */
+template <typename Function>
+static void
+run_both(Function function)
+{
+    function(false);
+    cpu_limit_features(0);
+    function(true);
+    cpu_limit_features(current_tier->mask);
+}
+
+static void
+check_transcode()
+{
+    static const TextEncoding encodings[] = {
+        TextEncoding::ASCII,   TextEncoding::LATIN1,  TextEncoding::UTF8,    TextEncoding::UTF16LE,
+        TextEncoding::UTF16BE, TextEncoding::UTF32LE, TextEncoding::UTF32BE,
+    };
+    for (auto encoding : encodings) {
+        for (uint32_t n = 0; n < 200; n += 1) {
+            auto text = random_text(encoding, random_below(300), n % 2 == 1);
+            auto capacity = utf8_capacity(encoding, text.size());
+            auto dispatched = std::vector<uint8_t>(capacity + 1);
+            auto scalar = std::vector<uint8_t>(capacity + 1);
+            bool is_valid[2] = {};
+            uint64_t written[2] = {};
+            run_both([&](bool is_scalar) {
+                auto &out = is_scalar ? scalar : dispatched;
+                is_valid[is_scalar] = transcode_to_utf8(encoding, text.data(), text.size(), out.data(), &written[is_scalar]);
+            });
+
+            auto where = std::string("transcode of ") + std::to_string(text.size()) + " bytes, encoding " +
+                         std::to_string((uint32_t)encoding) + ", case " + std::to_string(n);
+            check(is_valid[0] == is_valid[1] && written[0] == written[1] &&
+                      0 == std::memcmp(dispatched.data(), scalar.data(), (size_t)written[0]),
+                  where);
+
+            if (TextEncoding::UTF8 == encoding) {
+                bool is_utf8[2] = {};
+                run_both([&](bool is_scalar) { is_utf8[is_scalar] = utf8_validate(text.data(), text.size()); });
+                check(is_utf8[0] == is_utf8[1], "utf8_validate, case " + std::to_string(n));
+            }
+        }
+    }
+}
+
+static void
+check_counters()
+{
+    for (uint32_t n = 0; n < 200; n += 1) {
+        auto bytes = n % 2 ? random_text(TextEncoding::UTF8, random_below(400), false) : random_bytes(random_below(400));
+        auto text = std::string_view{(const char *)bytes.data(), bytes.size()};
+        auto offsets = std::vector<uint64_t>{};
+        for (uint64_t i = 0; i < bytes.size(); i += 1) {
+            if ((bytes[i] & 0xC0) != 0x80) {
+                offsets.push_back(i);
+            }
+        }
+        auto where = std::to_string(bytes.size()) + " bytes, case " + std::to_string(n);
+        check(utf8_string_lenght(text) == offsets.size(), "utf8_string_lenght of " + where);
+
+        auto index = Utf8Index{};
+        utf8_index_build(&index, text);
+        auto is_same = index.lenght == offsets.size();
+        for (uint64_t cp = 0; is_same && cp <= offsets.size(); cp += 1) {
+            auto offset = cp < offsets.size() ? offsets[cp] : bytes.size();
+            is_same = utf8_index_offset(index, cp) == offset;
+        }
+        check(is_same, "utf8_index of " + where);
+    }
+}
+
+static bool
+scan_bytewise(const std::vector<std::vector<uint8_t>> &arms, const std::vector<uint8_t> &data, uint64_t from,
+              SignatureMatch *out_match)
+{
+    for (auto i = from; i < data.size(); i += 1) {
+        for (uint32_t arm = 0; arm < arms.size(); arm += 1) {
+            auto &signature = arms[arm];
+            if (i + signature.size() <= data.size() && 0 == std::memcmp(&data[i], signature.data(), signature.size())) {
+                *out_match = SignatureMatch{i, arm};
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void
+check_signature_scan()
+{
+    for (uint32_t n = 0; n < 100; n += 1) {
+        // Few distinct bytes, so prefixes show up often and most candidates fail.
+        auto data = random_bytes(64 + random_below(1024), 4);
+        auto set = SignatureSet{};
+        signature_set_init(&set);
+        auto arms = std::vector<std::vector<uint8_t>>{};
+        auto arm_count = 1 + random_below(6);
+        for (uint32_t arm = 0; arm < arm_count; arm += 1) {
+            auto size = SIGNATURE_MIN_SIZE + random_below(SIGNATURE_MAX_SIZE - SIGNATURE_MIN_SIZE + 1);
+            auto start = random_below((uint32_t)(data.size() - size));
+            arms.emplace_back(data.begin() + start, data.begin() + start + size);
+            signature_set_add(&set, arms.back().data(), size);
+        }
+
+        auto is_same = true;
+        uint64_t from = 0;
+        while (is_same) {
+            auto match = SignatureMatch{};
+            auto expected = SignatureMatch{};
+            auto is_found = scan_signatures(&set, data.data(), data.size(), from, &match);
+            auto is_expected = scan_bytewise(arms, data, from, &expected);
+            is_same = is_found == is_expected &&
+                      (!is_found || (match.offset == expected.offset && match.arm == expected.arm));
+            if (!is_found) {
+                break;
+            }
+            from = match.offset + 1;
+        }
+        check(is_same, "scan_signatures of " + std::to_string(data.size()) + " bytes, case " + std::to_string(n));
+    }
+}
+
+struct StreamSource {
+    const std::vector<uint8_t> *data;
+    uint64_t pos;
+};
+
+/*
+ * Hands out as many bytes as asked for, like a pipe with a full buffer.
+ */
+static int64_t
+stream_source_pull(void *user, void *buffer, uint64_t size)
+{
+    auto source = (StreamSource *)user;
+    auto count = std::min<uint64_t>(size, source->data->size() - source->pos);
+    std::memcpy(buffer, source->data->data() + source->pos, (size_t)count);
+    source->pos += count;
+    return (int64_t)count;
+}
+
+static void
+check_stream_window()
+{
+    auto data = random_bytes(3 * 4096);
+    for (uint64_t start = 4096 - 8; start <= 4096; start += 1) {
+        auto source = StreamSource{&data, 0};
+        auto file = StreamFile{};
+        open_stream(&file, stream_source_pull, &source, 4096);
+        skip(file, start);
+
+        // The peek crosses the end of the window, the read after it needs
+        // the same bytes still there.
+        uint8_t peeked[8] = {};
+        uint8_t read[8] = {};
+        auto is_peeked = peek_bytes(file, peeked, sizeof(peeked));
+        auto is_read = read_bytes(file, read, sizeof(read));
+        auto where = "at " + std::to_string(start);
+        check(is_peeked && 0 == std::memcmp(peeked, &data[start], sizeof(peeked)), "stream peek " + where);
+        check(is_read && 0 == std::memcmp(read, &data[start], sizeof(read)),
+              "stream read after peek " + where + ": " + stream_error_message(file));
+
+        // Reads bigger than the window still stream through it.
+        auto rest = std::vector<uint8_t>(data.size() - start - sizeof(read));
+        is_read = read_bytes(file, rest.data(), rest.size());
+        check(is_read && 0 == std::memcmp(rest.data(), &data[start + sizeof(read)], rest.size()),
+              "stream read past the window " + where);
+        close_stream(&file);
+    }
+}
+
+int
+main()
+{
+    for (auto &tier : check_tiers) {
+        current_tier = &tier;
+        cpu_limit_features(tier.mask);
+        auto failures_before = failure_count;
+        check_checksums();
+        check_transcode();
+        check_counters();
+        check_signature_scan();
+        print(std::string(tier.name) + ": " + std::to_string(failure_count - failures_before) + " failed\n");
+    }
+    cpu_limit_features(0xFFFFFFFFu);
+    current_tier = &check_tiers[0];
+    check_stream_window();
+
+    print(std::to_string(check_count) + " checks, " + std::to_string(failure_count) + " failed\n",
+          failure_count ? 12 : 10);
+    return failure_count ? 1 : 0;
+}
@@ -6,6 +6,7 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #include "include/core/ast.hpp"
+#include "include/core/layout.hpp"
 #include "include/core/lexer.hpp"
 #include "include/core/parser.hpp"
 #include "include/core/visitor.hpp"
@@ -23,13 +24,13 @@ void test_tokenizer(Lexer &lexer);
 int
 main(int argc, char **argv)
 {
-    printf("Running!\n");
+    platform::print("Running!\n");
 #ifdef OS_POSIX
     {
         char cwd[1024];
         chdir("/path/to/change/directory/to");
         getcwd(cwd, sizeof(cwd));
-        printf("Current working dir: %s\n", cwd);
+        platform::print(std::string("Current working dir: ") + cwd + "\n");
     }
     auto source_path = std::string_view{"./resources/teste1.ast"};
 #else
@@ -41,7 +42,7 @@ main(int argc, char **argv)
     platform::print(std::string("Script: ") + std::string(source_path) + "\n");
 
     auto lexer = Lexer{source_path};
-    platform::print(lexer.contents + "\n");
+    platform::print(std::string{lexer.contents} + "\n");
     test_tokenizer(lexer);
 
     auto parser = Parser{lexer};
@@ -49,6 +50,7 @@ main(int argc, char **argv)
 
     Visitor visitor;
     visitor_visit(&visitor, root);
+    layout_compute_all(root);
 
     return 0;
 }
@@ -0,0 +1,557 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/asyncreader.hpp"
+#include "include/utils/threadpool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+
+#ifdef OS_POSIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#elif defined OS_WINDOWS
+#include <windows.h>
+#endif
+
+#ifdef OS_LINUX
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAS_IO_URING
+#endif
+#endif
+
+namespace binaryreader {
+
+enum class BlockState : uint32_t {
+    EMPTY,
+    PENDING,  // read in flight.
+    READY,
+    FAILED
+};
+
+struct AsyncBlock {
+    uint64_t offset;
+    uint32_t size;
+    std::atomic<BlockState> state;
+    uint64_t last_use;
+    uint8_t *data;
+    AsyncState *owner;
+#ifdef OS_POSIX
+    iovec iov;
+#endif
+};
+
+#ifdef HAS_IO_URING
+struct IoUring {
+    int fd;
+    uint32_t entries;
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_mask;
+    uint32_t *sq_array;
+    io_uring_sqe *sqes;
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t *cq_mask;
+    io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+#endif
+
+struct AsyncState {
+    intptr_t handle;  // file descriptor, HANDLE on Windows.
+    uint64_t size;
+    uint8_t *memory;  // ASYNC_READER_SLOTS blocks.
+    AsyncBlock blocks[ASYNC_READER_SLOTS];
+    uint64_t clock;
+    uint64_t last_block;  // offset of the block read last, detects sequential scans.
+    uint32_t readahead;
+    uint32_t pending;  // io_uring reads in flight.
+
+    // Thread pool backend, workers publish finished blocks under the mutex.
+    platform::ThreadPool *pool;
+    std::mutex mutex;
+    std::condition_variable block_done;
+
+#ifdef HAS_IO_URING
+    IoUring ring;
+#endif
+};
+
+/*
+ * Blocking positional read, used by the workers and to finish short reads.
+ */
+static bool
+async_read_at(AsyncState *state, uint64_t offset, uint8_t *out, uint64_t size)
+{
+    while (size > 0) {
+#ifdef OS_POSIX
+        auto count = pread((int)state->handle, out, (size_t)size, (off_t)offset);
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+#elif defined OS_WINDOWS
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD count = 0;
+        auto chunk = (DWORD)std::min<uint64_t>(size, 0x40000000);
+        if (!ReadFile((HANDLE)state->handle, out, chunk, &count, &overlapped) || count == 0) {
+            return false;
+        }
+#endif
+        out += count;
+        offset += (uint64_t)count;
+        size -= (uint64_t)count;
+    }
+
+    return true;
+}
+
+#ifdef HAS_IO_URING
+static bool
+uring_init(IoUring *ring, uint32_t entries)
+{
+    io_uring_params params = {};
+    auto fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return false;  // old kernel or forbidden by a seccomp profile.
+    }
+
+    ring->fd = fd;
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    auto is_single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (is_single_mmap) {
+        ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+    }
+
+    ring->sq_ring =
+        mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = is_single_mmap ? ring->sq_ring
+                                   : mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = (io_uring_sqe *)mmap(
+        nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ring->sq_ring || MAP_FAILED == ring->cq_ring || MAP_FAILED == (void *)ring->sqes) {
+        if (MAP_FAILED != (void *)ring->sqes) {
+            munmap(ring->sqes, ring->sqes_size);
+        }
+        if (MAP_FAILED != ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (MAP_FAILED != ring->sq_ring) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        close(fd);
+        return false;
+    }
+
+    auto sq = (uint8_t *)ring->sq_ring;
+    ring->sq_head = (uint32_t *)(sq + params.sq_off.head);
+    ring->sq_tail = (uint32_t *)(sq + params.sq_off.tail);
+    ring->sq_mask = (uint32_t *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (uint32_t *)(sq + params.sq_off.array);
+    auto cq = (uint8_t *)ring->cq_ring;
+    ring->cq_head = (uint32_t *)(cq + params.cq_off.head);
+    ring->cq_tail = (uint32_t *)(cq + params.cq_off.tail);
+    ring->cq_mask = (uint32_t *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+static void
+uring_free(IoUring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+static void uring_reap(AsyncState *state, bool wait);
+
+static void
+uring_submit_read(AsyncState *state, uint32_t slot)
+{
+    auto ring = &state->ring;
+    auto block = &state->blocks[slot];
+    block->iov.iov_base = block->data;
+    block->iov.iov_len = block->size;
+
+    // One sqe per block, the ring has an entry for every slot.
+    auto tail = *ring->sq_tail;
+    auto index = tail & *ring->sq_mask;
+    auto sqe = &ring->sqes[index];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = (int)state->handle;
+    sqe->addr = (uint64_t)(uintptr_t)&block->iov;
+    sqe->len = 1;
+    sqe->off = block->offset;
+    sqe->user_data = slot;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    state->pending += 1;
+    for (;;) {
+        auto submitted = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, nullptr, 0);
+        if (submitted > 0) {
+            return;
+        }
+        if (submitted < 0 && EINTR == errno) {
+            continue;
+        }
+        if (submitted < 0 && (EAGAIN == errno || EBUSY == errno) && state->pending > 1) {
+            uring_reap(state, true);  // completions of the other reads free the kernel resources.
+            continue;
+        }
+        break;
+    }
+
+    // The kernel did not take the entry, take it back and read the block now.
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    state->pending -= 1;
+    auto is_ok = async_read_at(state, block->offset, block->data, block->size);
+    block->state.store(is_ok ? BlockState::READY : BlockState::FAILED, std::memory_order_release);
+}
+
+/*
+ * Marks the completed reads, blocks until one completes when _wait_ is set.
+ */
+static void
+uring_reap(AsyncState *state, bool wait)
+{
+    auto ring = &state->ring;
+    if (wait && state->pending > 0) {
+        syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+
+    auto head = *ring->cq_head;
+    auto tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head += 1) {
+        auto cqe = &ring->cqes[head & *ring->cq_mask];
+        auto block = &state->blocks[cqe->user_data];
+        auto done = cqe->res > 0 ? (uint32_t)cqe->res : 0;
+
+        // Short reads are rare on regular files, finish them synchronously.
+        auto is_ok = done == block->size ||
+                     async_read_at(state, block->offset + done, block->data + done, block->size - done);
+        block->state.store(is_ok ? BlockState::READY : BlockState::FAILED, std::memory_order_release);
+        state->pending -= 1;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+static void
+async_read_task(void *argument)
+{
+    auto block = (AsyncBlock *)argument;
+    auto state = block->owner;
+    auto is_ok = async_read_at(state, block->offset, block->data, block->size);
+
+    std::lock_guard<std::mutex> lock{state->mutex};
+    block->state.store(is_ok ? BlockState::READY : BlockState::FAILED, std::memory_order_release);
+    state->block_done.notify_all();
+}
+
+static void
+async_issue(AsyncFile &file, uint32_t slot, uint64_t offset)
+{
+    auto state = file.state;
+    auto block = &state->blocks[slot];
+    block->offset = offset;
+    block->size = (uint32_t)std::min<uint64_t>(ASYNC_READER_BLOCK_SIZE, state->size - offset);
+    block->last_use = ++state->clock;
+    block->state.store(BlockState::PENDING, std::memory_order_relaxed);
+
+#ifdef HAS_IO_URING
+    if (AsyncBackend::IO_URING == file.backend) {
+        uring_submit_read(state, slot);
+        return;
+    }
+#endif
+    platform::thread_pool_submit(state->pool, async_read_task, block);
+}
+
+static int32_t
+async_find(AsyncState *state, uint64_t offset)
+{
+    for (uint32_t i = 0; i < ASYNC_READER_SLOTS; i += 1) {
+        auto block = &state->blocks[i];
+        if (block->offset == offset && BlockState::EMPTY != block->state.load(std::memory_order_acquire)) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Least recently used slot that is neither in flight nor under the window,
+ * -1 if there is none.
+ */
+static int32_t
+async_victim(AsyncFile &file)
+{
+    auto state = file.state;
+    int32_t victim = -1;
+    for (uint32_t i = 0; i < ASYNC_READER_SLOTS; i += 1) {
+        auto block = &state->blocks[i];
+        auto block_state = block->state.load(std::memory_order_acquire);
+        if (BlockState::EMPTY == block_state) {
+            return (int32_t)i;
+        }
+        if (BlockState::PENDING == block_state || block->data == file.window) {
+            continue;
+        }
+        if (victim < 0 || block->last_use < state->blocks[victim].last_use) {
+            victim = (int32_t)i;
+        }
+    }
+    return victim;
+}
+
+/*
+ * Waits until _slot_ is no longer in flight.
+ */
+static void
+async_wait(AsyncFile &file, uint32_t slot)
+{
+    auto state = file.state;
+    auto block = &state->blocks[slot];
+#ifdef HAS_IO_URING
+    if (AsyncBackend::IO_URING == file.backend) {
+        while (BlockState::PENDING == block->state.load(std::memory_order_acquire)) {
+            uring_reap(state, true);
+        }
+        return;
+    }
+#endif
+    std::unique_lock<std::mutex> lock{state->mutex};
+    state->block_done.wait(lock, [block] { return BlockState::PENDING != block->state.load(); });
+}
+
+/*
+ * Waits until any read in flight completes, so its slot can be reused.
+ */
+static void
+async_wait_any(AsyncFile &file)
+{
+#ifdef HAS_IO_URING
+    if (AsyncBackend::IO_URING == file.backend) {
+        uring_reap(file.state, true);
+        return;
+    }
+#endif
+    auto state = file.state;
+    std::unique_lock<std::mutex> lock{state->mutex};
+    state->block_done.wait(lock, [&file] { return async_victim(file) >= 0; });
+}
+
+/*
+ * Block at _offset_, read now if it was not prefetched. Null on I/O errors.
+ */
+static AsyncBlock *
+async_acquire(AsyncFile &file, uint64_t offset)
+{
+    auto state = file.state;
+    auto slot = async_find(state, offset);
+    if (slot < 0) {
+        file.window = nullptr;  // the block under it may be the only one left.
+        while ((slot = async_victim(file)) < 0) {
+            async_wait_any(file);
+        }
+        async_issue(file, (uint32_t)slot, offset);
+    }
+
+    async_wait(file, (uint32_t)slot);
+    auto block = &state->blocks[slot];
+    block->last_use = ++state->clock;
+    return BlockState::READY == block->state.load(std::memory_order_acquire) ? block : nullptr;
+}
+
+void
+prefetch(AsyncFile &file, uint64_t offset, uint64_t size)
+{
+    auto state = file.state;
+    if (offset >= state->size || size == 0) {
+        return;
+    }
+
+    auto end = std::min(state->size, offset + std::min<uint64_t>(size, state->size - offset));
+    auto first = offset / ASYNC_READER_BLOCK_SIZE;
+    auto last = (end - 1) / ASYNC_READER_BLOCK_SIZE;
+    // Keep half of the cache for the blocks being read.
+    last = std::min<uint64_t>(last, first + ASYNC_READER_SLOTS / 2 - 1);
+
+    for (auto n = first; n <= last; n += 1) {
+        auto block_offset = n * ASYNC_READER_BLOCK_SIZE;
+        if (async_find(state, block_offset) >= 0) {
+            continue;
+        }
+        auto slot = async_victim(file);
+        if (slot < 0) {
+            break;  // everything is in flight already.
+        }
+        async_issue(file, (uint32_t)slot, block_offset);
+    }
+#ifdef HAS_IO_URING
+    if (AsyncBackend::IO_URING == file.backend) {
+        uring_reap(state, false);
+    }
+#endif
+}
+
+bool
+async_read_slow(AsyncFile &file, void *r_data, uint64_t size)
+{
+    auto state = file.state;
+    auto out = (uint8_t *)r_data;
+    if (size > file.size || file.pos > file.size - size) {
+        return false;
+    }
+
+    while (size > 0) {
+        auto block_offset = file.pos - file.pos % ASYNC_READER_BLOCK_SIZE;
+        auto block = async_acquire(file, block_offset);
+        if (!block) {
+            return false;
+        }
+        file.window = block->data;
+        file.window_offset = block->offset;
+        file.window_size = block->size;
+
+        // Sequential scans keep the next blocks in flight.
+        auto is_sequential = block_offset == state->last_block + ASYNC_READER_BLOCK_SIZE;
+        if (is_sequential || block_offset == 0) {
+            prefetch(file, block_offset + ASYNC_READER_BLOCK_SIZE, (uint64_t)state->readahead * ASYNC_READER_BLOCK_SIZE);
+        }
+        state->last_block = block_offset;
+
+        auto count = std::min<uint64_t>(size, block->offset + block->size - file.pos);
+        std::memcpy(out, block->data + (file.pos - block->offset), (size_t)count);
+        file.pos += count;
+        out += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+bool
+open_async(AsyncFile *file, Path file_path, uint32_t readahead)
+{
+    *file = AsyncFile{};
+
+#ifdef OS_POSIX
+    auto fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    auto handle = (intptr_t)fd;
+    auto size = (uint64_t)info.st_size;
+#elif defined OS_WINDOWS
+    auto file_handle = CreateFileW(
+        file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == file_handle) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        CloseHandle(file_handle);
+        return false;
+    }
+    auto handle = (intptr_t)file_handle;
+    auto size = (uint64_t)file_size.QuadPart;
+#endif
+
+    auto state = new AsyncState{};
+    state->handle = handle;
+    state->size = size;
+    state->readahead = std::min<uint32_t>(readahead, ASYNC_READER_SLOTS / 2);
+    state->last_block = ~uint64_t{0};
+    state->memory = (uint8_t *)std::malloc((size_t)ASYNC_READER_SLOTS * ASYNC_READER_BLOCK_SIZE);
+    if (!state->memory) {
+        std::exit(1);
+    }
+    for (uint32_t i = 0; i < ASYNC_READER_SLOTS; i += 1) {
+        state->blocks[i].data = state->memory + (size_t)i * ASYNC_READER_BLOCK_SIZE;
+        state->blocks[i].owner = state;
+    }
+
+    file->state = state;
+    file->size = size;
+    file->backend = AsyncBackend::THREAD_POOL;
+#ifdef HAS_IO_URING
+    if (uring_init(&state->ring, ASYNC_READER_SLOTS)) {
+        file->backend = AsyncBackend::IO_URING;
+    }
+#endif
+    if (AsyncBackend::THREAD_POOL == file->backend) {
+        state->pool = platform::thread_pool_create(ASYNC_READER_THREADS);
+    }
+
+    return true;
+}
+
+void
+close_async(AsyncFile *file)
+{
+    auto state = file->state;
+    if (!state) {
+        return;
+    }
+
+#ifdef HAS_IO_URING
+    if (AsyncBackend::IO_URING == file->backend) {
+        while (state->pending > 0) {
+            uring_reap(state, true);
+        }
+        uring_free(&state->ring);
+    }
+#endif
+    if (state->pool) {
+        platform::thread_pool_destroy(state->pool);
+    }
+
+#ifdef OS_POSIX
+    close((int)state->handle);
+#elif defined OS_WINDOWS
+    CloseHandle((HANDLE)state->handle);
+#endif
+    std::free(state->memory);
+    delete state;
+    *file = AsyncFile{};
+}
+
+}  // namespace binaryreader
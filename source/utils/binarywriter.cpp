@@ -0,0 +1,204 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/binarywriter.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace binarywriter {
+
+bool
+writer_flush(WriterFile &file)
+{
+    if (file.has_failed) {
+        return false;
+    }
+    if (file.buffer_count > 0 && !write_at(file, file.buffer_offset, file.buffer, file.buffer_count)) {
+        file.has_failed = true;
+        return false;
+    }
+
+    file.buffer_offset = file.pos;
+    file.buffer_count = 0;
+    return true;
+}
+
+bool
+writer_write_slow(WriterFile &file, const void *data, uint64_t size)
+{
+    if (!writer_flush(file)) {
+        return false;
+    }
+
+    if (size > BINARY_WRITER_BUFFER_SIZE / 2) {
+        if (!write_at(file, file.pos, data, size)) {
+            file.has_failed = true;
+            return false;
+        }
+        file.pos += size;
+        file.buffer_offset = file.pos;
+        return true;
+    }
+
+    std::memcpy(file.buffer, data, (size_t)size);
+    file.buffer_count = (uint32_t)size;
+    file.pos += size;
+    return true;
+}
+
+void
+patch_journal_init(PatchJournal *journal)
+{
+    *journal = PatchJournal{};
+}
+
+void
+patch_journal_free(PatchJournal *journal)
+{
+    std::free(journal->entries);
+    std::free(journal->data);
+    *journal = PatchJournal{};
+}
+
+void
+patch_add(PatchJournal *journal, uint64_t offset, const void *data, uint64_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    if (journal->entry_count == journal->entry_capacity) {
+        auto new_capacity = std::max<uint64_t>(64, journal->entry_capacity * 2);
+        auto reallocated_buffer = (PatchEntry *)std::realloc(journal->entries, (size_t)new_capacity * sizeof(PatchEntry));
+        if (!reallocated_buffer) {
+            std::exit(1);
+        }
+        journal->entries = reallocated_buffer;
+        journal->entry_capacity = new_capacity;
+    }
+    if (journal->data_size + size > journal->data_capacity) {
+        auto new_capacity = std::max<uint64_t>({4096, journal->data_capacity * 2, journal->data_size + size});
+        auto reallocated_buffer = (uint8_t *)std::realloc(journal->data, (size_t)new_capacity);
+        if (!reallocated_buffer) {
+            std::exit(1);
+        }
+        journal->data = reallocated_buffer;
+        journal->data_capacity = new_capacity;
+    }
+
+    std::memcpy(journal->data + journal->data_size, data, (size_t)size);
+    journal->entries[journal->entry_count] = PatchEntry{offset, size, journal->data_size, journal->entry_count};
+    journal->entry_count += 1;
+    journal->data_size += size;
+}
+
+/*
+ * Writes the extent [_begin_, _end_) covered by _entries_: the gaps are read
+ * back from the file unless the patches cover every byte. Nothing is written
+ * if reading them back fails.
+ */
+static bool
+patch_write_extent(
+    PatchJournal *journal,
+    WriterFile &file,
+    PatchEntry *entries,
+    uint64_t entry_count,
+    uint64_t begin,
+    uint64_t end,
+    uint8_t *extent)
+{
+    uint64_t covered = 0;
+    uint64_t covered_end = begin;
+    for (uint64_t i = 0; i < entry_count; i += 1) {
+        auto entry_end = entries[i].offset + entries[i].size;
+        if (entry_end > covered_end) {
+            covered += entry_end - std::max(covered_end, entries[i].offset);
+            covered_end = entry_end;
+        }
+    }
+
+    auto size = end - begin;
+    if (covered < size) {
+        uint64_t read_count = 0;
+        if (!read_at(file, begin, extent, size, &read_count)) {
+            return false;  // writing the gaps as zeros would destroy what the file holds there.
+        }
+        std::memset(extent + read_count, 0, (size_t)(size - read_count));  // past the end of the file.
+    }
+
+    // Overlapping patches are applied in the order they were added.
+    std::sort(entries, entries + entry_count, [](const PatchEntry &a, const PatchEntry &b) {
+        return a.sequence < b.sequence;
+    });
+    for (uint64_t i = 0; i < entry_count; i += 1) {
+        auto &entry = entries[i];
+        std::memcpy(extent + (entry.offset - begin), journal->data + entry.data_offset, (size_t)entry.size);
+    }
+
+    return write_at(file, begin, extent, size);
+}
+
+bool
+patch_commit(PatchJournal *journal, WriterFile &file, uint64_t *out_write_count)
+{
+    uint64_t write_count = 0;
+    if (!writer_flush(file)) {
+        return false;
+    }
+
+    auto entries = journal->entries;
+    auto entry_count = journal->entry_count;
+    std::sort(entries, entries + entry_count, [](const PatchEntry &a, const PatchEntry &b) {
+        return a.offset < b.offset || (a.offset == b.offset && a.sequence < b.sequence);
+    });
+
+    uint8_t *extent = nullptr;
+    uint64_t extent_capacity = 0;
+    bool is_written = true;
+    for (uint64_t first = 0; first < entry_count && is_written;) {
+        auto begin = entries[first].offset;
+        auto end = begin + entries[first].size;
+        auto last = first + 1;
+        while (last < entry_count) {
+            auto &next = entries[last];
+            auto next_end = std::max(end, next.offset + next.size);
+            // Only cut where nothing overlaps, later patches must land over earlier ones.
+            auto is_too_big = next.offset >= end && next_end - begin > PATCH_MAX_EXTENT;
+            if (next.offset > end + PATCH_MERGE_GAP || is_too_big) {
+                break;
+            }
+            end = next_end;
+            last += 1;
+        }
+
+        if (end - begin > extent_capacity) {
+            extent_capacity = end - begin;
+            std::free(extent);
+            extent = (uint8_t *)std::malloc((size_t)extent_capacity);
+            if (!extent) {
+                std::exit(1);
+            }
+        }
+        is_written = patch_write_extent(journal, file, entries + first, last - first, begin, end, extent);
+        write_count += 1;
+        first = last;
+    }
+    std::free(extent);
+
+    journal->entry_count = 0;
+    journal->data_size = 0;
+    if (out_write_count) {
+        *out_write_count = write_count;
+    }
+    if (!is_written) {
+        file.has_failed = true;
+    }
+
+    return is_written;
+}
+
+}  // namespace binarywriter
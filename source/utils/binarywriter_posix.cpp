@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_POSIX
+#include "include/utils/binarywriter.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace binarywriter {
+
+bool
+open_writer(WriterFile *file, Path file_path, WriterMode mode)
+{
+    *file = WriterFile{};
+    file->handle = -1;
+
+    auto flags = O_RDWR | O_CLOEXEC | (WriterMode::CREATE == mode ? O_CREAT | O_TRUNC : 0);
+    auto fd = open(file_path.c_str(), flags, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    file->buffer = (uint8_t *)std::malloc(BINARY_WRITER_BUFFER_SIZE);
+    if (!file->buffer) {
+        std::exit(1);
+    }
+    file->handle = fd;
+
+    return true;
+}
+
+bool
+close_writer(WriterFile *file)
+{
+    auto is_written = writer_flush(*file);
+    if (file->handle >= 0) {
+        is_written = close((int)file->handle) == 0 && is_written;
+    }
+    std::free(file->buffer);
+    *file = WriterFile{};
+    file->handle = -1;
+
+    return is_written;
+}
+
+bool
+write_at(WriterFile &file, uint64_t offset, const void *data, uint64_t size)
+{
+    auto in = (const uint8_t *)data;
+    while (size > 0) {
+        auto count = pwrite((int)file.handle, in, (size_t)size, (off_t)offset);
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        in += count;
+        offset += (uint64_t)count;
+        size -= (uint64_t)count;
+    }
+
+    return true;
+}
+
+bool
+read_at(WriterFile &file, uint64_t offset, void *r_data, uint64_t size, uint64_t *out_read_count)
+{
+    auto out = (uint8_t *)r_data;
+    *out_read_count = 0;
+    while (size > 0) {
+        auto count = pread((int)file.handle, out, (size_t)size, (off_t)offset);
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+        if (count < 0) {
+            return false;
+        }
+        if (count == 0) {
+            break;  // end of the file.
+        }
+        out += count;
+        offset += (uint64_t)count;
+        size -= (uint64_t)count;
+        *out_read_count += (uint64_t)count;
+    }
+
+    return true;
+}
+
+}  // namespace binarywriter
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_WINDOWS
+#include "include/utils/binarywriter.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <windows.h>
+
+namespace binarywriter {
+
+bool
+open_writer(WriterFile *file, Path file_path, WriterMode mode)
+{
+    *file = WriterFile{};
+    file->handle = (intptr_t)INVALID_HANDLE_VALUE;
+
+    auto disposition = WriterMode::CREATE == mode ? CREATE_ALWAYS : OPEN_EXISTING;
+    auto handle = CreateFileW(
+        file_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, disposition,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == handle) {
+        return false;
+    }
+
+    file->buffer = (uint8_t *)std::malloc(BINARY_WRITER_BUFFER_SIZE);
+    if (!file->buffer) {
+        std::exit(1);
+    }
+    file->handle = (intptr_t)handle;
+
+    return true;
+}
+
+bool
+close_writer(WriterFile *file)
+{
+    auto is_written = writer_flush(*file);
+    if ((HANDLE)file->handle != INVALID_HANDLE_VALUE) {
+        is_written = CloseHandle((HANDLE)file->handle) && is_written;
+    }
+    std::free(file->buffer);
+    *file = WriterFile{};
+    file->handle = (intptr_t)INVALID_HANDLE_VALUE;
+
+    return is_written;
+}
+
+bool
+write_at(WriterFile &file, uint64_t offset, const void *data, uint64_t size)
+{
+    auto in = (const uint8_t *)data;
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        DWORD count = 0;
+        auto chunk = (DWORD)std::min<uint64_t>(size, 0x40000000);
+        if (!WriteFile((HANDLE)file.handle, in, chunk, &count, &overlapped) || count == 0) {
+            return false;
+        }
+        in += count;
+        offset += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+bool
+read_at(WriterFile &file, uint64_t offset, void *r_data, uint64_t size, uint64_t *out_read_count)
+{
+    auto out = (uint8_t *)r_data;
+    *out_read_count = 0;
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        DWORD count = 0;
+        auto chunk = (DWORD)std::min<uint64_t>(size, 0x40000000);
+        if (!ReadFile((HANDLE)file.handle, out, chunk, &count, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            return false;
+        }
+        if (count == 0) {
+            break;  // end of the file.
+        }
+        out += count;
+        offset += count;
+        size -= count;
+        *out_read_count += count;
+    }
+
+    return true;
+}
+
+}  // namespace binarywriter
+#endif
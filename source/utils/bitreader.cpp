@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/bitreader.hpp"
+#include "include/utils/cpu.hpp"
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace binaryreader {
+
+bool
+bit_run_init(BitFieldRun *run, const uint8_t *widths, uint32_t count, BitOrder order)
+{
+    *run = BitFieldRun{};
+    if (count == 0 || count > BIT_RUN_MAX_FIELDS) {
+        return false;
+    }
+
+    uint32_t total_bits = 0;
+    for (uint32_t i = 0; i < count; i += 1) {
+        if (widths[i] == 0) {
+            return false;
+        }
+        total_bits += widths[i];
+    }
+    if (total_bits > BIT_READER_REFILL_BITS) {
+        return false;
+    }
+
+    run->count = count;
+    run->total_bits = total_bits;
+    run->order = order;
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; i += 1) {
+        auto width = widths[i];
+        // MSB first words hold the first field in their top bits.
+        auto shift = BitOrder::LSB_FIRST == order ? offset : total_bits - offset - width;
+        run->widths[i] = width;
+        run->shifts[i] = (uint8_t)shift;
+        run->masks[i] = ((uint64_t{1} << width) - 1) << shift;
+        offset += width;
+    }
+
+    return true;
+}
+
+#ifdef ARCH_X86
+ASTRAEA_TARGET("bmi2")
+static void
+extract_bit_run_bmi2(uint64_t word, const BitFieldRun *run, uint64_t *out)
+{
+    for (uint32_t i = 0; i < run->count; i += 1) {
+        out[i] = _pext_u64(word, run->masks[i]);
+    }
+}
+#endif
+
+void
+extract_bit_run(uint64_t word, const BitFieldRun *run, uint64_t *out)
+{
+#ifdef ARCH_X86
+    if (platform::cpu_has(platform::CPU_BMI2)) {
+        extract_bit_run_bmi2(word, run, out);
+        return;
+    }
+#endif
+
+    for (uint32_t i = 0; i < run->count; i += 1) {
+        out[i] = (word & run->masks[i]) >> run->shifts[i];
+    }
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/bufferedreader.hpp"
+#include <algorithm>
+
+namespace binaryreader {
+
+bool
+buffered_read_slow(BufferedFile &file, void *r_data, uint64_t size)
+{
+    auto out = (uint8_t *)r_data;
+    if (size > file.size || file.pos > file.size - size) {
+        return false;
+    }
+
+    // Whatever the buffer still holds from the current offset.
+    auto buffer_end = file.buffer_offset + file.buffer_count;
+    if (file.pos >= file.buffer_offset && file.pos < buffer_end) {
+        auto count = buffer_end - file.pos;
+        std::memcpy(out, file.buffer + (file.pos - file.buffer_offset), (size_t)count);
+        file.pos += count;
+        out += count;
+        size -= count;
+    }
+
+    if (size >= BUFFERED_READER_SIZE) {
+        if (!read_at(file, file.pos, out, size)) {
+            return false;
+        }
+        file.pos += size;
+        read_ahead(file, file.pos, BUFFERED_READER_SIZE);
+        return true;
+    }
+
+    auto count = (uint32_t)std::min<uint64_t>(BUFFERED_READER_SIZE, file.size - file.pos);
+    if (!read_at(file, file.pos, file.buffer, count)) {
+        file.buffer_count = 0;
+        return false;
+    }
+    file.buffer_offset = file.pos;
+    file.buffer_count = count;
+    read_ahead(file, file.pos + count, BUFFERED_READER_SIZE);
+
+    std::memcpy(out, file.buffer, (size_t)size);
+    file.pos += size;
+    return true;
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_POSIX
+#include "include/utils/bufferedreader.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace binaryreader {
+
+bool
+open_buffered(BufferedFile *file, Path file_path)
+{
+    *file = BufferedFile{};
+    file->handle = -1;
+
+    auto fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    file->buffer = (uint8_t *)std::malloc(BUFFERED_READER_SIZE);
+    if (!file->buffer) {
+        std::exit(1);
+    }
+    file->handle = fd;
+    file->size = (uint64_t)info.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    return true;
+}
+
+void
+close_buffered(BufferedFile *file)
+{
+    if (file->handle >= 0) {
+        close((int)file->handle);
+    }
+    std::free(file->buffer);
+    *file = BufferedFile{};
+    file->handle = -1;
+}
+
+bool
+read_at(BufferedFile &file, uint64_t offset, void *r_data, uint64_t size)
+{
+    auto out = (uint8_t *)r_data;
+    while (size > 0) {
+        auto count = pread((int)file.handle, out, (size_t)size, (off_t)offset);
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        out += count;
+        offset += (uint64_t)count;
+        size -= (uint64_t)count;
+    }
+
+    return true;
+}
+
+void
+read_ahead(BufferedFile &file, uint64_t offset, uint64_t size)
+{
+#ifdef POSIX_FADV_WILLNEED
+    if (offset < file.size) {
+        posix_fadvise((int)file.handle, (off_t)offset, (off_t)size, POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+}  // namespace binaryreader
+#endif
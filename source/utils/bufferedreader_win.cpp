@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_WINDOWS
+#include "include/utils/bufferedreader.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <windows.h>
+
+namespace binaryreader {
+
+bool
+open_buffered(BufferedFile *file, Path file_path)
+{
+    *file = BufferedFile{};
+    file->handle = (intptr_t)INVALID_HANDLE_VALUE;
+
+    // The cache manager reads ahead more aggressively for sequential scans.
+    auto handle = CreateFileW(
+        file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (INVALID_HANDLE_VALUE == handle) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    file->buffer = (uint8_t *)std::malloc(BUFFERED_READER_SIZE);
+    if (!file->buffer) {
+        std::exit(1);
+    }
+    file->handle = (intptr_t)handle;
+    file->size = (uint64_t)size.QuadPart;
+
+    return true;
+}
+
+void
+close_buffered(BufferedFile *file)
+{
+    if ((HANDLE)file->handle != INVALID_HANDLE_VALUE) {
+        CloseHandle((HANDLE)file->handle);
+    }
+    std::free(file->buffer);
+    *file = BufferedFile{};
+    file->handle = (intptr_t)INVALID_HANDLE_VALUE;
+}
+
+bool
+read_at(BufferedFile &file, uint64_t offset, void *r_data, uint64_t size)
+{
+    auto out = (uint8_t *)r_data;
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        DWORD count = 0;
+        auto chunk = (DWORD)std::min<uint64_t>(size, 0x40000000);
+        if (!ReadFile((HANDLE)file.handle, out, chunk, &count, &overlapped) || count == 0) {
+            return false;
+        }
+        out += count;
+        offset += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+void
+read_ahead(BufferedFile &, uint64_t, uint64_t)
+{
+    // FILE_FLAG_SEQUENTIAL_SCAN already reads ahead.
+}
+
+}  // namespace binaryreader
+#endif
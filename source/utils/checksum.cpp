@@ -0,0 +1,330 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/checksum.hpp"
+#include "include/utils/cpu.hpp"
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace binaryreader {
+
+// Largest number of bytes summed before Adler-32 sums must be reduced modulo 65521.
+#define ADLER32_NMAX 5552
+#define ADLER32_BASE 65521
+
+/*
+ * Slice-by-16 tables: _table_[k][n] is the CRC of byte _n_ followed by _k_
+ * zero bytes, so 16 bytes are folded with 16 independent lookups.
+ */
+struct CrcTables {
+    uint32_t table[16][256];
+};
+
+static constexpr CrcTables
+crc_tables_make(uint32_t polynomial)
+{
+    auto tables = CrcTables{};
+    for (uint32_t n = 0; n < 256; n += 1) {
+        auto crc = n;
+        for (int bit = 0; bit < 8; bit += 1) {
+            crc = crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1;
+        }
+        tables.table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n += 1) {
+        for (uint32_t k = 1; k < 16; k += 1) {
+            auto prev = tables.table[k - 1][n];
+            tables.table[k][n] = (prev >> 8) ^ tables.table[0][prev & 0xFF];
+        }
+    }
+
+    return tables;
+}
+
+static constexpr CrcTables crc32_tables = crc_tables_make(0xEDB88320);
+static constexpr CrcTables crc32c_tables = crc_tables_make(0x82F63B78);
+
+/*
+ * Updates the raw (not inverted) _crc_ state.
+ */
+static uint32_t
+crc_slice16(const CrcTables &tables, uint32_t crc, const uint8_t *data, uint64_t size)
+{
+    auto t = tables.table;
+    for (; size >= 16; data += 16, size -= 16) {
+        auto a = (uint32_t)load_unsigned(data, 4, Endian::little) ^ crc;
+        auto b = (uint32_t)load_unsigned(data + 4, 4, Endian::little);
+        auto c = (uint32_t)load_unsigned(data + 8, 4, Endian::little);
+        auto d = (uint32_t)load_unsigned(data + 12, 4, Endian::little);
+        crc = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF] ^ t[12][a >> 24] ^
+              t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF] ^ t[9][(b >> 16) & 0xFF] ^ t[8][b >> 24] ^
+              t[7][c & 0xFF] ^ t[6][(c >> 8) & 0xFF] ^ t[5][(c >> 16) & 0xFF] ^ t[4][c >> 24] ^
+              t[3][d & 0xFF] ^ t[2][(d >> 8) & 0xFF] ^ t[1][(d >> 16) & 0xFF] ^ t[0][d >> 24];
+    }
+    for (; size > 0; data += 1, size -= 1) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+    }
+
+    return crc;
+}
+
+#ifdef ARCH_X86
+/*
+ * Folds the 128 bits of _x_ over the 128 bits that follow them, _next_.
+ */
+ASTRAEA_TARGET("pclmul")
+static inline __m128i
+crc32_fold(__m128i x, __m128i next, __m128i k)
+{
+    auto low = _mm_clmulepi64_si128(x, k, 0x00);
+    auto high = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, next), low);
+}
+
+/*
+ * Folds 64 bytes per iteration with carry-less multiplications, then
+ * Barrett reduces to 32 bits ("Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction", Intel). _size_ is a multiple of 16, at least
+ * 64, _crc_ is the raw state.
+ */
+ASTRAEA_TARGET("pclmul,sse4.1")
+static uint32_t
+crc32_pclmul(uint32_t crc, const uint8_t *data, uint64_t size)
+{
+    alignas(16) static const uint64_t k1k2[] = {0x0154442BD4, 0x01C6E41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997D0, 0x00CCAA009E};
+    alignas(16) static const uint64_t k5k0[] = {0x0163CD6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01DB710641, 0x01F7011641};
+
+    auto x1 = _mm_loadu_si128((const __m128i *)(data + 0x00));
+    auto x2 = _mm_loadu_si128((const __m128i *)(data + 0x10));
+    auto x3 = _mm_loadu_si128((const __m128i *)(data + 0x20));
+    auto x4 = _mm_loadu_si128((const __m128i *)(data + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    auto k = _mm_load_si128((const __m128i *)k1k2);
+    data += 64;
+    size -= 64;
+
+    for (; size >= 64; data += 64, size -= 64) {
+        auto x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+        auto x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+        auto x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+        auto x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(data + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(data + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(data + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(data + 0x30)));
+    }
+
+    // Four lanes into one.
+    k = _mm_load_si128((const __m128i *)k3k4);
+    x1 = crc32_fold(x1, x2, k);
+    x1 = crc32_fold(x1, x3, k);
+    x1 = crc32_fold(x1, x4, k);
+    for (; size >= 16; data += 16, size -= 16) {
+        x1 = crc32_fold(x1, _mm_loadu_si128((const __m128i *)data), k);
+    }
+
+    // 128 bits to 64.
+    auto low_mask = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    k = _mm_loadl_epi64((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, low_mask), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    k = _mm_load_si128((const __m128i *)poly);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, low_mask), k, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, low_mask), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+ASTRAEA_TARGET("sse4.2")
+static uint32_t
+crc32c_sse42(uint32_t crc, const uint8_t *data, uint64_t size)
+{
+    uint64_t crc64 = crc;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; size > 0; data += 1, size -= 1) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    return crc;
+}
+
+/*
+ * Sums 32 bytes per iteration: s1 with sums of absolute differences against
+ * zero, s2 with multiply-adds of the bytes by their distance to the end of
+ * the block. Returns the bytes done, the sums are reduced.
+ */
+ASTRAEA_TARGET("ssse3")
+static uint64_t
+adler32_ssse3(uint32_t *io_s1, uint32_t *io_s2, const uint8_t *data, uint64_t size)
+{
+    auto s1 = *io_s1;
+    auto s2 = *io_s2;
+    auto blocks = size / 32;
+    auto done = blocks * 32;
+
+    auto tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+    auto tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    auto zero = _mm_setzero_si128();
+    auto ones = _mm_set1_epi16(1);
+    while (blocks > 0) {
+        auto n = (uint32_t)std::min<uint64_t>(blocks, ADLER32_NMAX / 32);
+        blocks -= n;
+
+        auto v_ps = _mm_setr_epi32((int)(s1 * n), 0, 0, 0);  // s1 of each block start, added 32 times.
+        auto v_s2 = _mm_setr_epi32((int)s2, 0, 0, 0);
+        auto v_s1 = _mm_setzero_si128();
+        for (; n > 0; n -= 1, data += 32) {
+            auto bytes1 = _mm_loadu_si128((const __m128i *)data);
+            auto bytes2 = _mm_loadu_si128((const __m128i *)(data + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+        }
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (uint32_t)_mm_cvtsi128_si32(v_s1);
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2 = (uint32_t)_mm_cvtsi128_si32(v_s2);
+        s1 %= ADLER32_BASE;
+        s2 %= ADLER32_BASE;
+    }
+
+    *io_s1 = s1;
+    *io_s2 = s2;
+    return done;
+}
+#endif
+
+uint32_t
+crc32_update(uint32_t crc, const void *data, uint64_t size)
+{
+    auto bytes = (const uint8_t *)data;
+    crc = ~crc;
+#ifdef ARCH_X86
+    if (size >= 64 && platform::cpu_has(platform::CPU_PCLMUL | platform::CPU_SSE41)) {
+        auto folded = size & ~(uint64_t)15;
+        crc = crc32_pclmul(crc, bytes, folded);
+        bytes += folded;
+        size -= folded;
+    }
+#endif
+    crc = crc_slice16(crc32_tables, crc, bytes, size);
+
+    return ~crc;
+}
+
+uint32_t
+crc32c_update(uint32_t crc, const void *data, uint64_t size)
+{
+    auto bytes = (const uint8_t *)data;
+    crc = ~crc;
+#ifdef ARCH_X86
+    if (platform::cpu_has(platform::CPU_SSE42)) {
+        return ~crc32c_sse42(crc, bytes, size);
+    }
+#endif
+    crc = crc_slice16(crc32c_tables, crc, bytes, size);
+
+    return ~crc;
+}
+
+uint32_t
+adler32_update(uint32_t adler, const void *data, uint64_t size)
+{
+    auto bytes = (const uint8_t *)data;
+    auto s1 = adler & 0xFFFF;
+    auto s2 = adler >> 16;
+#ifdef ARCH_X86
+    if (size >= 32 && platform::cpu_has(platform::CPU_SSSE3)) {
+        auto done = adler32_ssse3(&s1, &s2, bytes, size);
+        bytes += done;
+        size -= done;
+    }
+#endif
+    while (size > 0) {
+        auto count = std::min<uint64_t>(size, ADLER32_NMAX);
+        size -= count;
+        for (; count > 0; count -= 1, bytes += 1) {
+            s1 += *bytes;
+            s2 += s1;
+        }
+        s1 %= ADLER32_BASE;
+        s2 %= ADLER32_BASE;
+    }
+
+    return s1 | (s2 << 16);
+}
+
+void
+checksum_init(Checksum *checksum, ChecksumKind kind)
+{
+    checksum->kind = kind;
+    checksum->value = ChecksumKind::ADLER32 == kind ? 1 : 0;
+    checksum->size = 0;
+}
+
+void
+checksum_update(Checksum *checksum, const void *data, uint64_t size)
+{
+    switch (checksum->kind) {
+    case ChecksumKind::CRC32:
+        checksum->value = crc32_update(checksum->value, data, size);
+        break;
+    case ChecksumKind::CRC32C:
+        checksum->value = crc32c_update(checksum->value, data, size);
+        break;
+    case ChecksumKind::ADLER32:
+        checksum->value = adler32_update(checksum->value, data, size);
+        break;
+    }
+    checksum->size += size;
+}
+
+void
+checksum_pull_init(ChecksumPull *tee, StreamPull pull, void *user, ChecksumKind kind)
+{
+    tee->pull = pull;
+    tee->user = user;
+    checksum_init(&tee->checksum, kind);
+}
+
+int64_t
+checksum_pull(void *user, void *buffer, uint64_t size)
+{
+    auto tee = (ChecksumPull *)user;
+    auto count = tee->pull(tee->user, buffer, size);
+    if (count > 0) {
+        checksum_update(&tee->checksum, buffer, (uint64_t)count);
+    }
+
+    return count;
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/cpu.hpp"
+#include <atomic>
+
+#if defined(ARCH_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace platform {
+
+static uint32_t
+cpu_detect_features()
+{
+    uint32_t features = 0;
+#if defined(ARCH_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    auto max_leaf = info[0];
+
+    __cpuid(info, 1);
+    auto ecx = (uint32_t)info[2];
+    auto edx = (uint32_t)info[3];
+    if (edx & (1u << 26)) features |= CPU_SSE2;
+    if (ecx & (1u << 9)) features |= CPU_SSSE3;
+    if (ecx & (1u << 19)) features |= CPU_SSE41;
+    if (ecx & (1u << 20)) features |= CPU_SSE42;
+    if (ecx & (1u << 1)) features |= CPU_PCLMUL;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1 and 2).
+    auto has_ymm = (ecx & (1u << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        auto ebx = (uint32_t)info[1];
+        if (has_ymm && (ebx & (1u << 5))) features |= CPU_AVX2;
+        if (ebx & (1u << 8)) features |= CPU_BMI2;
+    }
+#elif defined(ARCH_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) features |= CPU_SSE2;
+    if (__builtin_cpu_supports("ssse3")) features |= CPU_SSSE3;
+    if (__builtin_cpu_supports("sse4.1")) features |= CPU_SSE41;
+    if (__builtin_cpu_supports("sse4.2")) features |= CPU_SSE42;
+    if (__builtin_cpu_supports("pclmul")) features |= CPU_PCLMUL;
+    if (__builtin_cpu_supports("avx2")) features |= CPU_AVX2;
+    if (__builtin_cpu_supports("bmi2")) features |= CPU_BMI2;
+#endif
+
+    return features;
+}
+
+static std::atomic<uint32_t> feature_mask{0xFFFFFFFFu};
+
+uint32_t
+cpu_features()
+{
+    static const uint32_t features = cpu_detect_features();
+    return features & feature_mask.load(std::memory_order_relaxed);
+}
+
+void
+cpu_limit_features(uint32_t mask)
+{
+    feature_mask.store(mask, std::memory_order_relaxed);
+}
+
+}  // namespace platform
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/endian.hpp"
+#include "include/utils/cpu.hpp"
+#include <cstring>
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+#ifdef ARCH_X86
+/*
+ * Shuffle reversing every element of 2, 4 or 8 bytes of a 16 byte lane.
+ */
+static const uint8_t swap_masks[3][16] = {
+    {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+    {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+    {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+};
+
+static const uint8_t *
+swap_mask(uint32_t byte_size)
+{
+    return swap_masks[byte_size == 2 ? 0 : byte_size == 4 ? 1 : 2];
+}
+
+/*
+ * Swaps 64 bytes per iteration, returns the number of bytes done.
+ */
+ASTRAEA_TARGET("avx2")
+static uint64_t
+byte_swap_avx2(uint8_t *data, uint64_t size, uint32_t byte_size)
+{
+    auto lane = _mm_loadu_si128((const __m128i *)swap_mask(byte_size));
+    auto mask = _mm256_broadcastsi128_si256(lane);
+
+    uint64_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        auto a = _mm256_loadu_si256((const __m256i *)(data + i));
+        auto b = _mm256_loadu_si256((const __m256i *)(data + i + 32));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_shuffle_epi8(a, mask));
+        _mm256_storeu_si256((__m256i *)(data + i + 32), _mm256_shuffle_epi8(b, mask));
+    }
+    for (; i + 32 <= size; i += 32) {
+        auto a = _mm256_loadu_si256((const __m256i *)(data + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_shuffle_epi8(a, mask));
+    }
+
+    return i;
+}
+
+/*
+ * Swaps 16 bytes per iteration, returns the number of bytes done.
+ */
+ASTRAEA_TARGET("ssse3")
+static uint64_t
+byte_swap_ssse3(uint8_t *data, uint64_t size, uint32_t byte_size)
+{
+    auto mask = _mm_loadu_si128((const __m128i *)swap_mask(byte_size));
+
+    uint64_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto a = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_shuffle_epi8(a, mask));
+    }
+
+    return i;
+}
+#endif
+
+/*
+ * Swaps whole elements one at a time with bswap, for the tails.
+ */
+template <typename Word>
+static void
+byte_swap_scalar(uint8_t *data, uint64_t size)
+{
+    for (uint64_t i = 0; i + sizeof(Word) <= size; i += sizeof(Word)) {
+        Word value;
+        std::memcpy(&value, data + i, sizeof(Word));
+        value = byte_swap(value);
+        std::memcpy(data + i, &value, sizeof(Word));
+    }
+}
+
+void
+byte_swap_array(void *data, uint64_t count, uint32_t byte_size)
+{
+    auto bytes = (uint8_t *)data;
+    auto size = count * byte_size;
+    uint64_t done = 0;
+
+#ifdef ARCH_X86
+    if (size >= 32 && platform::cpu_has(platform::CPU_AVX2)) {
+        done = byte_swap_avx2(bytes, size, byte_size);
+    }
+    if (size - done >= 16 && platform::cpu_has(platform::CPU_SSSE3)) {
+        done += byte_swap_ssse3(bytes + done, size - done, byte_size);
+    }
+#endif
+
+    switch (byte_size) {
+    case 2:
+        byte_swap_scalar<uint16_t>(bytes + done, size - done);
+        break;
+    case 4:
+        byte_swap_scalar<uint32_t>(bytes + done, size - done);
+        break;
+    case 8:
+        byte_swap_scalar<uint64_t>(bytes + done, size - done);
+        break;
+    }
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/inflatereader.hpp"
+#include <climits>
+#include <cstdlib>
+
+#ifdef ASTRAEA_USE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace binaryreader {
+
+static bool
+inflate_init(InflateSource *source, InflateMethod method)
+{
+    source->method = method;
+    if (InflateMethod::STORED == method) {
+        return true;
+    }
+
+#ifdef ASTRAEA_USE_ZLIB
+    auto stream = (z_stream *)std::calloc(1, sizeof(z_stream));
+    if (!stream) {
+        std::exit(1);
+    }
+    auto window_bits = InflateMethod::RAW_DEFLATE == method ? -MAX_WBITS : MAX_WBITS;
+    if (inflateInit2(stream, window_bits) != Z_OK) {
+        std::free(stream);
+        return false;
+    }
+    source->inflater = stream;
+    return true;
+#else
+    source->error = InflateError::UNSUPPORTED;
+    return false;
+#endif
+}
+
+bool
+inflate_open(InflateSource *source, InflateMethod method, StreamPull input, void *user, uint64_t compressed_size)
+{
+    *source = InflateSource{};
+    source->input = input;
+    source->input_user = user;
+    source->input_remaining = compressed_size;
+    source->input_buffer = (uint8_t *)std::malloc(INFLATE_INPUT_CHUNK);
+    if (!source->input_buffer) {
+        std::exit(1);
+    }
+
+    return inflate_init(source, method);
+}
+
+bool
+inflate_open_memory(InflateSource *source, InflateMethod method, const uint8_t *data, uint64_t size)
+{
+    *source = InflateSource{};
+    source->input_data = data;
+    source->input_remaining = size;
+
+    return inflate_init(source, method);
+}
+
+void
+inflate_close(InflateSource *source)
+{
+#ifdef ASTRAEA_USE_ZLIB
+    if (source->inflater) {
+        inflateEnd((z_stream *)source->inflater);
+        std::free(source->inflater);
+    }
+#endif
+    std::free(source->input_buffer);
+    *source = InflateSource{};
+}
+
+/*
+ * Hands the next compressed bytes to the caller, at most _max_size_ of them.
+ * Returns the number of bytes in _out_data_, zero at the end of the region
+ * and -1 on errors.
+ */
+static int64_t
+inflate_next_input(InflateSource *source, uint64_t max_size, const uint8_t **out_data)
+{
+    auto size = std::min(source->input_remaining, max_size);
+    if (size == 0) {
+        return 0;
+    }
+
+    if (!source->input) {
+        *out_data = source->input_data;
+        source->input_data += size;
+        source->input_remaining -= size;
+        return (int64_t)size;
+    }
+
+    auto count = source->input(source->input_user, source->input_buffer, std::min<uint64_t>(size, INFLATE_INPUT_CHUNK));
+    if (count <= 0) {
+        source->error = InflateError::READ_FAILED;
+        return -1;
+    }
+    *out_data = source->input_buffer;
+    source->input_remaining -= (uint64_t)count;
+    return count;
+}
+
+static int64_t
+inflate_stored(InflateSource *source, uint8_t *buffer, uint64_t size)
+{
+    const uint8_t *data = nullptr;
+    auto count = inflate_next_input(source, size, &data);
+    if (count <= 0) {
+        source->is_done = count == 0;
+        return count;
+    }
+
+    std::memcpy(buffer, data, (size_t)count);
+    source->total_in += (uint64_t)count;
+    source->total_out += (uint64_t)count;
+    return count;
+}
+
+#ifdef ASTRAEA_USE_ZLIB
+static int64_t
+inflate_deflated(InflateSource *source, uint8_t *buffer, uint64_t size)
+{
+    auto stream = (z_stream *)source->inflater;
+    stream->next_out = buffer;
+    stream->avail_out = (uInt)size;
+
+    while (stream->avail_out > 0 && !source->is_done) {
+        if (stream->avail_in == 0) {
+            const uint8_t *data = nullptr;
+            auto count = inflate_next_input(source, UINT_MAX, &data);
+            if (count < 0) {
+                return -1;
+            }
+            if (count == 0) {
+                source->error = InflateError::TRUNCATED;
+                return -1;
+            }
+            stream->next_in = (Bytef *)data;
+            stream->avail_in = (uInt)count;
+        }
+
+        auto result = inflate(stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            source->is_done = true;
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            source->error = InflateError::CORRUPT;
+            return -1;
+        }
+    }
+
+    auto count = size - stream->avail_out;
+    source->total_in = stream->total_in;
+    source->total_out += count;
+    return (int64_t)count;
+}
+#endif
+
+int64_t
+inflate_pull(void *user, void *buffer, uint64_t size)
+{
+    auto source = (InflateSource *)user;
+    if (InflateError::NONE != source->error) {
+        return -1;
+    }
+    if (source->is_done) {
+        return 0;
+    }
+
+    size = std::min<uint64_t>(size, INFLATE_OUTPUT_CHUNK);
+    if (InflateMethod::STORED == source->method) {
+        return inflate_stored(source, (uint8_t *)buffer, size);
+    }
+#ifdef ASTRAEA_USE_ZLIB
+    return inflate_deflated(source, (uint8_t *)buffer, size);
+#else
+    source->error = InflateError::UNSUPPORTED;
+    return -1;
+#endif
+}
+
+void
+open_inflate_stream(StreamFile *file, InflateSource *source, uint64_t window)
+{
+    open_stream(file, inflate_pull, source, window);
+}
+
+bool
+inflate_method_of_zip(uint64_t compression_method, InflateMethod *out_method)
+{
+    switch (compression_method) {
+    case 0:
+        *out_method = InflateMethod::STORED;
+        return true;
+    case 8:
+        *out_method = InflateMethod::RAW_DEFLATE;
+        return true;
+    default:
+        return false;
+    }
+}
+
+}  // namespace binaryreader
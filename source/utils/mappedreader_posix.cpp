@@ -0,0 +1,67 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_POSIX
+#include "include/utils/mappedreader.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace binaryreader {
+
+static void
+unmap_buffer(SharedBuffer *buffer)
+{
+    munmap(buffer->data, (size_t)buffer->size);
+}
+
+bool
+map_file(MappedFile *file, Path file_path)
+{
+    *file = MappedFile{};
+
+    auto fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    file->size = (uint64_t)info.st_size;
+    if (file->size > 0) {
+        auto data = mmap(nullptr, (size_t)file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == data) {
+            close(fd);
+            *file = MappedFile{};
+            return false;
+        }
+        // Templates mostly walk the file front to back.
+        madvise(data, (size_t)file->size, MADV_SEQUENTIAL);
+        file->data = (const uint8_t *)data;
+        file->buffer = shared_buffer_adopt((uint8_t *)data, file->size, unmap_buffer, nullptr);
+    }
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    return true;
+}
+
+void
+unmap_file(MappedFile *file)
+{
+    shared_buffer_release(file->buffer);
+    *file = MappedFile{};
+}
+
+}  // namespace binaryreader
+#endif
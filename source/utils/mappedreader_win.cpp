@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_WINDOWS
+#include "include/utils/mappedreader.hpp"
+#include <windows.h>
+
+namespace binaryreader {
+
+static void
+unmap_buffer(SharedBuffer *buffer)
+{
+    UnmapViewOfFile(buffer->data);
+    CloseHandle((HANDLE)buffer->user);
+}
+
+bool
+map_file(MappedFile *file, Path file_path)
+{
+    *file = MappedFile{};
+
+    auto handle = CreateFileW(
+        file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (INVALID_HANDLE_VALUE == handle) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    file->size = (uint64_t)size.QuadPart;
+    if (file->size > 0) {
+        auto mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(handle);
+            *file = MappedFile{};
+            return false;
+        }
+
+        auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            CloseHandle(mapping);
+            CloseHandle(handle);
+            *file = MappedFile{};
+            return false;
+        }
+        file->data = (const uint8_t *)data;
+        file->buffer = shared_buffer_adopt((uint8_t *)data, file->size, unmap_buffer, mapping);
+    }
+
+    // The view keeps its own reference to the file.
+    CloseHandle(handle);
+    return true;
+}
+
+void
+unmap_file(MappedFile *file)
+{
+    shared_buffer_release(file->buffer);
+    *file = MappedFile{};
+}
+
+}  // namespace binaryreader
+#endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform_console.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace platform {
+
+struct ConsoleSink {
+    intptr_t handle;
+    bool has_color;
+    uint8_t *front;        // filled by writes.
+    uint64_t front_count;
+    uint8_t *back;         // written by the thread.
+    uint64_t queued;       // bytes queued since the sink was opened.
+    uint64_t written;      // bytes the thread is done with.
+    std::thread writer;
+    std::mutex write_mutex;  // held for a whole write, so it is not split by others while waiting for space.
+    std::mutex mutex;
+    std::condition_variable has_work;
+    std::condition_variable has_space;
+    std::condition_variable is_written;
+    bool is_urgent;        // the front buffer is full or a flush waits for it.
+    bool is_stopping;
+};
+
+static void
+console_sink_writer(ConsoleSink *sink)
+{
+    std::unique_lock<std::mutex> lock{sink->mutex};
+    for (;;) {
+        sink->has_work.wait(lock, [sink] { return sink->is_stopping || sink->front_count > 0; });
+        // Gives later lines a chance to join the batch.
+        sink->has_work.wait_for(lock, std::chrono::milliseconds(CONSOLE_FLUSH_INTERVAL_MS),
+                                [sink] { return sink->is_stopping || sink->is_urgent; });
+        if (sink->front_count == 0) {
+            if (sink->is_stopping) {
+                return;
+            }
+            continue;
+        }
+
+        auto count = sink->front_count;
+        std::swap(sink->front, sink->back);
+        sink->front_count = 0;
+        sink->is_urgent = false;
+        sink->has_space.notify_all();
+
+        lock.unlock();
+        console_write_all(sink->handle, sink->back, count);  // nothing to report a console failure to.
+        lock.lock();
+
+        sink->written += count;
+        sink->is_written.notify_all();
+    }
+}
+
+ConsoleSink *
+console_sink_open(ConsoleStream stream)
+{
+    auto sink = new ConsoleSink{};
+    sink->handle = console_handle(stream);
+    sink->has_color = console_enable_color(sink->handle);
+    sink->front = (uint8_t *)std::malloc(CONSOLE_BUFFER_SIZE);
+    sink->back = (uint8_t *)std::malloc(CONSOLE_BUFFER_SIZE);
+    if (!sink->front || !sink->back) {
+        std::exit(1);
+    }
+    sink->writer = std::thread{console_sink_writer, sink};
+
+    return sink;
+}
+
+void
+console_sink_close(ConsoleSink *sink)
+{
+    if (!sink) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{sink->mutex};
+        sink->is_stopping = true;
+    }
+    sink->has_work.notify_one();
+    sink->writer.join();
+
+    std::free(sink->front);
+    std::free(sink->back);
+    delete sink;
+}
+
+/*
+ * Copies _size_ bytes into the front buffer, waiting for the thread to take
+ * it when full. Must be called with the lock held.
+ */
+static void
+console_sink_append(ConsoleSink *sink, std::unique_lock<std::mutex> &lock, const uint8_t *data, uint64_t size)
+{
+    while (size > 0) {
+        auto space = CONSOLE_BUFFER_SIZE - sink->front_count;
+        auto fit = size;
+        if (fit > space) {
+            fit = space;
+            while (fit > 0 && (data[fit] & 0xC0) == 0x80) {
+                fit -= 1;
+            }
+            if (fit == 0 && sink->front_count == 0) {
+                fit = space;  // malformed text, a code point cannot be this long.
+            }
+        }
+
+        if (fit == 0) {
+            sink->is_urgent = true;
+            sink->has_work.notify_one();
+            sink->has_space.wait(lock, [sink] { return sink->front_count == 0; });
+            continue;
+        }
+
+        if (sink->front_count == 0) {
+            sink->has_work.notify_one();
+        }
+        std::memcpy(sink->front + sink->front_count, data, (size_t)fit);
+        sink->front_count += fit;
+        sink->queued += fit;
+        data += fit;
+        size -= fit;
+    }
+}
+
+/*
+ * Fills _out_sequence_ with the ANSI escape sequence of the console
+ * attribute _color_.
+ */
+static void
+console_color_sequence(uint32_t color, char (&out_sequence)[6])
+{
+    // Console attributes are blue, green, red bits, ANSI colors red, green, blue.
+    static const char ansi_digit[] = "04261537";
+    std::memcpy(out_sequence, "\033[30m", sizeof(out_sequence));
+    out_sequence[2] = (color & 8) ? '9' : '3';
+    out_sequence[3] = ansi_digit[color & 7];
+}
+
+uint64_t
+console_sink_write(ConsoleSink *sink, std::string_view str, uint32_t color)
+{
+    auto is_colored = sink->has_color && color != CONSOLE_NO_COLOR;
+
+    std::lock_guard<std::mutex> write_lock{sink->write_mutex};
+    std::unique_lock<std::mutex> lock{sink->mutex};
+    if (is_colored) {
+        char sequence[6];
+        console_color_sequence(color, sequence);
+        console_sink_append(sink, lock, (const uint8_t *)sequence, sizeof(sequence) - 1);
+    }
+    console_sink_append(sink, lock, (const uint8_t *)str.data(), str.size());
+    if (is_colored) {
+        console_sink_append(sink, lock, (const uint8_t *)"\033[0m", 4);
+    }
+
+    return str.size();
+}
+
+void
+console_sink_flush(ConsoleSink *sink)
+{
+    std::unique_lock<std::mutex> lock{sink->mutex};
+    auto queued = sink->queued;
+    if (sink->front_count > 0) {
+        sink->is_urgent = true;
+        sink->has_work.notify_one();
+    }
+    sink->is_written.wait(lock, [sink, queued] { return sink->written >= queued; });
+}
+
+bool
+console_sink_has_color(ConsoleSink *sink)
+{
+    return sink->has_color;
+}
+
+static std::atomic<ConsoleSink *> output_sink;
+
+static void
+close_console_output()
+{
+    console_sink_close(output_sink.exchange(nullptr));
+}
+
+ConsoleSink *
+console_output()
+{
+    static std::once_flag is_opened;
+    std::call_once(is_opened, [] {
+        output_sink = console_sink_open(ConsoleStream::STANDARD_OUTPUT);
+        std::atexit(close_console_output);
+    });
+    return output_sink.load();
+}
+
+uint64_t
+print(std::string_view str, uint32_t color)
+{
+    std::fflush(stdout);  // text printed with stdio before stays ahead of this.
+    auto sink = console_output();
+    if (!sink) {
+        // Printing from exit handlers that ran after the sink was closed.
+        console_write_all(console_handle(ConsoleStream::STANDARD_OUTPUT), (const uint8_t *)str.data(), str.size());
+        return str.size();
+    }
+    return console_sink_write(sink, str, color);
+}
+
+uint64_t
+print(std::string_view str)
+{
+    return print(str, 3);
+}
+
+uint64_t
+print_error(std::string_view str, uint32_t color)
+{
+    static auto handle = console_handle(ConsoleStream::STANDARD_ERROR);
+    static auto has_color = console_enable_color(handle);
+
+    // Everything printed before comes first when both streams share a terminal.
+    std::fflush(stdout);
+    std::fflush(stderr);
+    auto sink = output_sink.load();
+    if (sink) {
+        console_sink_flush(sink);
+    }
+
+    // One write, so errors from other threads are not interleaved with it.
+    auto text = std::string{};
+    if (has_color && color != CONSOLE_NO_COLOR) {
+        char sequence[6];
+        console_color_sequence(color, sequence);
+        text += sequence;
+        text += str;
+        text += "\033[0m";
+        str = text;
+    }
+    console_write_all(handle, (const uint8_t *)str.data(), str.size());
+    return str.size();
+}
+
+uint64_t
+print_error(std::string_view str)
+{
+    return print_error(str, 12);
+}
+
+}  // namespace platform
@@ -1,42 +1,49 @@
 #include "include/utils/platform.hpp"
 #ifdef OS_POSIX
 #include "include/utils/platform_console.hpp"
-#include "include/utils/platform_string.hpp"
-#include <iostream>
-#include <string_view>
-
-//the following are UBUNTU/LINUX, and MacOS ONLY terminal color codes.
-#define RESET       "\033[0m"              /* Default */
-#define BLACK       "\033[30m"             /* Black */
-#define RED         "\033[31m"             /* Red */
-#define GREEN       "\033[32m"             /* Green */
-#define YELLOW      "\033[33m"             /* Yellow */
-#define BLUE        "\033[34m"             /* Blue */
-#define MAGENTA     "\033[35m"             /* Magenta */
-#define CYAN        "\033[36m"             /* Cyan */
-#define WHITE       "\033[37m"             /* White */
-#define BOLDBLACK   "\033[1m\033[30m"      /* Bold Black */
-#define BOLDRED     "\033[1m\033[31m"      /* Bold Red */
-#define BOLDGREEN   "\033[1m\033[32m"      /* Bold Green */
-#define BOLDYELLOW  "\033[1m\033[33m"      /* Bold Yellow */
-#define BOLDBLUE    "\033[1m\033[34m"      /* Bold Blue */
-#define BOLDMAGENTA "\033[1m\033[35m"      /* Bold Magenta */
-#define BOLDCYAN    "\033[1m\033[36m"      /* Bold Cyan */
-#define BOLDWHITE   "\033[1m\033[37m"      /* Bold White */
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
 
 namespace platform {
 
-uint64_t
-print(std::string_view str, uint32_t color_code)
+intptr_t
+console_handle(ConsoleStream stream)
 {
-    std::cout << BLUE << str << RESET << std::endl;
-    return 0;
+    return stream == ConsoleStream::STANDARD_ERROR ? STDERR_FILENO : STDOUT_FILENO;
+}
+
+bool
+console_enable_color(intptr_t handle)
+{
+    if (!isatty((int)handle)) {
+        return false;
+    }
+
+    auto no_color = std::getenv("NO_COLOR");
+    if (no_color && no_color[0] != '\0') {
+        return false;
+    }
+    auto term = std::getenv("TERM");
+    return term && std::strcmp(term, "dumb") != 0;
 }
 
-uint64_t
-print(std::string_view str)
+bool
+console_write_all(intptr_t handle, const uint8_t *data, uint64_t size)
 {
-    return print(str, 3);
+    while (size > 0) {
+        auto count = write((int)handle, data, (size_t)size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        size -= (uint64_t)count;
+    }
+    return true;
 }
 
 }  // namespace platform
@@ -1,46 +1,79 @@
 #include "include/utils/platform.hpp"
 #ifdef OS_WINDOWS
 #include "include/utils/platform_console.hpp"
-#include "include/utils/platform_string.hpp"
+#include <cstdlib>
 #include <windows.h>
 
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
 namespace platform {
 
-uint64_t
-print(std::string_view str, uint32_t color)
+intptr_t
+console_handle(ConsoleStream stream)
 {
-    uint64_t count;
-    std::wstring output = platform::utf8_to_winapi(str);
-    void *console = GetStdHandle(STD_OUTPUT_HANDLE);
-    auto csbi = CONSOLE_SCREEN_BUFFER_INFO{};
-    GetConsoleScreenBufferInfo(console, &csbi);
-
-    SetConsoleTextAttribute(console, color);
-    WriteConsoleW(console, output.c_str(), output.size(), (LPDWORD)&count, 0);
-    SetConsoleTextAttribute(console, csbi.wAttributes);
-
-    return count;
+    auto id = stream == ConsoleStream::STANDARD_ERROR ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE;
+    return (intptr_t)GetStdHandle(id);
 }
 
-uint64_t
-print(std::string_view str)
+bool
+console_enable_color(intptr_t handle)
 {
-    return print(str, 3);
+    DWORD mode = 0;
+    if (!GetConsoleMode((HANDLE)handle, &mode)) {
+        return false;
+    }
+
+    auto no_color = std::getenv("NO_COLOR");
+    if (no_color && no_color[0] != '\0') {
+        return false;
+    }
+    return SetConsoleMode((HANDLE)handle, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
 }
 
-uint64_t
-print_rainbow(std::string_view str)
+bool
+console_write_all(intptr_t handle, const uint8_t *data, uint64_t size)
 {
-    uint64_t count;
-    void *console = GetStdHandle(STD_OUTPUT_HANDLE);
-    // you can loop k till 255 to see more color choices
-    std::wstring output = L" I want to be nice today!";
-    for (int color_attr = 1; color_attr < 15; color_attr += 1) {
-        SetConsoleTextAttribute(console, color_attr);
-        WriteConsoleW(console, output.c_str(), output.size(), (LPDWORD)&count, 0);
-        WriteConsoleW(console, "\n", 1, (LPDWORD)&count, 0);
+    DWORD mode = 0;
+    if (!GetConsoleMode((HANDLE)handle, &mode)) {
+        // Redirected to a file or a pipe, the UTF-8 is written as it is.
+        while (size > 0) {
+            DWORD count = 0;
+            auto chunk = (DWORD)(size < 0x40000000 ? size : 0x40000000);
+            if (!WriteFile((HANDLE)handle, data, chunk, &count, nullptr)) {
+                return false;
+            }
+            data += count;
+            size -= count;
+        }
+        return true;
     }
-    return count;
+
+    // Consoles take UTF-16, the whole batch is converted at once.
+    auto wide_count = MultiByteToWideChar(CP_UTF8, 0, (LPCCH)data, (int)size, nullptr, 0);
+    if (wide_count <= 0) {
+        return size == 0;
+    }
+    auto wide = (wchar_t *)std::malloc(sizeof(wchar_t) * (size_t)wide_count);
+    if (!wide) {
+        std::exit(1);
+    }
+    MultiByteToWideChar(CP_UTF8, 0, (LPCCH)data, (int)size, wide, wide_count);
+
+    auto is_written = true;
+    for (auto pos = 0; pos < wide_count;) {
+        DWORD count = 0;
+        if (!WriteConsoleW((HANDLE)handle, wide + pos, (DWORD)(wide_count - pos), &count, nullptr) || count == 0) {
+            is_written = false;
+            break;
+        }
+        pos += (int)count;
+    }
+    std::free(wide);
+
+    return is_written;
 }
+
 }  // namespace platform
 #endif
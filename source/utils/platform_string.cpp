@@ -6,51 +6,208 @@
  * found in the LICENSE file in the root directory of this source tree.
  */
 #include "include/utils/platform_string.hpp"
-#include <cstring>
+#include "include/utils/cpu.hpp"
+#include <algorithm>
+#include <bit>
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
 
 namespace platform {
 
+static inline bool
+is_lead_byte(uint8_t byte)
+{
+    return (byte & 0xC0) != 0x80;
+}
+
 uint32_t
 utf8_cp_size(std::string_view str)
 {
-    int32_t ch, i = 0, q = 0;
-    for (; i < 4; i += 1) {
-        ch = (unsigned char)str[i];
-        if (ch >= 0 && ch <= 127) {
-            return 1;
-        } else if ((ch & 0xE0) == 0xC0) {
-            return 2;
-        } else if ((ch & 0xF0) == 0xE0) {
-            return 3;
-        } else if ((ch & 0xF8) == 0xF0) {
-            return 4;
-        } else {
-            return 0;  // invalid utf8
+    if (str.empty()) {
+        return 0;
+    }
+
+    auto ch = (uint8_t)str[0];
+    if (ch < 0x80) {
+        return 1;
+    } else if ((ch & 0xE0) == 0xC0) {
+        return 2;
+    } else if ((ch & 0xF0) == 0xE0) {
+        return 3;
+    } else if ((ch & 0xF8) == 0xF0) {
+        return 4;
+    }
+    return 0;  // invalid utf8
+}
+
+static uint64_t
+count_leads_scalar(const uint8_t *data, uint64_t size)
+{
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < size; i += 1) {
+        count += is_lead_byte(data[i]);
+    }
+    return count;
+}
+
+#ifdef ARCH_X86
+
+/*
+ * Lead bytes are the ones greater than 0xBF as signed bytes, each compare
+ * subtracts -1 from a byte counter. The counters are summed before they can
+ * wrap, every 255 blocks.
+ */
+ASTRAEA_TARGET("avx2")
+static uint64_t
+count_leads_avx2(const uint8_t *data, uint64_t size, uint64_t *out_count)
+{
+    uint64_t pos = 0;
+    uint64_t count = 0;
+    auto last_continuation = _mm256_set1_epi8((char)0xBF);
+    while (pos + 32 <= size) {
+        auto counters = _mm256_setzero_si256();
+        for (uint32_t i = 0; i < 255 && pos + 32 <= size; i += 1, pos += 32) {
+            auto bytes = _mm256_loadu_si256((const __m256i *)(data + pos));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpgt_epi8(bytes, last_continuation));
         }
+        alignas(32) uint64_t sums[4];
+        _mm256_store_si256((__m256i *)sums, _mm256_sad_epu8(counters, _mm256_setzero_si256()));
+        count += sums[0] + sums[1] + sums[2] + sums[3];
     }
-    return -1;
+
+    *out_count = count;
+    return pos;
 }
 
-int32_t
-utf8_string_lenght(const char *str)
+ASTRAEA_TARGET("sse2")
+static uint64_t
+count_leads_sse2(const uint8_t *data, uint64_t size, uint64_t *out_count)
 {
-    int32_t c, i, ix, q;
-    for (q = 0, i = 0, ix = (int32_t)strlen(reinterpret_cast<const char *>(str)); i < ix;
-         i++, q++) {
-        c = (unsigned char)str[i];
-        if (c >= 0 && c <= 127)
-            i += 0;
-        else if ((c & 0xE0) == 0xC0)
-            i += 1;
-        else if ((c & 0xF0) == 0xE0)
-            i += 2;
-        else if ((c & 0xF8) == 0xF0)
-            i += 3;
-        // else if (($c & 0xFC) == 0xF8) i+=4; // 111110bb //byte 5, unnecessary in 4 byte UTF-8
-        // else if (($c & 0xFE) == 0xFC) i+=5; // 1111110b //byte 6, unnecessary in 4 byte UTF-8
-        else
-            return 0;  // invalid utf8
+    uint64_t pos = 0;
+    uint64_t count = 0;
+    auto last_continuation = _mm_set1_epi8((char)0xBF);
+    while (pos + 16 <= size) {
+        auto counters = _mm_setzero_si128();
+        for (uint32_t i = 0; i < 255 && pos + 16 <= size; i += 1, pos += 16) {
+            auto bytes = _mm_loadu_si128((const __m128i *)(data + pos));
+            counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(bytes, last_continuation));
+        }
+        alignas(16) uint64_t sums[2];
+        _mm_store_si128((__m128i *)sums, _mm_sad_epu8(counters, _mm_setzero_si128()));
+        count += sums[0] + sums[1];
     }
-    return q;
+
+    *out_count = count;
+    return pos;
 }
+
+/*
+ * Marks the lead bytes of 16 byte blocks, the next entry of the index is
+ * found in the mask of the block holding it. Returns the bytes done.
+ */
+ASTRAEA_TARGET("sse2")
+static uint64_t
+index_blocks_sse2(Utf8Index *index, const uint8_t *data, uint64_t size, uint64_t *r_count)
+{
+    static_assert(UTF8_INDEX_STRIDE >= 16, "a block must hold at most one index entry");
+
+    uint64_t pos = 0;
+    uint64_t count = *r_count;
+    uint64_t mark = index->offsets.count * UTF8_INDEX_STRIDE;
+    auto last_continuation = _mm_set1_epi8((char)0xBF);
+    for (; pos + 16 <= size; pos += 16) {
+        auto bytes = _mm_loadu_si128((const __m128i *)(data + pos));
+        auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, last_continuation));
+        auto leads = (uint64_t)std::popcount(mask);
+        if (count + leads > mark) {
+            for (auto skip = mark - count; skip > 0; skip -= 1) {
+                mask &= mask - 1;
+            }
+            index->offsets.push(pos + std::countr_zero(mask));
+            mark += UTF8_INDEX_STRIDE;
+        }
+        count += leads;
+    }
+
+    *r_count = count;
+    return pos;
+}
+
+#endif
+
+uint64_t
+utf8_string_lenght(std::string_view str)
+{
+    auto data = (const uint8_t *)str.data();
+    uint64_t size = str.size();
+    uint64_t pos = 0;
+    uint64_t count = 0;
+#ifdef ARCH_X86
+    if (cpu_has(CPU_AVX2)) {
+        pos = count_leads_avx2(data, size, &count);
+    } else if (cpu_has(CPU_SSE2)) {
+        pos = count_leads_sse2(data, size, &count);
+    }
+#endif
+    return count + count_leads_scalar(data + pos, size - pos);
+}
+
+void
+utf8_index_build(Utf8Index *index, std::string_view text)
+{
+    auto data = (const uint8_t *)text.data();
+    uint64_t size = text.size();
+    uint64_t pos = 0;
+    uint64_t count = 0;
+
+    index->text = text;
+    index->offsets.clear();
+#ifdef ARCH_X86
+    if (cpu_has(CPU_SSE2)) {
+        pos = index_blocks_sse2(index, data, size, &count);
+    }
+#endif
+    for (; pos < size; pos += 1) {
+        if (!is_lead_byte(data[pos])) {
+            continue;
+        }
+        if (count % UTF8_INDEX_STRIDE == 0) {
+            index->offsets.push(pos);
+        }
+        count += 1;
+    }
+    index->lenght = count;
+}
+
+uint64_t
+utf8_index_offset(const Utf8Index &index, uint64_t code_point)
+{
+    auto data = (const uint8_t *)index.text.data();
+    uint64_t size = index.text.size();
+    if (code_point >= index.lenght) {
+        return size;
+    }
+
+    auto pos = index.offsets[code_point / UTF8_INDEX_STRIDE];
+    for (auto left = code_point % UTF8_INDEX_STRIDE; left > 0; left -= 1) {
+        pos += 1;
+        while (pos < size && !is_lead_byte(data[pos])) {
+            pos += 1;
+        }
+    }
+    return pos;
+}
+
+std::string_view
+utf8_index_substr(const Utf8Index &index, uint64_t first, uint64_t count)
+{
+    auto begin = utf8_index_offset(index, first);
+    auto end = count < index.lenght - std::min(first, index.lenght)
+        ? utf8_index_offset(index, first + count)
+        : index.text.size();
+    return index.text.substr((size_t)begin, (size_t)(end - begin));
+}
+
 }  // namespace platform
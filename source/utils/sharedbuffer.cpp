@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/sharedbuffer.hpp"
+#include "include/utils/array.hpp"
+#include <new>
+
+// The bytes of created buffers start this far after the header, aligned like Array storage.
+#define SHARED_BUFFER_HEADER ((sizeof(SharedBuffer) + ARRAY_ALIGNMENT - 1) & ~(size_t)(ARRAY_ALIGNMENT - 1))
+
+SharedBuffer *
+shared_buffer_create(uint64_t size)
+{
+    uint64_t byte_size = 0;
+    if (!checked_add<uint64_t>(size, SHARED_BUFFER_HEADER, &byte_size)) {
+        std::exit(1);
+    }
+
+    auto memory = (uint8_t *)array_allocate(byte_size, ARRAY_ALIGNMENT);
+    auto buffer = new (memory) SharedBuffer{};
+    buffer->ref_count.store(1, std::memory_order_relaxed);
+    buffer->data = memory + SHARED_BUFFER_HEADER;
+    buffer->size = size;
+
+    return buffer;
+}
+
+SharedBuffer *
+shared_buffer_adopt(uint8_t *data, uint64_t size, SharedBufferDestroy destroy, void *user)
+{
+    auto memory = array_allocate(sizeof(SharedBuffer), ARRAY_ALIGNMENT);
+    auto buffer = new (memory) SharedBuffer{};
+    buffer->ref_count.store(1, std::memory_order_relaxed);
+    buffer->data = data;
+    buffer->size = size;
+    buffer->destroy = destroy;
+    buffer->user = user;
+
+    return buffer;
+}
+
+void
+shared_buffer_release(SharedBuffer *buffer)
+{
+    if (!buffer || buffer->ref_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    if (buffer->destroy) {
+        buffer->destroy(buffer);
+    }
+    buffer->~SharedBuffer();
+    array_deallocate(buffer);
+}
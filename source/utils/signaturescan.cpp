@@ -0,0 +1,180 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/signaturescan.hpp"
+#include "include/utils/cpu.hpp"
+#include <bit>
+#include <cstring>
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace binaryreader {
+
+bool
+signature_set_add(SignatureSet *set, const void *bytes, uint32_t size)
+{
+    if (size < SIGNATURE_MIN_SIZE || size > SIGNATURE_MAX_SIZE || set->count == SIGNATURE_SET_MAX) {
+        return false;
+    }
+
+    auto arm = set->count;
+    set->values[arm] = 0;
+    set->masks[arm] = 0;
+    std::memcpy(&set->values[arm], bytes, size);
+    std::memset(&set->masks[arm], 0xFF, size);
+    set->sizes[arm] = (uint8_t)size;
+    set->count += 1;
+    set->max_size = set->max_size > size ? set->max_size : size;
+
+    auto first = ((const uint8_t *)bytes)[0];
+    auto second = ((const uint8_t *)bytes)[1];
+    for (uint32_t i = 0; i < set->prefix_count; i += 1) {
+        if (set->prefixes[i][0] == first && set->prefixes[i][1] == second) {
+            return true;  // arms sharing a prefix, like PK\3\4 and PK\1\2, share the compare.
+        }
+    }
+    set->prefixes[set->prefix_count][0] = first;
+    set->prefixes[set->prefix_count][1] = second;
+    set->prefix_count += 1;
+
+    return true;
+}
+
+/*
+ * Confirms a prefilter candidate at _offset_ against every arm.
+ */
+static bool
+match_at(const SignatureSet *set, const uint8_t *data, uint64_t size, uint64_t offset, SignatureMatch *out_match)
+{
+    auto left = size - offset;
+    uint64_t word = 0;
+    std::memcpy(&word, data + offset, left < 8 ? (size_t)left : 8);
+
+    for (uint32_t arm = 0; arm < set->count; arm += 1) {
+        if (set->sizes[arm] <= left && (word & set->masks[arm]) == set->values[arm]) {
+            out_match->offset = offset;
+            out_match->arm = arm;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef ARCH_X86
+/*
+ * Checks 32 offsets per iteration, _io_offset_ is left where it stopped.
+ */
+ASTRAEA_TARGET("avx2")
+static bool
+scan_avx2(const SignatureSet *set, const uint8_t *data, uint64_t size, uint64_t *io_offset, SignatureMatch *out_match)
+{
+    __m256i firsts[SIGNATURE_SET_MAX];
+    __m256i seconds[SIGNATURE_SET_MAX];
+    for (uint32_t p = 0; p < set->prefix_count; p += 1) {
+        firsts[p] = _mm256_set1_epi8((char)set->prefixes[p][0]);
+        seconds[p] = _mm256_set1_epi8((char)set->prefixes[p][1]);
+    }
+
+    auto i = *io_offset;
+    for (; i + 33 <= size; i += 32) {
+        auto a = _mm256_loadu_si256((const __m256i *)(data + i));
+        auto b = _mm256_loadu_si256((const __m256i *)(data + i + 1));
+        auto hits = _mm256_setzero_si256();
+        for (uint32_t p = 0; p < set->prefix_count; p += 1) {
+            auto both = _mm256_and_si256(_mm256_cmpeq_epi8(a, firsts[p]), _mm256_cmpeq_epi8(b, seconds[p]));
+            hits = _mm256_or_si256(hits, both);
+        }
+
+        auto mask = (uint32_t)_mm256_movemask_epi8(hits);
+        while (mask) {
+            if (match_at(set, data, size, i + std::countr_zero(mask), out_match)) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    *io_offset = i;
+    return false;
+}
+
+/*
+ * Checks 16 offsets per iteration, SSE2 is part of x86-64.
+ */
+static bool
+scan_sse2(const SignatureSet *set, const uint8_t *data, uint64_t size, uint64_t *io_offset, SignatureMatch *out_match)
+{
+    __m128i firsts[SIGNATURE_SET_MAX];
+    __m128i seconds[SIGNATURE_SET_MAX];
+    for (uint32_t p = 0; p < set->prefix_count; p += 1) {
+        firsts[p] = _mm_set1_epi8((char)set->prefixes[p][0]);
+        seconds[p] = _mm_set1_epi8((char)set->prefixes[p][1]);
+    }
+
+    auto i = *io_offset;
+    for (; i + 17 <= size; i += 16) {
+        auto a = _mm_loadu_si128((const __m128i *)(data + i));
+        auto b = _mm_loadu_si128((const __m128i *)(data + i + 1));
+        auto hits = _mm_setzero_si128();
+        for (uint32_t p = 0; p < set->prefix_count; p += 1) {
+            auto both = _mm_and_si128(_mm_cmpeq_epi8(a, firsts[p]), _mm_cmpeq_epi8(b, seconds[p]));
+            hits = _mm_or_si128(hits, both);
+        }
+
+        auto mask = (uint32_t)_mm_movemask_epi8(hits);
+        while (mask) {
+            if (match_at(set, data, size, i + std::countr_zero(mask), out_match)) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    *io_offset = i;
+    return false;
+}
+#endif
+
+bool
+scan_signatures(const SignatureSet *set, const uint8_t *data, uint64_t size, uint64_t from, SignatureMatch *out_match)
+{
+    if (set->count == 0) {
+        return false;
+    }
+
+    auto i = from;
+#ifdef ARCH_X86
+    if (platform::cpu_has(platform::CPU_AVX2)) {
+        if (scan_avx2(set, data, size, &i, out_match)) {
+            return true;
+        }
+    }
+    if (platform::cpu_has(platform::CPU_SSE2)) {
+        if (scan_sse2(set, data, size, &i, out_match)) {
+            return true;
+        }
+    }
+#endif
+
+    for (; i + 1 < size; i += 1) {
+        for (uint32_t p = 0; p < set->prefix_count; p += 1) {
+            if (data[i] == set->prefixes[p][0] && data[i + 1] == set->prefixes[p][1]) {
+                if (match_at(set, data, size, i, out_match)) {
+                    return true;
+                }
+                break;
+            }
+        }
+    }
+
+    return false;
+}
+
+}  // namespace binaryreader
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/streamreader.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace binaryreader {
+
+void
+open_stream(StreamFile *file, StreamPull pull, void *user, uint64_t window)
+{
+    uint64_t capacity = 4096;
+    while (capacity < window) {
+        capacity *= 2;
+    }
+
+    *file = StreamFile{};
+    file->pull = pull;
+    file->user = user;
+    file->handle = -1;
+    file->capacity = capacity;
+    file->ring = (uint8_t *)std::malloc((size_t)capacity);
+    if (!file->ring) {
+        std::exit(1);
+    }
+}
+
+void
+close_stream(StreamFile *file)
+{
+    std::free(file->ring);
+    *file = StreamFile{};
+    file->handle = -1;
+}
+
+std::string
+stream_error_message(const StreamFile &file)
+{
+    switch (file.error) {
+    case StreamError::NONE:
+        return "";
+    case StreamError::SEEK_BEFORE_WINDOW:
+    {
+        auto message = std::string{"seek to "};
+        message += std::to_string(file.error_offset);
+        message += " is before the stream window (";
+        message += std::to_string(file.begin) + " to " + std::to_string(file.end);
+        message += "), the window keeps the last " + std::to_string(file.capacity) + " bytes";
+        return message;
+    }
+    case StreamError::READ_FAILED:
+        return "reading the stream failed at " + std::to_string(file.error_offset);
+    }
+
+    return "";
+}
+
+/*
+ * Appends the next bytes of the input to the window, dropping the oldest
+ * ones but never the ones from _keep_ on. Returns false at the end of the
+ * input or on errors.
+ */
+static bool
+stream_pull(StreamFile &file, uint64_t keep)
+{
+    if (file.is_eof || StreamError::NONE != file.error) {
+        return false;
+    }
+
+    auto ring_end = file.end & (file.capacity - 1);
+    auto room = file.capacity - (file.end - std::min(keep, file.end));
+    auto count = file.pull(file.user, file.ring + ring_end, std::min(room, file.capacity - ring_end));
+    if (count < 0) {
+        file.error = StreamError::READ_FAILED;
+        file.error_offset = file.end;
+        return false;
+    }
+    if (count == 0) {
+        file.is_eof = true;
+        return false;
+    }
+
+    file.end += (uint64_t)count;
+    file.begin = std::max(file.begin, file.end > file.capacity ? file.end - file.capacity : 0);
+    return true;
+}
+
+bool
+stream_read_slow(StreamFile &file, void *r_data, uint64_t size)
+{
+    if (StreamError::NONE != file.error) {
+        return false;
+    }
+    if (file.pos < file.begin) {
+        file.error = StreamError::SEEK_BEFORE_WINDOW;
+        file.error_offset = file.pos;
+        return false;
+    }
+
+    // Reads bigger than the window go through it piece by piece, each pull
+    // only overwrites bytes already copied. Smaller ones keep the whole range
+    // in the window, so a peek can be read again after it.
+    auto out = (uint8_t *)r_data;
+    uint64_t done = 0;
+    while (done < size) {
+        auto offset = file.pos + done;
+        if (offset >= file.end) {
+            if (!stream_pull(file, size <= file.capacity ? file.pos : offset)) {
+                return false;
+            }
+            continue;
+        }
+
+        auto ring_pos = offset & (file.capacity - 1);
+        auto count = std::min({file.end - offset, size - done, file.capacity - ring_pos});
+        std::memcpy(out + done, file.ring + ring_pos, (size_t)count);
+        done += count;
+    }
+
+    file.pos += size;
+    return true;
+}
+
+}  // namespace binaryreader
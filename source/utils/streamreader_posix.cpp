@@ -0,0 +1,37 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_POSIX
+#include "include/utils/streamreader.hpp"
+#include <cerrno>
+#include <unistd.h>
+
+namespace binaryreader {
+
+static int64_t
+read_handle(void *user, void *buffer, uint64_t size)
+{
+    auto file = (StreamFile *)user;
+    for (;;) {
+        auto count = ::read((int)file->handle, buffer, (size_t)size);
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+        return (int64_t)count;
+    }
+}
+
+void
+open_stream_handle(StreamFile *file, intptr_t handle, uint64_t window)
+{
+    open_stream(file, &read_handle, file, window);
+    file->handle = handle;
+}
+
+}  // namespace binaryreader
+#endif
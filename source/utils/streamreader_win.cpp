@@ -0,0 +1,38 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/platform.hpp"
+#ifdef OS_WINDOWS
+#include "include/utils/streamreader.hpp"
+#include <algorithm>
+#include <windows.h>
+
+namespace binaryreader {
+
+static int64_t
+read_handle(void *user, void *buffer, uint64_t size)
+{
+    auto file = (StreamFile *)user;
+    DWORD count = 0;
+    auto request = (DWORD)std::min<uint64_t>(size, 0x40000000);
+    if (!ReadFile((HANDLE)file->handle, buffer, request, &count, nullptr)) {
+        // The writer closing its end of a pipe is the end of the input.
+        return ERROR_BROKEN_PIPE == GetLastError() ? 0 : -1;
+    }
+
+    return (int64_t)count;
+}
+
+void
+open_stream_handle(StreamFile *file, intptr_t handle, uint64_t window)
+{
+    open_stream(file, &read_handle, file, window);
+    file->handle = handle;
+}
+
+}  // namespace binaryreader
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/threadpool.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace platform {
+
+struct Task {
+    TaskFunction function;
+    void *argument;
+};
+
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    std::mutex mutex;
+    std::condition_variable has_task;
+    std::condition_variable is_idle;
+    uint64_t pending;  // queued plus running tasks.
+    bool is_stopping;
+};
+
+static void
+thread_pool_worker(ThreadPool *pool)
+{
+    std::unique_lock<std::mutex> lock{pool->mutex};
+    for (;;) {
+        pool->has_task.wait(lock, [pool] { return pool->is_stopping || !pool->tasks.empty(); });
+        if (pool->tasks.empty()) {
+            return;  // stopping and drained.
+        }
+
+        auto task = pool->tasks.front();
+        pool->tasks.pop_front();
+        lock.unlock();
+        task.function(task.argument);
+        lock.lock();
+
+        pool->pending -= 1;
+        if (pool->pending == 0) {
+            pool->is_idle.notify_all();
+        }
+    }
+}
+
+ThreadPool *
+thread_pool_create(uint32_t thread_count)
+{
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto pool = new ThreadPool{};
+    pool->workers.reserve(thread_count);
+    for (uint32_t i = 0; i < thread_count; i += 1) {
+        pool->workers.emplace_back(thread_pool_worker, pool);
+    }
+
+    return pool;
+}
+
+void
+thread_pool_destroy(ThreadPool *pool)
+{
+    {
+        std::lock_guard<std::mutex> lock{pool->mutex};
+        pool->is_stopping = true;
+    }
+    pool->has_task.notify_all();
+    for (auto &worker : pool->workers) {
+        worker.join();
+    }
+    delete pool;
+}
+
+void
+thread_pool_submit(ThreadPool *pool, TaskFunction function, void *argument)
+{
+    {
+        std::lock_guard<std::mutex> lock{pool->mutex};
+        pool->tasks.push_back(Task{function, argument});
+        pool->pending += 1;
+    }
+    pool->has_task.notify_one();
+}
+
+void
+thread_pool_wait(ThreadPool *pool)
+{
+    std::unique_lock<std::mutex> lock{pool->mutex};
+    pool->is_idle.wait(lock, [pool] { return pool->pending == 0; });
+}
+
+uint32_t
+thread_pool_size(ThreadPool *pool)
+{
+    return (uint32_t)pool->workers.size();
+}
+
+}  // namespace platform
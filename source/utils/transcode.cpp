@@ -0,0 +1,691 @@
+/*
+ * Copyright 2020 Krayfaus
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license that can be
+ * found in the LICENSE file in the root directory of this source tree.
+ */
+#include "include/utils/transcode.hpp"
+#include "include/utils/cpu.hpp"
+#include <cstring>
+
+#ifdef ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace platform {
+
+static bool
+equals_ignore_case(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i += 1) {
+        auto ch = a[i] >= 'A' && a[i] <= 'Z' ? (char)(a[i] - 'A' + 'a') : a[i];
+        if (ch != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+text_encoding_parse(std::string_view name, TextEncoding *out_encoding)
+{
+    static const struct {
+        std::string_view name;
+        TextEncoding encoding;
+    } names[] = {
+        {"ascii", TextEncoding::ASCII},       {"us-ascii", TextEncoding::ASCII},
+        {"latin1", TextEncoding::LATIN1},     {"latin-1", TextEncoding::LATIN1},
+        {"iso-8859-1", TextEncoding::LATIN1}, {"utf8", TextEncoding::UTF8},
+        {"utf-8", TextEncoding::UTF8},        {"utf16", TextEncoding::UTF16LE},
+        {"utf-16", TextEncoding::UTF16LE},    {"utf16le", TextEncoding::UTF16LE},
+        {"utf-16le", TextEncoding::UTF16LE},  {"utf16be", TextEncoding::UTF16BE},
+        {"utf-16be", TextEncoding::UTF16BE},  {"utf32", TextEncoding::UTF32LE},
+        {"utf-32", TextEncoding::UTF32LE},    {"utf32le", TextEncoding::UTF32LE},
+        {"utf-32le", TextEncoding::UTF32LE},  {"utf32be", TextEncoding::UTF32BE},
+        {"utf-32be", TextEncoding::UTF32BE},
+    };
+
+    for (auto &entry : names) {
+        if (equals_ignore_case(name, entry.name)) {
+            *out_encoding = entry.encoding;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t
+text_encoding_unit_size(TextEncoding encoding)
+{
+    switch (encoding) {
+    case TextEncoding::UTF16LE:
+    case TextEncoding::UTF16BE:
+        return 2;
+    case TextEncoding::UTF32LE:
+    case TextEncoding::UTF32BE:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+Endian
+text_encoding_endian(TextEncoding encoding)
+{
+    switch (encoding) {
+    case TextEncoding::UTF16LE:
+    case TextEncoding::UTF32LE:
+        return Endian::little;
+    case TextEncoding::UTF16BE:
+    case TextEncoding::UTF32BE:
+        return Endian::big;
+    default:
+        return Endian::native;
+    }
+}
+
+uint64_t
+utf8_capacity(TextEncoding encoding, uint64_t size)
+{
+    switch (encoding) {
+    case TextEncoding::LATIN1:
+        return size * 2;
+    case TextEncoding::UTF16LE:
+    case TextEncoding::UTF16BE:
+        return size / 2 * 3;  // 3 bytes per unit outside of the ASCII, a pair takes 4.
+    default:
+        return size;
+    }
+}
+
+static uint8_t *
+utf8_put(uint8_t *out, uint32_t code_point)
+{
+    if (code_point < 0x80) {
+        *out++ = (uint8_t)code_point;
+    } else if (code_point < 0x800) {
+        *out++ = (uint8_t)(0xC0 | code_point >> 6);
+        *out++ = (uint8_t)(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        *out++ = (uint8_t)(0xE0 | code_point >> 12);
+        *out++ = (uint8_t)(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = (uint8_t)(0x80 | (code_point & 0x3F));
+    } else {
+        *out++ = (uint8_t)(0xF0 | code_point >> 18);
+        *out++ = (uint8_t)(0x80 | ((code_point >> 12) & 0x3F));
+        *out++ = (uint8_t)(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = (uint8_t)(0x80 | (code_point & 0x3F));
+    }
+    return out;
+}
+
+/*
+ * Decodes the UTF-8 sequence at _src_, returns its size, 0 if it is not well
+ * formed or cut by the end of the _size_ bytes.
+ */
+static uint32_t
+utf8_get(const uint8_t *src, uint64_t size, uint32_t *out_code_point)
+{
+    uint32_t code_point = src[0];
+    uint32_t length = 1;
+    uint32_t min = 0;
+    if (code_point < 0x80) {
+        *out_code_point = code_point;
+        return 1;
+    } else if ((code_point & 0xE0) == 0xC0) {
+        length = 2, code_point &= 0x1F, min = 0x80;
+    } else if ((code_point & 0xF0) == 0xE0) {
+        length = 3, code_point &= 0x0F, min = 0x800;
+    } else if ((code_point & 0xF8) == 0xF0) {
+        length = 4, code_point &= 0x07, min = 0x10000;
+    } else {
+        return 0;
+    }
+    if (size < length) {
+        return 0;
+    }
+
+    for (uint32_t i = 1; i < length; i += 1) {
+        if ((src[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+        code_point = code_point << 6 | (src[i] & 0x3F);
+    }
+    if (code_point < min || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        return 0;
+    }
+
+    *out_code_point = code_point;
+    return length;
+}
+
+static bool
+utf8_validate_scalar(const uint8_t *data, uint64_t size)
+{
+    uint32_t code_point = 0;
+    for (uint64_t pos = 0; pos < size;) {
+        auto length = utf8_get(data + pos, size - pos, &code_point);
+        if (!length) {
+            return false;
+        }
+        pos += length;
+    }
+    return true;
+}
+
+/*
+ * Converts the UTF-16 units from _*io_pos_ till _stop_, a surrogate pair may
+ * end past _stop_ but not past the _units_ in _src_.
+ */
+static bool
+utf16_scalar(const uint8_t *src, uint64_t units, Endian endian, uint64_t stop, uint64_t *io_pos, uint8_t **io_out)
+{
+    auto pos = *io_pos;
+    auto out = *io_out;
+    auto is_valid = true;
+    while (pos < stop) {
+        auto unit = (uint32_t)load_unsigned(src + pos * 2, 2, endian);
+        if (unit >= 0xD800 && unit <= 0xDFFF) {
+            auto trail = unit <= 0xDBFF && pos + 1 < units ? (uint32_t)load_unsigned(src + pos * 2 + 2, 2, endian) : 0;
+            if (trail < 0xDC00 || trail > 0xDFFF) {
+                is_valid = false;
+                break;
+            }
+            unit = 0x10000 + ((unit - 0xD800) << 10) + (trail - 0xDC00);
+            pos += 1;
+        }
+        out = utf8_put(out, unit);
+        pos += 1;
+    }
+
+    *io_pos = pos;
+    *io_out = out;
+    return is_valid;
+}
+
+static bool
+utf32_scalar(const uint8_t *src, Endian endian, uint64_t stop, uint64_t *io_pos, uint8_t **io_out)
+{
+    auto pos = *io_pos;
+    auto out = *io_out;
+    auto is_valid = true;
+    for (; pos < stop; pos += 1) {
+        auto code_point = (uint32_t)load_unsigned(src + pos * 4, 4, endian);
+        if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            is_valid = false;
+            break;
+        }
+        out = utf8_put(out, code_point);
+    }
+
+    *io_pos = pos;
+    *io_out = out;
+    return is_valid;
+}
+
+#ifdef ARCH_X86
+
+/*
+ * Byte shuffles packing the UTF-8 of four code points, each spread over the
+ * low bytes of a 32-bit lane. Indexed by the lanes needing 2 or more bytes
+ * (bits 0-3) and 3 bytes (bits 4-7).
+ */
+struct Utf8PackTables {
+    uint8_t shuffle[256][16];
+    uint8_t size[256];
+};
+
+static constexpr Utf8PackTables
+utf8_pack_tables_make()
+{
+    auto tables = Utf8PackTables{};
+    for (uint32_t key = 0; key < 256; key += 1) {
+        uint32_t size = 0;
+        for (uint32_t lane = 0; lane < 4; lane += 1) {
+            auto length = 1 + (key >> lane & 1) + (key >> (lane + 4) & 1);
+            for (uint32_t i = 0; i < length; i += 1) {
+                tables.shuffle[key][size++] = (uint8_t)(lane * 4 + i);
+            }
+        }
+        tables.size[key] = (uint8_t)size;
+        for (auto i = size; i < 16; i += 1) {
+            tables.shuffle[key][i] = 0x80;  // zero.
+        }
+    }
+    return tables;
+}
+
+static constexpr Utf8PackTables utf8_pack_tables = utf8_pack_tables_make();
+
+/*
+ * Writes the UTF-8 of the four code points (below U+10000, no surrogates) in
+ * the 32-bit lanes of _code_points_. Stores 16 bytes, returns the end of the
+ * ones that belong to the text.
+ */
+ASTRAEA_TARGET("ssse3")
+static uint8_t *
+utf8_pack4(__m128i code_points, uint8_t *out)
+{
+    auto low6 = _mm_set1_epi32(0x3F);
+    auto continuation = _mm_set1_epi32(0x80);
+    auto byte_2 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(code_points, 6), low6), continuation);
+    auto byte_last = _mm_or_si128(_mm_and_si128(code_points, low6), continuation);
+
+    auto three = _mm_or_si128(_mm_srli_epi32(code_points, 12), _mm_set1_epi32(0xE0));
+    three = _mm_or_si128(three, _mm_or_si128(_mm_slli_epi32(byte_2, 8), _mm_slli_epi32(byte_last, 16)));
+    auto two = _mm_or_si128(_mm_srli_epi32(code_points, 6), _mm_set1_epi32(0xC0));
+    two = _mm_or_si128(two, _mm_slli_epi32(byte_last, 8));
+
+    auto is_two = _mm_cmpgt_epi32(code_points, _mm_set1_epi32(0x7F));
+    auto is_three = _mm_cmpgt_epi32(code_points, _mm_set1_epi32(0x7FF));
+    auto bytes = _mm_or_si128(_mm_andnot_si128(is_two, code_points), _mm_and_si128(is_two, two));
+    bytes = _mm_or_si128(_mm_andnot_si128(is_three, bytes), _mm_and_si128(is_three, three));
+
+    auto key = _mm_movemask_ps(_mm_castsi128_ps(is_two)) | _mm_movemask_ps(_mm_castsi128_ps(is_three)) << 4;
+    auto shuffle = _mm_loadu_si128((const __m128i *)utf8_pack_tables.shuffle[key]);
+    _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(bytes, shuffle));
+
+    return out + utf8_pack_tables.size[key];
+}
+
+/*
+ * Copies ASCII 16 bytes at a time, stops before the first block with a byte
+ * over 0x7F.
+ */
+ASTRAEA_TARGET("sse2")
+static uint64_t
+ascii_copy_sse2(const uint8_t *src, uint64_t size, uint8_t *dst)
+{
+    uint64_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        auto bytes = _mm_loadu_si128((const __m128i *)(src + pos));
+        if (_mm_movemask_epi8(bytes)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + pos), bytes);
+    }
+    return pos;
+}
+
+/*
+ * Kernels stop at the blocks they cannot write without going past the
+ * utf8_capacity of the input, the scalar code finishes the text.
+ */
+ASTRAEA_TARGET("ssse3")
+static uint64_t
+latin1_ssse3(const uint8_t *src, uint64_t size, uint8_t **io_out)
+{
+    auto out = *io_out;
+    auto zero = _mm_setzero_si128();
+    uint64_t pos = 0;
+    for (; size - pos >= 32; pos += 16) {
+        auto bytes = _mm_loadu_si128((const __m128i *)(src + pos));
+        if (!_mm_movemask_epi8(bytes)) {
+            _mm_storeu_si128((__m128i *)out, bytes);
+            out += 16;
+            continue;
+        }
+        auto low = _mm_unpacklo_epi8(bytes, zero);
+        auto high = _mm_unpackhi_epi8(bytes, zero);
+        out = utf8_pack4(_mm_unpacklo_epi16(low, zero), out);
+        out = utf8_pack4(_mm_unpackhi_epi16(low, zero), out);
+        out = utf8_pack4(_mm_unpacklo_epi16(high, zero), out);
+        out = utf8_pack4(_mm_unpackhi_epi16(high, zero), out);
+    }
+
+    *io_out = out;
+    return pos;
+}
+
+ASTRAEA_TARGET("ssse3")
+static bool
+utf16_ssse3(const uint8_t *src, uint64_t units, Endian endian, uint64_t *io_pos, uint8_t **io_out)
+{
+    auto zero = _mm_setzero_si128();
+    auto swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    auto pos = *io_pos;
+    auto out = *io_out;
+    auto is_valid = true;
+    while (units - pos >= 16) {
+        auto v = _mm_loadu_si128((const __m128i *)(src + pos * 2));
+        if (Endian::native != endian) {
+            v = _mm_shuffle_epi8(v, swap);
+        }
+
+        auto is_ascii = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFF80)), zero);
+        if (_mm_movemask_epi8(is_ascii) == 0xFFFF) {
+            _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(v, v));
+            out += 8;
+            pos += 8;
+            continue;
+        }
+
+        auto is_surrogate = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), _mm_set1_epi16((short)0xD800));
+        if (_mm_movemask_epi8(is_surrogate)) {
+            if (!utf16_scalar(src, units, endian, pos + 8, &pos, &out)) {
+                is_valid = false;
+                break;
+            }
+            continue;
+        }
+
+        out = utf8_pack4(_mm_unpacklo_epi16(v, zero), out);
+        out = utf8_pack4(_mm_unpackhi_epi16(v, zero), out);
+        pos += 8;
+    }
+
+    *io_pos = pos;
+    *io_out = out;
+    return is_valid;
+}
+
+ASTRAEA_TARGET("ssse3")
+static bool
+utf32_ssse3(const uint8_t *src, uint64_t units, Endian endian, uint64_t *io_pos, uint8_t **io_out)
+{
+    auto zero = _mm_setzero_si128();
+    auto swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    auto pos = *io_pos;
+    auto out = *io_out;
+    while (units - pos >= 8) {
+        __m128i halves[2] = {
+            _mm_loadu_si128((const __m128i *)(src + pos * 4)),
+            _mm_loadu_si128((const __m128i *)(src + pos * 4 + 16)),
+        };
+        if (Endian::native != endian) {
+            halves[0] = _mm_shuffle_epi8(halves[0], swap);
+            halves[1] = _mm_shuffle_epi8(halves[1], swap);
+        }
+
+        auto high = _mm_and_si128(_mm_or_si128(halves[0], halves[1]), _mm_set1_epi32((int)0xFFFFFF80));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) == 0xFFFF) {
+            _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(_mm_packs_epi32(halves[0], halves[1]), zero));
+            out += 8;
+            pos += 8;
+            continue;
+        }
+
+        for (auto half : halves) {
+            auto is_bmp = _mm_cmpeq_epi32(_mm_and_si128(half, _mm_set1_epi32((int)0xFFFF0000)), zero);
+            auto is_surrogate = _mm_cmpeq_epi32(_mm_and_si128(half, _mm_set1_epi32(0xF800)), _mm_set1_epi32(0xD800));
+            if (_mm_movemask_epi8(is_bmp) == 0xFFFF && !_mm_movemask_epi8(is_surrogate)) {
+                out = utf8_pack4(half, out);
+                pos += 4;
+            } else if (!utf32_scalar(src, endian, pos + 4, &pos, &out)) {
+                *io_pos = pos;
+                *io_out = out;
+                return false;
+            }
+        }
+    }
+
+    *io_pos = pos;
+    *io_out = out;
+    return true;
+}
+
+ASTRAEA_TARGET("ssse3")
+static inline __m128i
+nibbles_high(__m128i bytes)
+{
+    return _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+}
+
+/*
+ * Errors of the 16 bytes of _input_ preceded by _previous_, from the
+ * lookup algorithm of Keiser and Lemire: three table lookups on the nibbles
+ * of each byte and the byte before it classify every pair of bytes, three
+ * and four byte sequences also check the bytes two and three back.
+ */
+ASTRAEA_TARGET("ssse3")
+static __m128i
+utf8_block_errors(__m128i input, __m128i previous)
+{
+    constexpr uint8_t TOO_SHORT = 1 << 0;
+    constexpr uint8_t TOO_LONG = 1 << 1;
+    constexpr uint8_t OVERLONG_3 = 1 << 2;
+    constexpr uint8_t TOO_LARGE = 1 << 3;
+    constexpr uint8_t SURROGATE = 1 << 4;
+    constexpr uint8_t OVERLONG_2 = 1 << 5;
+    constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+    constexpr uint8_t OVERLONG_4 = 1 << 6;
+    constexpr uint8_t TWO_CONTS = 1 << 7;
+    constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+    auto byte_1_high_table = _mm_setr_epi8(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, (char)TWO_CONTS,
+        (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS, TOO_SHORT | OVERLONG_2, TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE, TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    auto byte_1_low_table = _mm_setr_epi8(
+        (char)(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4), (char)(CARRY | OVERLONG_2), (char)CARRY,
+        (char)CARRY, (char)(CARRY | TOO_LARGE), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+        (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000));
+    auto byte_2_high_table = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+        (char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE), TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT);
+
+    auto previous_1 = _mm_alignr_epi8(input, previous, 15);
+    auto special_cases = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(byte_1_high_table, nibbles_high(previous_1)),
+            _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(previous_1, _mm_set1_epi8(0x0F)))),
+        _mm_shuffle_epi8(byte_2_high_table, nibbles_high(input)));
+
+    // Bytes 2 or 3 back that lead 3 and 4 byte sequences require a continuation here.
+    auto is_third_byte = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 14), _mm_set1_epi8((char)(0xE0 - 0x80)));
+    auto is_fourth_byte = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 13), _mm_set1_epi8((char)(0xF0 - 0x80)));
+    auto must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8((char)0x80));
+
+    return _mm_xor_si128(must_be_continuation, special_cases);
+}
+
+ASTRAEA_TARGET("ssse3")
+static bool
+utf8_validate_ssse3(const uint8_t *data, uint64_t size)
+{
+    auto errors = _mm_setzero_si128();
+    auto previous = _mm_setzero_si128();
+    uint64_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        auto input = _mm_loadu_si128((const __m128i *)(data + pos));
+        if (_mm_movemask_epi8(_mm_or_si128(input, previous))) {
+            errors = _mm_or_si128(errors, utf8_block_errors(input, previous));
+        }
+        previous = input;
+    }
+
+    // The zero padding after the last bytes flags sequences cut by the end.
+    uint8_t tail[16] = {};
+    if (pos < size) {
+        std::memcpy(tail, data + pos, (size_t)(size - pos));
+    }
+    auto input = _mm_loadu_si128((const __m128i *)tail);
+    errors = _mm_or_si128(errors, utf8_block_errors(input, previous));
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#endif
+
+bool
+utf8_validate(const uint8_t *data, uint64_t size)
+{
+#ifdef ARCH_X86
+    if (cpu_has(CPU_SSSE3)) {
+        return utf8_validate_ssse3(data, size);
+    }
+#endif
+    return utf8_validate_scalar(data, size);
+}
+
+static bool
+ascii_to_utf8(const uint8_t *src, uint64_t size, uint8_t *dst, uint64_t *out_written)
+{
+    uint64_t pos = 0;
+#ifdef ARCH_X86
+    if (cpu_has(CPU_SSE2)) {
+        pos = ascii_copy_sse2(src, size, dst);
+    }
+#endif
+    for (; pos < size && src[pos] < 0x80; pos += 1) {
+        dst[pos] = src[pos];
+    }
+
+    *out_written = pos;
+    return pos == size;
+}
+
+static bool
+latin1_to_utf8(const uint8_t *src, uint64_t size, uint8_t *dst, uint64_t *out_written)
+{
+    uint64_t pos = 0;
+    auto out = dst;
+#ifdef ARCH_X86
+    if (cpu_has(CPU_SSSE3)) {
+        pos = latin1_ssse3(src, size, &out);
+    }
+#endif
+    for (; pos < size; pos += 1) {
+        out = utf8_put(out, src[pos]);
+    }
+
+    *out_written = (uint64_t)(out - dst);
+    return true;
+}
+
+static bool
+utf16_to_utf8(const uint8_t *src, uint64_t size, Endian endian, uint8_t *dst, uint64_t *out_written)
+{
+    auto units = size / 2;
+    uint64_t pos = 0;
+    auto out = dst;
+    auto is_valid = true;
+#ifdef ARCH_X86
+    if (cpu_has(CPU_SSSE3)) {
+        is_valid = utf16_ssse3(src, units, endian, &pos, &out);
+    }
+#endif
+    is_valid = is_valid && utf16_scalar(src, units, endian, units, &pos, &out);
+
+    *out_written = (uint64_t)(out - dst);
+    return is_valid && size % 2 == 0;
+}
+
+static bool
+utf32_to_utf8(const uint8_t *src, uint64_t size, Endian endian, uint8_t *dst, uint64_t *out_written)
+{
+    auto units = size / 4;
+    uint64_t pos = 0;
+    auto out = dst;
+    auto is_valid = true;
+#ifdef ARCH_X86
+    if (cpu_has(CPU_SSSE3)) {
+        is_valid = utf32_ssse3(src, units, endian, &pos, &out);
+    }
+#endif
+    is_valid = is_valid && utf32_scalar(src, endian, units, &pos, &out);
+
+    *out_written = (uint64_t)(out - dst);
+    return is_valid && size % 4 == 0;
+}
+
+bool
+transcode_to_utf8(TextEncoding encoding, const uint8_t *src, uint64_t size, uint8_t *dst, uint64_t *out_written)
+{
+    switch (encoding) {
+    case TextEncoding::ASCII:
+        return ascii_to_utf8(src, size, dst, out_written);
+    case TextEncoding::LATIN1:
+        return latin1_to_utf8(src, size, dst, out_written);
+    case TextEncoding::UTF16LE:
+    case TextEncoding::UTF16BE:
+        return utf16_to_utf8(src, size, text_encoding_endian(encoding), dst, out_written);
+    case TextEncoding::UTF32LE:
+    case TextEncoding::UTF32BE:
+        return utf32_to_utf8(src, size, text_encoding_endian(encoding), dst, out_written);
+    case TextEncoding::UTF8:
+    {
+        auto is_valid = utf8_validate(src, size);
+        if (is_valid && size > 0) {
+            std::memcpy(dst, src, (size_t)size);  // empty text may come without storage.
+        }
+        *out_written = is_valid ? size : 0;
+        return is_valid;
+    }
+    case TextEncoding::NONE:
+        break;
+    }
+
+    if (size > 0) {
+        std::memcpy(dst, src, (size_t)size);
+    }
+    *out_written = size;
+    return true;
+}
+
+bool
+transcode_from_utf8(
+    TextEncoding encoding, const uint8_t *src, uint64_t size, uint8_t *dst, uint64_t capacity, uint64_t *out_written)
+{
+    auto endian = text_encoding_endian(encoding);
+    uint64_t written = 0;
+    auto is_valid = true;
+    for (uint64_t pos = 0; pos < size && is_valid;) {
+        uint32_t code_point = 0;
+        auto length = utf8_get(src + pos, size - pos, &code_point);
+        uint8_t units[4];
+        uint32_t units_size = 0;
+        switch (encoding) {
+        case TextEncoding::ASCII:
+        case TextEncoding::LATIN1:
+            units[0] = (uint8_t)code_point;
+            units_size = code_point < (TextEncoding::ASCII == encoding ? 0x80u : 0x100u) ? 1 : 0;
+            break;
+        case TextEncoding::UTF16LE:
+        case TextEncoding::UTF16BE:
+            if (code_point < 0x10000) {
+                store_unsigned(units, code_point, 2, endian);
+                units_size = 2;
+            } else {
+                store_unsigned(units, 0xD800 + ((code_point - 0x10000) >> 10), 2, endian);
+                store_unsigned(units + 2, 0xDC00 + ((code_point - 0x10000) & 0x3FF), 2, endian);
+                units_size = 4;
+            }
+            break;
+        case TextEncoding::UTF32LE:
+        case TextEncoding::UTF32BE:
+            store_unsigned(units, code_point, 4, endian);
+            units_size = 4;
+            break;
+        default:
+            std::memcpy(units, src + pos, length);
+            units_size = length;
+            break;
+        }
+
+        is_valid = length && units_size && written + units_size <= capacity;
+        if (is_valid) {
+            std::memcpy(dst + written, units, units_size);
+            written += units_size;
+            pos += length;
+        }
+    }
+
+    *out_written = written;
+    return is_valid;
+}
+
+}  // namespace platform